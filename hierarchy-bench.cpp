@@ -1,13 +1,174 @@
+#include "hierarchy/draw-commands.hpp"
 #include "hierarchy/entity.hpp"
+#include "hierarchy/filtered-view.hpp"
+#include "hierarchy/frame-renderer.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+#include "hierarchy/importer.hpp"
+#include "hierarchy/journal.hpp"
+#include "hierarchy/name-index.hpp"
+#include "hierarchy/snapshot.hpp"
+#include "hierarchy/soa-hierarchy.hpp"
+#include "hierarchy/thread-pool.hpp"
+#include "hierarchy/virtual-view.hpp"
+#include "hierarchy/vt-buffer.hpp"
 
 #include <benchmark/benchmark.h>
 
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+// count heap allocations so benchmarks can report allocations per entity
+static std::atomic<int64_t> g_allocation_count = 0;
+
+// every replaceable form is replaced so each allocation is released by the
+// matching function, malloc and free are kept out of line so callers that
+// inline a new/delete pair don't see delete freeing memory from new
+[[gnu::noinline]] static void* counted_alloc(
+  const std::size_t size, const std::size_t alignment) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+    return std::malloc(size == 0 ? 1 : size);
+  }
+  // aligned_alloc requires size to be a multiple of alignment
+  return std::aligned_alloc(
+    alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+[[gnu::noinline]] static void counted_free(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+static void* counted_new(
+  const std::size_t size,
+  const std::size_t alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+  if (void* ptr = counted_alloc(size, alignment)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size) {
+  return counted_new(size);
+}
+
+void* operator new[](std::size_t size) {
+  return counted_new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return counted_new(size, std::size_t(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return counted_new(size, std::size_t(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(
+  std::size_t size, std::align_val_t alignment,
+  const std::nothrow_t&) noexcept {
+  return counted_alloc(size, std::size_t(alignment));
+}
+
+void* operator new[](
+  std::size_t size, std::align_val_t alignment,
+  const std::nothrow_t&) noexcept {
+  return counted_alloc(size, std::size_t(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete(
+  void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
+
+void operator delete[](
+  void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+  counted_free(ptr);
+}
+
+// array-of-structs (entity_t) and struct-of-arrays hierarchy storage
+using aos_t = thh::handle_vector_t<hy::entity_t>;
+using soa_t = hy::soa_hierarchy_t;
+
+template<typename Entities>
 static void expanded_count(benchmark::State& state) {
+  Entities entities;
+  auto root_handles = demo::create_bench_entities(entities, 1, 1000000);
+
+  hy::collapser_t collapser;
+  // counts are cached after the first call (entity_t only)
+  hy::expanded_count(root_handles[0], entities, collapser);
+  for ([[maybe_unused]] auto _ : state) {
+    int count = 0;
+    count = hy::expanded_count(root_handles[0], entities, collapser);
+    benchmark::DoNotOptimize(count);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_TEMPLATE(expanded_count, aos_t);
+BENCHMARK_TEMPLATE(expanded_count, soa_t);
+
+static void expanded_count_uncached(benchmark::State& state) {
   thh::handle_vector_t<hy::entity_t> entities;
   auto root_handles = demo::create_bench_entities(entities, 1, 1000000);
 
   hy::collapser_t collapser;
   for ([[maybe_unused]] auto _ : state) {
+    collapser.clear_expanded_counts();
     int count = 0;
     count = hy::expanded_count(root_handles[0], entities, collapser);
     benchmark::DoNotOptimize(count);
@@ -15,21 +176,64 @@ static void expanded_count(benchmark::State& state) {
   }
 }
 
-BENCHMARK(expanded_count);
+BENCHMARK(expanded_count_uncached);
 
+template<typename Entities>
 static void create_entities(benchmark::State& state) {
-  thh::handle_vector_t<hy::entity_t> entities;
+  const int handle_count = 1000000;
+  Entities entities;
+  const int64_t allocation_count_begin = g_allocation_count;
   for ([[maybe_unused]] auto _ : state) {
-    auto root_handles = demo::create_bench_entities(entities, 1, 1000000);
+    auto root_handles = demo::create_bench_entities(entities, 1, handle_count);
     benchmark::DoNotOptimize(root_handles);
     benchmark::ClobberMemory();
   }
+  state.counters["allocs_per_entity"] =
+    double(g_allocation_count - allocation_count_begin)
+    / double(state.iterations() * handle_count);
 }
 
-BENCHMARK(create_entities);
+BENCHMARK_TEMPLATE(create_entities, aos_t);
+BENCHMARK_TEMPLATE(create_entities, soa_t);
+
+// create the same chain as create_entities with add_entities from parent
+// indices (0) or depths and names (1), names are prepared up front
+static void create_entities_bulk(benchmark::State& state) {
+  const int handle_count = 1000000;
+  std::vector<int32_t> parent_indices;
+  std::vector<std::string> names;
+  std::vector<std::pair<int, std::string>> depth_names;
+  for (int i = 0; i < handle_count; i++) {
+    auto name = std::string("entity_") + std::to_string(i);
+    if (state.range(0) == 0) {
+      parent_indices.push_back(i - 1);
+      names.push_back(std::move(name));
+    } else {
+      depth_names.emplace_back(i, std::move(name));
+    }
+  }
 
-static void flatten_entities_expanded(benchmark::State& state) {
   thh::handle_vector_t<hy::entity_t> entities;
+  const int64_t allocation_count_begin = g_allocation_count;
+  for ([[maybe_unused]] auto _ : state) {
+    std::vector<thh::handle_t> root_handles;
+    auto handles =
+      state.range(0) == 0
+        ? hy::add_entities(parent_indices, names, entities, root_handles)
+        : hy::add_entities(depth_names, entities, root_handles);
+    benchmark::DoNotOptimize(handles);
+    benchmark::ClobberMemory();
+  }
+  state.counters["allocs_per_entity"] =
+    double(g_allocation_count - allocation_count_begin)
+    / double(state.iterations() * handle_count);
+}
+
+BENCHMARK(create_entities_bulk)->Arg(0)->Arg(1);
+
+template<typename Entities>
+static void flatten_entities_expanded(benchmark::State& state) {
+  Entities entities;
   auto root_handles = demo::create_bench_entities(entities, 1, 1000000);
   hy::collapser_t collapser;
   for ([[maybe_unused]] auto _ : state) {
@@ -39,10 +243,12 @@ static void flatten_entities_expanded(benchmark::State& state) {
   }
 }
 
-BENCHMARK(flatten_entities_expanded);
+BENCHMARK_TEMPLATE(flatten_entities_expanded, aos_t);
+BENCHMARK_TEMPLATE(flatten_entities_expanded, soa_t);
 
+template<typename Entities>
 static void flatten_entities_collapsed(benchmark::State& state) {
-  thh::handle_vector_t<hy::entity_t> entities;
+  Entities entities;
   auto root_handles = demo::create_bench_entities(entities, 1, 1000000);
   hy::collapser_t collapser;
   for (const auto& handle : root_handles) {
@@ -55,7 +261,57 @@ static void flatten_entities_collapsed(benchmark::State& state) {
   }
 }
 
-BENCHMARK(flatten_entities_collapsed);
+BENCHMARK_TEMPLATE(flatten_entities_collapsed, aos_t);
+BENCHMARK_TEMPLATE(flatten_entities_collapsed, soa_t);
+
+// the same number of entities split across a varying number of roots,
+// flattened serially (zero threads) or on a pool of threads
+static void flatten_entities_parallel(benchmark::State& state) {
+  const int root_count = state.range(0);
+  const int thread_count = state.range(1);
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, root_count, (1 << 20) / root_count);
+
+  hy::collapser_t collapser;
+  hy::thread_pool_t thread_pool(thread_count);
+  for ([[maybe_unused]] auto _ : state) {
+    if (thread_count == 0) {
+      benchmark::DoNotOptimize(
+        hy::flatten_entities(entities, collapser, root_handles));
+    } else {
+      benchmark::DoNotOptimize(hy::flatten_entities(
+        entities, collapser, root_handles, thread_pool));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (int64_t)(1 << 20));
+}
+
+BENCHMARK(flatten_entities_parallel)
+  ->ArgsProduct({{16, 256, 4096}, {0, 1, 2, 4, 8}})
+  ->ArgNames({"roots", "threads"})
+  ->UseRealTime();
+
+template<typename Entities>
+static void flatten_entities_collapsed_count(benchmark::State& state) {
+  Entities entities;
+  // every root has a single child so each root can be collapsed
+  auto root_handles = demo::create_bench_entities(entities, state.range(0), 2);
+  hy::collapser_t collapser;
+  for (const auto& handle : root_handles) {
+    collapser.collapse(handle, entities);
+  }
+  for ([[maybe_unused]] auto _ : state) {
+    auto flattened = hy::flatten_entities(entities, collapser, root_handles);
+    benchmark::DoNotOptimize(flattened);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_TEMPLATE(flatten_entities_collapsed_count, aos_t)
+  ->Range(1 << 8, 1 << 16);
+BENCHMARK_TEMPLATE(flatten_entities_collapsed_count, soa_t)
+  ->Range(1 << 8, 1 << 16);
 
 static void expand_entity(benchmark::State& state) {
   thh::handle_vector_t<hy::entity_t> entities;
@@ -78,4 +334,1009 @@ static void expand_entity(benchmark::State& state) {
 
 BENCHMARK(expand_entity)->Range(100, 1<<22);
 
+static void collapse_entity(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1, state.range(0));
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  hy::expanded_count(root_handles[0], entities, collapser);
+
+  for ([[maybe_unused]] auto _ : state) {
+    view.collapse(entities, collapser);
+    benchmark::DoNotOptimize(view);
+    benchmark::ClobberMemory();
+    state.PauseTiming();
+    view.expand(entities, collapser);
+    state.ResumeTiming();
+  }
+}
+
+// expanding again is untimed but slow so iterations are fixed
+BENCHMARK(collapse_entity)->Range(100, 1 << 20)->Iterations(50);
+
+// many small roots so the view holds a large number of rows, collapsing and
+// expanding a root edits the rows near the selection only
+static void edit_view_rows(benchmark::State& state, const bool at_bottom) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0), 2);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  if (at_bottom) {
+    for (int i = 0; i < view.flattened_handles().size() - 2; i++) {
+      view.move_down();
+    }
+  }
+
+  const int64_t allocation_count = g_allocation_count;
+  for ([[maybe_unused]] auto _ : state) {
+    view.collapse(entities, collapser);
+    view.expand(entities, collapser);
+    benchmark::DoNotOptimize(view);
+    benchmark::ClobberMemory();
+  }
+  state.counters["allocs_per_iteration"] = benchmark::Counter(
+    double(g_allocation_count - allocation_count),
+    benchmark::Counter::kAvgIterations);
+}
+
+static void edit_view_rows_top(benchmark::State& state) {
+  edit_view_rows(state, false);
+}
+
+static void edit_view_rows_bottom(benchmark::State& state) {
+  edit_view_rows(state, true);
+}
+
+BENCHMARK(edit_view_rows_top)->Range(1 << 10, 1 << 20);
+BENCHMARK(edit_view_rows_bottom)->Range(1 << 10, 1 << 20);
+
+// flatten a small subtree and find its descendants repeatedly (as when
+// expanding and removing), allocating new results (0) or reusing a
+// traversal context (1)
+static void traverse_subtree(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 16);
+
+  hy::collapser_t collapser;
+  hy::traversal_context_t traversal_context;
+  const int64_t allocation_count = g_allocation_count;
+  for ([[maybe_unused]] auto _ : state) {
+    for (const auto root_handle : root_handles) {
+      if (state.range(0) == 0) {
+        const auto flattened =
+          hy::flatten_entity(root_handle, 0, entities, collapser);
+        const auto descendants =
+          hy::entity_and_descendants(root_handle, entities);
+        benchmark::DoNotOptimize(flattened.data());
+        benchmark::DoNotOptimize(descendants.data());
+      } else {
+        const auto& flattened = hy::flatten_entity(
+          root_handle, 0, entities, collapser, traversal_context);
+        benchmark::DoNotOptimize(flattened.data());
+        const auto& descendants =
+          hy::entity_and_descendants(root_handle, entities, traversal_context);
+        benchmark::DoNotOptimize(descendants.data());
+      }
+    }
+  }
+  state.counters["allocs_per_iteration"] = benchmark::Counter(
+    double(g_allocation_count - allocation_count),
+    benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(traverse_subtree)->Arg(0)->Arg(1);
+
+// rows [row, row + 50) of 1M visible entities, found by flattening every
+// entity (0) or by a pre-order traversal that stops after the last row (1)
+static void visible_window(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 1 << 10);
+
+  hy::collapser_t collapser;
+  const int64_t row = state.range(1);
+  std::vector<hy::flattened_handle_t> window;
+  hy::pre_order_t<hy::collapser_t> pre_order;
+  for ([[maybe_unused]] auto _ : state) {
+    window.clear();
+    if (state.range(0) == 0) {
+      const auto flattened =
+        hy::flatten_entities(entities, collapser, root_handles);
+      window.assign(
+        flattened.begin() + row, flattened.begin() + row + 50);
+    } else {
+      pre_order.reset(root_handles, entities, collapser);
+      for (int64_t i = 0; i < row + 50; i++, pre_order.next()) {
+        if (i >= row) {
+          window.push_back(pre_order.current());
+        }
+      }
+    }
+    benchmark::DoNotOptimize(window.data());
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(visible_window)
+  ->ArgsProduct({{0, 1}, {0, 1 << 10, 1 << 19}})
+  ->Unit(benchmark::kMicrosecond);
+
+// find the first visible entity with a name, flattening every entity first
+// (0) or stopping the pre-order traversal at the match (1)
+static void find_visible(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 1 << 10);
+
+  hy::collapser_t collapser;
+  const auto has_name = [&entities](const hy::flattened_handle_t& row) {
+    return entities
+      .call_return(
+        row.entity_handle_,
+        [](const hy::entity_t& entity) {
+          return entity.name_ == "entity_5000";
+        })
+      .value_or(false);
+  };
+  for ([[maybe_unused]] auto _ : state) {
+    std::optional<hy::flattened_handle_t> found;
+    if (state.range(0) == 0) {
+      const auto flattened =
+        hy::flatten_entities(entities, collapser, root_handles);
+      if (const auto it =
+            std::find_if(flattened.begin(), flattened.end(), has_name);
+          it != flattened.end()) {
+        found = *it;
+      }
+    } else {
+      hy::pre_order_t pre_order(root_handles, entities, collapser);
+      if (const auto it =
+            std::find_if(pre_order.begin(), pre_order.end(), has_name);
+          it != pre_order.end()) {
+        found = *it;
+      }
+    }
+    benchmark::DoNotOptimize(found);
+  }
+}
+
+BENCHMARK(find_visible)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// build a view and draw the first frame (drawing is a no-op)
+template<typename View>
+static void first_frame(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0) / 8, 8);
+
+  hy::display_ops_t display_ops;
+  display_ops.set_bold_fn_ = [](bool) {};
+  display_ops.set_invert_fn_ = [](bool) {};
+  display_ops.draw_fn_ = [](std::string_view) {};
+  display_ops.draw_at_fn_ = [](int, int, std::string_view) {};
+
+  for ([[maybe_unused]] auto _ : state) {
+    hy::collapser_t collapser;
+    if constexpr (std::is_same_v<View, hy::view_t>) {
+      hy::view_t view(
+        hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+      hy::display_scrollable_hierarchy(
+        entities, root_handles, view, collapser, display_ops);
+    } else {
+      hy::virtual_view_t view(entities, collapser, root_handles, 0, 20);
+      hy::display_scrollable_hierarchy(
+        entities, root_handles, view, collapser, display_ops);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_TEMPLATE(first_frame, hy::view_t)->Range(1 << 10, 1 << 22);
+BENCHMARK_TEMPLATE(first_frame, hy::virtual_view_t)->Range(1 << 10, 1 << 22);
+
+// jump to the deepest entity of the last root (the final row of the view)
+static void go_to_entity_far(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0) / 64, 64);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  for (int i = 0; i < view.flattened_handles().size() - 1; i++) {
+    view.move_down();
+  }
+  view.record_handle();
+
+  for ([[maybe_unused]] auto _ : state) {
+    view.goto_recorded_handle(entities, collapser);
+    benchmark::DoNotOptimize(view);
+  }
+}
+
+BENCHMARK(go_to_entity_far)->Range(1 << 10, 1 << 22);
+
+// as above but with the entity hidden below its collapsed root
+static void go_to_entity_deep(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0) / 64, 64);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  for (int i = 0; i < view.flattened_handles().size() - 1; i++) {
+    view.move_down();
+  }
+  view.record_handle();
+
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    for (int i = 0; i < 63; i++) {
+      view.move_up();
+    }
+    view.collapse(entities, collapser);
+    state.ResumeTiming();
+    view.goto_recorded_handle(entities, collapser);
+    benchmark::DoNotOptimize(view);
+  }
+}
+
+BENCHMARK(go_to_entity_deep)->Range(1 << 10, 1 << 22);
+
+// remove a root and its chain of descendants (with its expanded count cached
+// as it is after being shown), all at once (0) or unlinking it and reclaiming
+// a single batch of entities as a frame would (1)
+static void remove_subtree(benchmark::State& state) {
+  const bool deferred = state.range(0) == 1;
+  thh::handle_vector_t<hy::entity_t> entities;
+  hy::collapser_t collapser;
+  hy::entity_reclaimer_t reclaimer;
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    reclaimer.reclaim_all(entities, collapser);
+    auto root_handles =
+      demo::create_bench_entities(entities, 1, (int)state.range(1));
+    hy::view_t view(
+      hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+    hy::expanded_count(root_handles[0], entities, collapser);
+    state.ResumeTiming();
+    if (deferred) {
+      view.remove(entities, collapser, root_handles, reclaimer);
+      reclaimer.reclaim(1 << 12, entities, collapser);
+    } else {
+      view.remove(entities, collapser, root_handles);
+    }
+    benchmark::DoNotOptimize(view);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(remove_subtree)
+  ->ArgsProduct({{0, 1}, {1 << 10, 1 << 16, 1 << 21}})
+  ->ArgNames({"deferred", "entities"})
+  ->Unit(benchmark::kMicrosecond);
+
+// edits made through one of several views of the same entities (adding and
+// removing a child), the other views flatten the entities again (0) or patch
+// their rows from published events (1)
+static void edit_shared_views(benchmark::State& state) {
+  const bool published = state.range(0) == 1;
+  const auto view_count = (int)state.range(1);
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 12, 64);
+
+  hy::hierarchy_events_t events;
+  std::vector<hy::collapser_t> collapsers(view_count);
+  std::vector<hy::view_t> views;
+  views.reserve(view_count);
+  for (int i = 0; i < view_count; i++) {
+    views.emplace_back(
+      hy::flatten_entities(entities, collapsers[i], root_handles), 0, 20);
+    if (published) {
+      hy::subscribe(events, views[i], entities, collapsers[i], root_handles);
+    }
+  }
+  // the last entity of the first root
+  for (int i = 0; i < 63; i++) {
+    views[0].move_down();
+  }
+
+  const auto flatten_others = [&] {
+    for (int i = 1; i < view_count; i++) {
+      views[i] = hy::view_t(
+        hy::flatten_entities(entities, collapsers[i], root_handles), 0, 20);
+    }
+  };
+  for ([[maybe_unused]] auto _ : state) {
+    views[0].add_child(entities, collapsers[0]);
+    if (!published) {
+      flatten_others();
+    }
+    views[0].move_down();
+    views[0].remove(entities, collapsers[0], root_handles);
+    if (!published) {
+      flatten_others();
+    }
+    views[0].move_up();
+    benchmark::DoNotOptimize(views);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(edit_shared_views)
+  ->ArgsProduct({{0, 1}, {1, 4, 16}})
+  ->ArgNames({"published", "views"})
+  ->Unit(benchmark::kMicrosecond);
+
+// remove (0), undo removing (1) and redo removing (2) a root with a chain of
+// descendants through a journal, with 4096 other roots of 64 entities, or
+// flatten every entity again (3) as undoing without the journal would need
+static void journal_remove_subtree(benchmark::State& state) {
+  const auto mode = state.range(0);
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, 1, (int)state.range(1));
+  const auto other_root_handles =
+    demo::create_bench_entities(entities, 1 << 12, 64);
+  root_handles.insert(
+    root_handles.end(), other_root_handles.begin(), other_root_handles.end());
+  for (int32_t r = 0; r < (int32_t)root_handles.size(); r++) {
+    entities.call(root_handles[r], [r](hy::entity_t& entity) {
+      entity.sibling_index_ = r;
+    });
+  }
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  // large enough to keep the largest subtree
+  hy::journal_t journal(256, int64_t(1) << 30);
+  const auto reclaim = [&] {
+    journal.reclaim(std::numeric_limits<int>::max(), entities, collapser);
+  };
+  const auto undo = [&] {
+    journal.undo(view, entities, collapser, root_handles);
+  };
+  const auto redo = [&] {
+    journal.redo(view, entities, collapser, root_handles);
+  };
+  const auto remove = [&] {
+    journal.remove(view, entities, collapser, root_handles);
+  };
+
+  for ([[maybe_unused]] auto _ : state) {
+    state.PauseTiming();
+    if (mode == 1) {
+      remove();
+      reclaim();
+    } else if (mode == 2) {
+      remove();
+      reclaim();
+      undo();
+    }
+    state.ResumeTiming();
+    if (mode == 0) {
+      remove();
+    } else if (mode == 1) {
+      undo();
+    } else if (mode == 2) {
+      redo();
+    } else {
+      auto flattened = hy::flatten_entities(entities, collapser, root_handles);
+      benchmark::DoNotOptimize(flattened);
+    }
+    benchmark::DoNotOptimize(view);
+    benchmark::ClobberMemory();
+    state.PauseTiming();
+    if (mode == 0 || mode == 2) {
+      reclaim();
+      undo();
+    }
+    state.ResumeTiming();
+  }
+}
+
+BENCHMARK(journal_remove_subtree)
+  ->ArgsProduct({{0, 1, 2, 3}, {1 << 10, 1 << 16, 1 << 21}})
+  ->ArgNames({"mode", "entities"})
+  ->Unit(benchmark::kMicrosecond);
+
+// linear search through a vector of flattened handles for comparison
+static void go_to_entity_far_vector(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0) / 64, 64);
+
+  hy::collapser_t collapser;
+  auto flattened_handles =
+    hy::flatten_entities(entities, collapser, root_handles);
+  const auto entity_handle = flattened_handles.back().entity_handle_;
+
+  for ([[maybe_unused]] auto _ : state) {
+    benchmark::DoNotOptimize(hy::go_to_entity(
+      entity_handle, entities, collapser, flattened_handles));
+  }
+}
+
+BENCHMARK(go_to_entity_far_vector)->Range(1 << 10, 1 << 22);
+
+// draw a frame at the top, middle or bottom of a view of fully expanded
+// roots with the given depth (drawing is a no-op)
+static void display_view(benchmark::State& state) {
+  const int entity_count = state.range(0);
+  const int depth = state.range(1);
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, entity_count / depth, depth);
+
+  hy::collapser_t collapser;
+  const auto flattened_handles =
+    hy::flatten_entities(entities, collapser, root_handles);
+  const int offset =
+    std::max((int)flattened_handles.size() - 20, 0) * state.range(2) / 2;
+  hy::view_t view(flattened_handles, offset, 20);
+
+  hy::display_ops_t display_ops;
+  display_ops.set_bold_fn_ = [](bool) {};
+  display_ops.set_invert_fn_ = [](bool) {};
+  display_ops.draw_fn_ = [](std::string_view) {};
+  display_ops.draw_at_fn_ = [](int, int, std::string_view) {};
+
+  for ([[maybe_unused]] auto _ : state) {
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK(display_view)
+  ->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {8, 512}, {0, 1, 2}})
+  ->ArgNames({"entities", "depth", "offset"});
+
+// backend that draws nothing, calls are resolved at compile time
+struct noop_backend_t {
+  void set_bold(bool) {}
+  void set_invert(bool) {}
+  void draw_glyph(int, int, hy::glyph_e) {}
+  void draw(std::string_view) {}
+  int indent_width() const { return 1; }
+  void display(const hy::display_info_t&) {}
+  void scope_exit() {}
+  void display_connection(int, int) {}
+};
+
+// std::function callbacks (display_ops_t) compared to a backend type
+template<typename Backend>
+static void display_backend(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, 1 << 10, state.range(0));
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 50);
+
+  hy::display_ops_t display_ops;
+  display_ops.connection_ = "|";
+  display_ops.end_ = "L";
+  display_ops.mid_ = "-";
+  display_ops.set_bold_fn_ = [](bool) {};
+  display_ops.set_invert_fn_ = [](bool) {};
+  display_ops.draw_fn_ = [](std::string_view) {};
+  display_ops.draw_at_fn_ = [](int, int, std::string_view) {};
+  noop_backend_t noop_backend;
+
+  for ([[maybe_unused]] auto _ : state) {
+    if constexpr (std::is_same_v<Backend, hy::display_ops_t>) {
+      hy::display_scrollable_hierarchy(
+        entities, root_handles, view, collapser, display_ops);
+    } else {
+      hy::display_scrollable_hierarchy(
+        entities, root_handles, view, collapser, noop_backend);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_TEMPLATE(display_backend, hy::display_ops_t)->Arg(1)->Arg(16);
+BENCHMARK_TEMPLATE(display_backend, noop_backend_t)->Arg(1)->Arg(16);
+
+template<typename Backend>
+static void display_hierarchy_backend(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 4);
+  hy::interaction_t interaction;
+  noop_backend_t noop_backend;
+
+  for ([[maybe_unused]] auto _ : state) {
+    if constexpr (std::is_same_v<Backend, noop_backend_t>) {
+      hy::display_hierarchy(entities, interaction, root_handles, noop_backend);
+    } else {
+      hy::display_hierarchy(
+        entities, interaction, root_handles,
+        [](const hy::display_info_t&) {}, [] {}, [](int, int) {});
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+BENCHMARK_TEMPLATE(display_hierarchy_backend, hy::display_fn);
+BENCHMARK_TEMPLATE(display_hierarchy_backend, noop_backend_t);
+
+// record frames into a reused draw command buffer
+static void display_draw_commands(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, 1 << 10, state.range(0));
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 50);
+
+  hy::draw_commands_t draw_commands;
+  hy::display_scrollable_hierarchy(
+    entities, root_handles, view, collapser, draw_commands);
+
+  const int64_t allocation_count = g_allocation_count;
+  for ([[maybe_unused]] auto _ : state) {
+    draw_commands.clear();
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, draw_commands);
+    benchmark::DoNotOptimize(draw_commands.commands().data());
+  }
+  state.counters["allocs_per_frame"] = benchmark::Counter(
+    double(g_allocation_count - allocation_count),
+    benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(display_draw_commands)->Arg(1)->Arg(16);
+
+// find entities by name in 1M entities, scanning every name (0) or with a
+// trigram index (1), for a name matching one entity and a query that is a
+// prefix of many names
+static void find_name(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 1 << 10);
+
+  const hy::expand_all_t expand_all;
+  hy::name_index_t name_index;
+  std::vector<thh::handle_t> handles;
+  for (const auto& row : hy::pre_order_t(root_handles, entities, expand_all)) {
+    name_index.add(row.entity_handle_, entities);
+    handles.push_back(row.entity_handle_);
+  }
+
+  const std::string_view query = state.range(1) == 0 ? "entity_54321" : "y_99";
+  for ([[maybe_unused]] auto _ : state) {
+    std::vector<thh::handle_t> matches;
+    if (state.range(0) == 0) {
+      for (const auto handle : handles) {
+        entities.call(handle, [&](const hy::entity_t& entity) {
+          if (entity.name_.view().find(query) != std::string_view::npos) {
+            matches.push_back(handle);
+          }
+        });
+      }
+    } else {
+      matches = name_index.find(query, entities);
+    }
+    benchmark::DoNotOptimize(matches.data());
+  }
+}
+
+BENCHMARK(find_name)
+  ->ArgsProduct({{0, 1}, {0, 1}})
+  ->Unit(benchmark::kMicrosecond);
+
+// cost of keeping the index up to date, adding every entity (0) or renaming
+// entities back and forth (1)
+static void update_name_index(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 1 << 10);
+
+  const hy::expand_all_t expand_all;
+  std::vector<thh::handle_t> handles;
+  for (const auto& row : hy::pre_order_t(root_handles, entities, expand_all)) {
+    handles.push_back(row.entity_handle_);
+  }
+
+  hy::name_index_t name_index;
+  if (state.range(0) == 1) {
+    for (const auto handle : handles) {
+      name_index.add(handle, entities);
+    }
+  }
+
+  int64_t updates = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    if (state.range(0) == 0) {
+      name_index.clear();
+      for (const auto handle : handles) {
+        name_index.add(handle, entities);
+      }
+      updates += handles.size();
+    } else {
+      for (int i = 0; i < 1000; i++) {
+        const auto handle = handles[(updates + i) % handles.size()];
+        entities.call(
+          handle, [](hy::entity_t& entity) { entity.name_ = "renamed"; });
+        name_index.update(handle, entities);
+        entities.call(handle, [handle](hy::entity_t& entity) {
+          entity.name_ = std::string("entity_") + std::to_string(handle.id_);
+        });
+        name_index.update(handle, entities);
+      }
+      updates += 2000;
+    }
+  }
+  state.counters["updates_per_second"] =
+    benchmark::Counter(double(updates), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(update_name_index)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// typing a query one character at a time and then deleting it again in 5M
+// entities, each iteration is one keystroke, flattening every entity and
+// checking each name per keystroke (0) or updating a filtered view (1) with
+// its scans and passes run on a thread pool (2)
+static void filter_keystroke(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 5000, 1000);
+
+  hy::thread_pool_t thread_pool;
+  hy::filtered_view_t view(
+    20, state.range(0) == 2 ? &thread_pool : nullptr);
+  const std::string_view query = "entity_4321";
+  if (state.range(0) != 0) {
+    view.set_query(query.substr(0, 1), entities, root_handles);
+  }
+
+  size_t length = 1;
+  size_t step = 1;
+  int64_t rows = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    if (length + step == 0 || length + step > query.size()) {
+      step = -step;
+    }
+    length += step;
+    if (state.range(0) == 0) {
+      const auto flattened =
+        hy::flatten_entities(entities, hy::collapser_t(), root_handles);
+      int64_t matches = 0;
+      for (const auto& row : flattened) {
+        entities.call(row.entity_handle_, [&](const hy::entity_t& entity) {
+          matches += hy::name_contains(entity.name_, query.substr(0, length));
+        });
+      }
+      rows += matches;
+    } else {
+      view.set_query(query.substr(0, length), entities, root_handles);
+      rows += view.row_count();
+    }
+  }
+  state.counters["rows"] =
+    benchmark::Counter(double(rows), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(filter_keystroke)
+  ->Arg(0)
+  ->Arg(1)
+  ->Arg(2)
+  ->Unit(benchmark::kMillisecond);
+
+// initial scan of 5M entities for a query matching a few thousand entities,
+// serially (0) or on a thread pool (1)
+static void filter_scan(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 5000, 1000);
+
+  hy::thread_pool_t thread_pool;
+  hy::filtered_view_t view(
+    20, state.range(0) == 1 ? &thread_pool : nullptr);
+  view.set_query("entity_4321", entities, root_handles);
+  for ([[maybe_unused]] auto _ : state) {
+    view.refresh(entities, root_handles);
+    benchmark::DoNotOptimize(view.row_count());
+  }
+}
+
+BENCHMARK(filter_scan)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+// renaming an entity with a filtered view of 5M entities open (with a
+// shorter query kept in its history), each iteration renames an entity and
+// renames it back, updating the view after each
+static void filter_update(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 5000, 1000);
+
+  hy::filtered_view_t view(20);
+  view.set_query("entity_4", entities, root_handles);
+  view.set_query("entity_43", entities, root_handles);
+
+  int64_t updates = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    const auto handle = root_handles[updates % root_handles.size()];
+    const auto name =
+      entities
+        .call_return(
+          handle,
+          [](const hy::entity_t& entity) { return std::string(entity.name_); })
+        .value_or("");
+    entities.call(
+      handle, [](hy::entity_t& entity) { entity.name_ = "entity_43_"; });
+    view.update(handle, entities, root_handles);
+    entities.call(handle, [&name](hy::entity_t& entity) {
+      entity.name_ = name;
+    });
+    view.update(handle, entities, root_handles);
+    updates += 2;
+  }
+  state.counters["updates_per_second"] =
+    benchmark::Counter(double(updates), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(filter_update)->Unit(benchmark::kMicrosecond);
+
+// bytes written per key press moving through the hierarchy, redrawing every
+// row (0) or only rows that changed (1)
+static void render_keystroke_bytes(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_bench_entities(entities, 1 << 10, 4);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 50);
+
+  const bool damage_tracked = state.range(0) != 0;
+  hy::draw_commands_t draw_commands;
+  hy::frame_renderer_t frame_renderer;
+  hy::vt_buffer_t vt_buffer;
+  const auto render = [&] {
+    draw_commands.clear();
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, draw_commands);
+    if (!damage_tracked) {
+      frame_renderer.invalidate();
+    }
+    frame_renderer.render(
+      draw_commands, view.offset(), view.count(), vt_buffer);
+  };
+  render();
+
+  int64_t bytes = 0;
+  int64_t keystroke = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    // move down then back up, scrolling past the bottom and top of the view
+    if ((keystroke++ / 200) % 2 == 0) {
+      view.move_down();
+    } else {
+      view.move_up();
+    }
+    vt_buffer.clear();
+    render();
+    bytes += vt_buffer.bytes().size();
+  }
+  state.counters["bytes_per_keystroke"] =
+    benchmark::Counter(double(bytes), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(render_keystroke_bytes)->Arg(0)->Arg(1);
+
+// render a full frame of VT escape sequences at the top, middle or bottom of
+// a view of fully expanded roots (8 deep) to catch rendering regressions
+static void render_vt_frame(benchmark::State& state) {
+  const int entity_count = state.range(0);
+  const int depth = 8;
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, entity_count / depth, depth);
+
+  hy::collapser_t collapser;
+  const auto flattened_handles =
+    hy::flatten_entities(entities, collapser, root_handles);
+  const int offset =
+    std::max((int)flattened_handles.size() - 50, 0) * state.range(1) / 2;
+  hy::view_t view(flattened_handles, offset, 50);
+
+  hy::vt_buffer_t vt_buffer;
+  const auto display_ops = hy::vt_display_ops(vt_buffer);
+
+  int64_t bytes = 0;
+  for ([[maybe_unused]] auto _ : state) {
+    vt_buffer.clear();
+    vt_buffer.begin_frame();
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    bytes += vt_buffer.bytes().size();
+    benchmark::DoNotOptimize(vt_buffer.bytes().data());
+  }
+  state.counters["frames_per_second"] =
+    benchmark::Counter(double(state.iterations()), benchmark::Counter::kIsRate);
+  state.counters["bytes_per_frame"] =
+    benchmark::Counter(double(bytes), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(render_vt_frame)
+  ->ArgsProduct({{1 << 10, 1 << 15, 1 << 20, 10'000'000}, {0, 1, 2}})
+  ->ArgNames({"entities", "offset"});
+
+// move a chain of 7 rows from the first root to the last and back in views
+// of increasing size (the cost should not depend on the size of the view)
+static void move_selected(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles =
+    demo::create_bench_entities(entities, state.range(0) / 8, 8);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 50);
+  view.move_down(); // select the first root's child
+  const auto first_root = root_handles.front();
+  const auto last_root = root_handles.back();
+
+  for ([[maybe_unused]] auto _ : state) {
+    view.move_selected_to(last_root, entities, collapser, root_handles);
+    view.move_selected_to(first_root, entities, collapser, root_handles);
+  }
+}
+
+BENCHMARK(move_selected)->Range(1 << 10, 1 << 20);
+
+// one root with child_count children
+static std::vector<thh::handle_t> create_wide_entities(
+  thh::handle_vector_t<hy::entity_t>& entities, const int child_count) {
+  std::vector<int32_t> parent_indices(child_count + 1, 0);
+  parent_indices[0] = -1;
+  std::vector<std::string> names(child_count + 1);
+  for (int i = 0; i < child_count + 1; i++) {
+    names[i] = std::string("entity_") + std::to_string(i);
+  }
+  std::vector<thh::handle_t> root_handles;
+  hy::add_entities(parent_indices, names, entities, root_handles);
+  return root_handles;
+}
+
+// step to the next and previous row from the middle child of a wide entity
+static void sibling_navigation_wide(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  const auto root_handles = create_wide_entities(entities, state.range(0));
+  hy::collapser_t collapser;
+
+  hy::flattened_handle_t flattened_handle{};
+  entities.call(root_handles.front(), [&](const hy::entity_t& entity) {
+    flattened_handle = {entity.children_[entity.children_.size() / 2], 1};
+  });
+  for ([[maybe_unused]] auto _ : state) {
+    auto next = hy::next_flattened_handle(
+      flattened_handle, entities, collapser, root_handles);
+    auto prev = hy::prev_flattened_handle(
+      flattened_handle, entities, collapser, root_handles);
+    benchmark::DoNotOptimize(next);
+    benchmark::DoNotOptimize(prev);
+  }
+}
+
+BENCHMARK(sibling_navigation_wide)->Range(1 << 10, 1 << 20);
+
+// add a sibling after the last child of a wide entity and remove the last
+// child (the view holds every child)
+static void add_remove_sibling_wide(benchmark::State& state) {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = create_wide_entities(entities, state.range(0));
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 50);
+  while (view.selected_index() != view.flattened_handles().size() - 1) {
+    view.move_down();
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    view.add_sibling(entities, collapser, root_handles);
+    view.move_down();
+    view.remove(entities, collapser, root_handles);
+  }
+}
+
+BENCHMARK(add_remove_sibling_wide)->Range(1 << 10, 1 << 20);
+
+// rebuild a hierarchy with create_bench_entities (0) or by loading a snapshot
+// of it (1), the snapshot is mapped each iteration
+static void load_entities(benchmark::State& state) {
+  const int entity_count = state.range(0);
+  const bool from_snapshot = state.range(1) != 0;
+  const int depth = 8;
+
+  const auto path =
+    (std::filesystem::temp_directory_path() / "hierarchy-bench.snapshot")
+      .string();
+  {
+    thh::handle_vector_t<hy::entity_t> entities;
+    auto root_handles =
+      demo::create_bench_entities(entities, entity_count / depth, depth);
+    hy::save_snapshot(path, entities, root_handles, hy::collapser_t());
+  }
+
+  for ([[maybe_unused]] auto _ : state) {
+    thh::handle_vector_t<hy::entity_t> entities;
+    hy::collapser_t collapser;
+    if (from_snapshot) {
+      hy::snapshot_t snapshot;
+      snapshot.open(path);
+      auto root_handles = hy::load_snapshot(snapshot, entities, collapser);
+      benchmark::DoNotOptimize(root_handles.data());
+    } else {
+      auto root_handles =
+        demo::create_bench_entities(entities, entity_count / depth, depth);
+      benchmark::DoNotOptimize(root_handles.data());
+    }
+  }
+  std::remove(path.c_str());
+}
+
+BENCHMARK(load_entities)
+  ->ArgsProduct({{1 << 10, 1 << 16, 1 << 20}, {0, 1}})
+  ->ArgNames({"entities", "snapshot"})
+  ->Unit(benchmark::kMillisecond);
+
+// write line_count lines of a depth first hierarchy with ten children per
+// entity (seven levels deep) as an indented outline or a list of paths
+static void write_import_file(
+  const std::string& path, const hy::import_format_e format,
+  const int64_t line_count) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  std::string line;
+  std::vector<int> children = {0};
+  for (int64_t l = 0; l < line_count && !children.empty();) {
+    if (children.back() == 10 || children.size() > 7) {
+      children.pop_back();
+      continue;
+    }
+    const int child = children.back()++;
+    line.clear();
+    if (format == hy::import_format_e::indented) {
+      line.append(children.size() - 1, ' ');
+    } else {
+      for (size_t c = 0; c + 1 < children.size(); c++) {
+        line.append("node_").append(std::to_string(children[c] - 1));
+        line.push_back('/');
+      }
+    }
+    line.append("node_").append(std::to_string(child)).push_back('\n');
+    file << line;
+    children.push_back(0);
+    l++;
+  }
+}
+
+// import a generated file, reporting lines imported per second
+static void import_entities(benchmark::State& state) {
+  const int64_t line_count = state.range(0);
+  const auto format = static_cast<hy::import_format_e>(state.range(1));
+  const auto path =
+    (std::filesystem::temp_directory_path() / "hierarchy-bench.txt").string();
+  write_import_file(path, format, line_count);
+
+  for ([[maybe_unused]] auto _ : state) {
+    thh::handle_vector_t<hy::entity_t> entities;
+    std::vector<thh::handle_t> root_handles;
+    hy::import_file(path, format, entities, root_handles);
+    benchmark::DoNotOptimize(root_handles.data());
+  }
+  state.counters["lines_per_second"] = benchmark::Counter(
+    double(line_count), benchmark::Counter::kIsIterationInvariantRate);
+  std::remove(path.c_str());
+}
+
+BENCHMARK(import_entities)
+  ->ArgsProduct(
+    {{1 << 10, 1 << 20, 10'000'000},
+     {int64_t(hy::import_format_e::indented),
+      int64_t(hy::import_format_e::paths)}})
+  ->ArgNames({"lines", "format"})
+  ->Unit(benchmark::kMillisecond);
+
 BENCHMARK_MAIN();
@@ -1,8 +1,27 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 
+#include "hierarchy/draw-commands.hpp"
 #include "hierarchy/entity.hpp"
-
+#include "hierarchy/filtered-view.hpp"
+#include "hierarchy/frame-renderer.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+#include "hierarchy/importer.hpp"
+#include "hierarchy/journal.hpp"
+#include "hierarchy/name-index.hpp"
+#include "hierarchy/name-pool.hpp"
+#include "hierarchy/snapshot.hpp"
+#include "hierarchy/soa-hierarchy.hpp"
+#include "hierarchy/thread-pool.hpp"
+#include "hierarchy/virtual-view.hpp"
+#include "hierarchy/vt-buffer.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <unordered_map>
 #include <utility>
 
@@ -360,6 +379,27 @@ TEST_CASE("Scrollable Hierarchy Traversal") {
     }
   }
 
+  SUBCASE("collapsed state cleared when entity removed") {
+    view.add_child(entities, collapser);
+    view.collapse(entities, collapser);
+    const auto removed_handle = view.selected_handle();
+    CHECK(collapser.collapsed(removed_handle));
+    view.remove(entities, collapser, root_handles);
+    CHECK(collapser.expanded(removed_handle));
+  }
+
+  SUBCASE("collapsed state not shared with reused handle id") {
+    view.add_child(entities, collapser);
+    view.collapse(entities, collapser);
+    const auto removed_handle = view.selected_handle();
+    for (const auto& h : hy::entity_and_descendants(removed_handle, entities)) {
+      entities.remove(h);
+    }
+    const auto reused_handle = entities.add();
+    CHECK(collapser.collapsed(removed_handle));
+    CHECK(collapser.expanded(reused_handle));
+  }
+
   SUBCASE("child indents increase as hierarchy depth grows") {
     for (int i = 0; i < 5; ++i) {
       auto added_child = view.add_child(entities, collapser);
@@ -367,6 +407,22 @@ TEST_CASE("Scrollable Hierarchy Traversal") {
       view.move_down();
     }
   }
+
+  SUBCASE("recorded handle found when hidden by collapsed ancestors") {
+    repeat_n(3, [&] {
+      view.add_child(entities, collapser);
+      view.move_down();
+    });
+    view.record_handle();
+    const auto recorded_handle = view.recorded_handle();
+    repeat_n(3, [&] { view.move_up(); });
+    view.collapse(entities, collapser);
+    CHECK(view.flattened_handles().size() == 1);
+    view.goto_recorded_handle(entities, collapser);
+    CHECK(view.selected_handle() == recorded_handle);
+    CHECK(view.selected_index() == 3);
+    CHECK(view.flattened_handles().index_of(recorded_handle) == 3);
+  }
 }
 
 template<class T>
@@ -464,6 +520,16 @@ TEST_CASE("Scrollable Hierarchy Display") {
     CHECK(values[std::pair(0, 9)] == display_ops.mid_);
   }
 
+  SUBCASE("only visible handles drawn when scrolled") {
+    repeat_n(30, [&] { view.add_sibling(entities, collapser, root_handles); });
+    repeat_n(25, [&] { view.move_down(); });
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    // a row and name for each of the ten visible handles
+    CHECK(values.size() == 20);
+    CHECK(values[std::pair(0, 9)] == display_ops.mid_);
+  }
+
   SUBCASE("last visible handle drawn with end when scrolled into view") {
     repeat_n(10, [&] { view.add_sibling(entities, collapser, root_handles); });
     repeat_n(10, [&] { view.move_down(); });
@@ -637,4 +703,2497 @@ TEST_CASE("Scrollable Hierarchy Display") {
       CHECK(values.find(std::pair(0, offset + i)) == values.end());
     });
   }
+
+  SUBCASE("backend type draws the same as display ops") {
+    // records the same values as display_ops (inverted rows are tracked too)
+    struct backend_t {
+      void set_bold(bool) {}
+      void set_invert(const bool invert) { inverted_ = invert; }
+      void draw_glyph(const int x, const int y, const hy::glyph_e glyph) {
+        const std::string_view str = glyph == hy::glyph_e::connection ? "|"
+                                   : glyph == hy::glyph_e::end        ? "L"
+                                                                      : "-";
+        values_[std::pair(x, y)] = std::string(str);
+        last_x_ = x + str.size();
+        last_y_ = y;
+      }
+      void draw(const std::string_view str) {
+        values_[std::pair(last_x_, last_y_)] = std::string(str);
+        if (inverted_) {
+          inverted_row_ = last_y_;
+        }
+        last_x_ += str.size();
+      }
+      int indent_width() const { return 1; }
+
+      std::unordered_map<std::pair<int, int>, std::string, pair_hash> values_;
+      int last_x_ = 0;
+      int last_y_ = 0;
+      int inverted_row_ = -1;
+      bool inverted_ = false;
+    };
+
+    repeat_n(4, [&] {
+      view.add_sibling(entities, collapser, root_handles);
+      view.add_child(entities, collapser);
+      view.move_down();
+    });
+    repeat_n(2, [&] { view.move_up(); });
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    backend_t backend;
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, backend);
+    CHECK(backend.values_ == values);
+    CHECK(backend.inverted_row_ == *view.selected_index() - view.offset());
+  }
+}
+
+TEST_CASE("Struct of Arrays Hierarchy") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  // mirror create_sample_entities
+  hy::soa_hierarchy_t hierarchy;
+  std::vector<thh::handle_t> handles;
+  repeat_n(12, [&] { handles.push_back(hierarchy.add()); });
+  hy::add_children(handles[0], {handles[1], handles[2]}, hierarchy);
+  hy::add_children(handles[6], {handles[10]}, hierarchy);
+  hy::add_children(handles[7], {handles[3], handles[4]}, hierarchy);
+  hy::add_children(
+    handles[2], {handles[5], handles[6], handles[11]}, hierarchy);
+  hy::add_children(handles[8], {handles[9]}, hierarchy);
+
+  hy::collapser_t collapser;
+
+  const auto flattened_equal = [](const auto& lhs, const auto& rhs) {
+    return std::equal(
+      lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      [](const auto& l, const auto& r) {
+        return l.entity_handle_ == r.entity_handle_ && l.indent_ == r.indent_;
+      });
+  };
+
+  SUBCASE("flattened handles match entity hierarchy") {
+    CHECK(flattened_equal(
+      hy::flatten_entities(entities, collapser, root_handles),
+      hy::flatten_entities(hierarchy, collapser, root_handles)));
+  }
+
+  SUBCASE("flattened handles match entity hierarchy when collapsed") {
+    collapser.collapse(handles[2], hierarchy);
+    CHECK(collapser.collapsed(handles[2]));
+    CHECK(flattened_equal(
+      hy::flatten_entities(entities, collapser, root_handles),
+      hy::flatten_entities(hierarchy, collapser, root_handles)));
+    CHECK(
+      hy::expanded_count(handles[0], entities, collapser)
+      == hy::expanded_count(handles[0], hierarchy, collapser));
+  }
+
+  SUBCASE("siblings match entity hierarchy") {
+    CHECK(
+      hy::siblings(handles[6], entities, root_handles)
+      == hy::siblings(handles[6], hierarchy, root_handles));
+    CHECK(hy::siblings(handles[7], hierarchy, root_handles) == root_handles);
+  }
+
+  SUBCASE("removing entity removes descendants and unlinks from parent") {
+    CHECK(hierarchy.remove(handles[2]));
+    CHECK(hierarchy.size() == 7);
+    CHECK(!hierarchy.has_handle(handles[10]));
+    CHECK(hy::entity_and_descendants(handles[0], hierarchy).size() == 2);
+    CHECK(
+      hy::siblings(handles[1], hierarchy, root_handles)
+      == std::vector<thh::handle_t>{handles[1]});
+  }
+
+  SUBCASE("linking a parented entity or an ancestor is rejected") {
+    const auto flattened =
+      hy::flatten_entities(hierarchy, collapser, root_handles);
+    CHECK(!hierarchy.link(handles[7].id_, handles[6].id_));
+    CHECK(!hierarchy.link(handles[10].id_, handles[0].id_));
+    CHECK(!hierarchy.link(handles[9].id_, handles[8].id_));
+    CHECK(!hierarchy.link(handles[8].id_, handles[8].id_));
+    hy::add_children(handles[10], {handles[0], handles[2]}, hierarchy);
+    CHECK(flattened_equal(
+      flattened, hy::flatten_entities(hierarchy, collapser, root_handles)));
+    CHECK(hierarchy.parent(handles[0].id_) == hy::soa_hierarchy_t::null_slot);
+  }
+}
+
+TEST_CASE("Name Pool") {
+  hy::name_pool_t name_pool;
+
+  SUBCASE("duplicate names are interned") {
+    const auto first = name_pool.intern("entity");
+    const auto second = name_pool.intern("entity");
+    CHECK(first == second);
+    CHECK(name_pool.size() == 1);
+    CHECK(name_pool.name(first) == "entity");
+  }
+
+  SUBCASE("name kept until all references are released") {
+    const auto first = name_pool.intern("entity");
+    name_pool.intern("entity");
+    name_pool.release(first);
+    CHECK(name_pool.name(first) == "entity");
+    name_pool.release(first);
+    CHECK(name_pool.size() == 0);
+  }
+
+  SUBCASE("rename to existing name shares storage") {
+    const auto first = name_pool.intern("first");
+    const auto second = name_pool.intern("second");
+    const auto renamed = name_pool.rename(first, "second");
+    CHECK(renamed == second);
+    CHECK(name_pool.size() == 1);
+  }
+
+  SUBCASE("releasing a released name is ignored") {
+    const auto first = name_pool.intern("first");
+    const auto second = name_pool.intern("second");
+    name_pool.release(first);
+    name_pool.release(first);
+    CHECK(name_pool.size() == 1);
+    CHECK(name_pool.name(second) == "second");
+    CHECK(name_pool.intern("second") == second);
+    CHECK(name_pool.intern("first") == first);
+    name_pool.release(first);
+    name_pool.release(first);
+    CHECK(name_pool.intern("first") == first);
+    CHECK(name_pool.size() == 2);
+  }
+
+  SUBCASE("repeated renames do not grow buffer unbounded") {
+    auto id = name_pool.intern("entity_0");
+    repeat_n_it(100000, [&](size_t i) {
+      id = name_pool.rename(id, std::string("entity_") + std::to_string(i));
+    });
+    CHECK(name_pool.name(id) == "entity_99999");
+    CHECK(name_pool.size() == 1);
+    CHECK(name_pool.buffer_size() < 16384);
+  }
+
+  SUBCASE("struct of arrays hierarchy names released on remove") {
+    hy::soa_hierarchy_t hierarchy;
+    const auto roots = demo::create_bench_entities(hierarchy, 1, 10);
+    CHECK(hierarchy.name(roots.front()) == "entity_0");
+    CHECK(hierarchy.names().size() == 10);
+    hierarchy.remove(roots.front());
+    CHECK(hierarchy.names().size() == 0);
+  }
+}
+
+TEST_CASE("Expanded Count") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 10);
+
+  // recompute without any cached counts
+  const auto uncached_expanded_count = [&](const thh::handle_t handle) {
+    auto uncached_collapser = collapser;
+    uncached_collapser.clear_expanded_counts();
+    return hy::expanded_count(handle, entities, uncached_collapser);
+  };
+
+  SUBCASE("expanded count matches flattened handles") {
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 7);
+    CHECK(
+      hy::expanded_count(thh::handle_t(2, 0), entities, collapser)
+      == (int)hy::flatten_entity(thh::handle_t(2, 0), 0, entities, collapser)
+           .size());
+  }
+
+  SUBCASE("expanded count updated after collapse and expand") {
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 7);
+    collapser.collapse(thh::handle_t(2, 0), entities);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 3);
+    collapser.collapse(thh::handle_t(6, 0), entities);
+    collapser.expand(thh::handle_t(2, 0), entities);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 6);
+    CHECK(
+      hy::expanded_count(root_handles[0], entities, collapser)
+      == uncached_expanded_count(root_handles[0]));
+  }
+
+  SUBCASE("expanded count updated after view edits") {
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 7);
+    repeat_n(3, [&] { view.add_child(entities, collapser); });
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 10);
+    view.move_down();
+    view.add_sibling(entities, collapser, root_handles);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 11);
+    view.move_down();
+    // removes entity 2 and its four descendants
+    view.remove(entities, collapser, root_handles);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 6);
+    CHECK(
+      hy::expanded_count(root_handles[0], entities, collapser)
+      == uncached_expanded_count(root_handles[0]));
+  }
+
+  SUBCASE("expanded count updated when children added with collapser") {
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 7);
+    // entity 8 and its child are moved below entity 6
+    hy::add_children(
+      thh::handle_t(6, 0), {thh::handle_t(8, 0)}, entities, &collapser);
+    root_handles.pop_back();
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 9);
+    hy::add_children(
+      thh::handle_t(5, 0), {entities.add(), entities.add()}, entities,
+      &collapser);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 11);
+    CHECK(
+      hy::expanded_count(thh::handle_t(2, 0), entities, collapser)
+      == uncached_expanded_count(thh::handle_t(2, 0)));
+    // rows added below a collapsed entity don't change its ancestors
+    collapser.collapse(thh::handle_t(2, 0), entities);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 3);
+    hy::add_children(
+      thh::handle_t(5, 0), {entities.add()}, entities, &collapser);
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 3);
+  }
+
+  SUBCASE("removal deferred until reclaimed") {
+    collapser.collapse(thh::handle_t(6, 0), entities);
+    hy::view_t deferred_view(
+      hy::flatten_entities(entities, collapser, root_handles), 0, 10);
+    repeat_n(2, [&] { deferred_view.move_down(); });
+    hy::entity_reclaimer_t reclaimer;
+    // unlinks entity 2 and erases its rows, its entities are kept
+    deferred_view.remove(entities, collapser, root_handles, reclaimer);
+    CHECK(deferred_view.flattened_handles().size() == 7);
+    CHECK(deferred_view.selected_handle() == thh::handle_t(7, 0));
+    CHECK(
+      hy::child_handles(root_handles[0], entities)
+      == std::vector<thh::handle_t>{thh::handle_t(1, 0)});
+    CHECK(hy::expanded_count(root_handles[0], entities, collapser) == 2);
+    CHECK(entities.size() == 12);
+
+    CHECK(reclaimer.reclaim(2, entities, collapser) == 2);
+    CHECK(entities.size() == 10);
+    CHECK(!reclaimer.empty());
+    reclaimer.reclaim_all(entities, collapser);
+    CHECK(entities.size() == 7);
+    CHECK(reclaimer.empty());
+    CHECK(collapser.expanded(thh::handle_t(6, 0)));
+    CHECK(
+      hy::expanded_count(root_handles[0], entities, collapser)
+      == uncached_expanded_count(root_handles[0]));
+    const auto flattened =
+      hy::flatten_entities(entities, collapser, root_handles);
+    CHECK(std::equal(
+      flattened.begin(), flattened.end(),
+      deferred_view.flattened_handles().begin(),
+      deferred_view.flattened_handles().end(),
+      [](const auto& lhs, const auto& rhs) {
+        return lhs.entity_handle_ == rhs.entity_handle_
+            && lhs.indent_ == rhs.indent_;
+      }));
+  }
+
+  SUBCASE("view stays consistent through sequence of edits") {
+    uint32_t seed = 42;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 16;
+    };
+    repeat_n(2000, [&] {
+      switch (next() % 8) {
+        case 0:
+          view.add_child(entities, collapser);
+          break;
+        case 1:
+          view.add_sibling(entities, collapser, root_handles);
+          break;
+        case 2:
+          view.collapse(entities, collapser);
+          break;
+        case 3:
+          view.expand(entities, collapser);
+          break;
+        case 4:
+          if (next() % 4 == 0) {
+            view.remove(entities, collapser, root_handles);
+          }
+          break;
+        case 5:
+          view.move_up();
+          break;
+        default:
+          view.move_down();
+          break;
+      }
+      if (view.selected_handle() != thh::handle_t()) {
+        const auto root = hy::root_handle(view.selected_handle(), entities);
+        REQUIRE(
+          hy::expanded_count(root.first, entities, collapser)
+          == uncached_expanded_count(root.first));
+      }
+    });
+    const auto flattened =
+      hy::flatten_entities(entities, collapser, root_handles);
+    CHECK(std::equal(
+      flattened.begin(), flattened.end(), view.flattened_handles().begin(),
+      view.flattened_handles().end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.entity_handle_ == rhs.entity_handle_
+            && lhs.indent_ == rhs.indent_;
+      }));
+    bool indexed = true;
+    for (int i = 0; i < (int)flattened.size(); i++) {
+      indexed = indexed
+             && view.flattened_handles().index_of(
+                  flattened[i].entity_handle_)
+                  == i;
+    }
+    CHECK(indexed);
+  }
+}
+
+TEST_CASE("Flattened Handles") {
+  std::vector<hy::flattened_handle_t> expected;
+  repeat_n_it(1000, [&](size_t i) {
+    expected.push_back({thh::handle_t((int32_t)i, 0), (int32_t)(i % 7)});
+  });
+  hy::flattened_handles_t flattened_handles(expected);
+
+  const auto matches_expected = [&] {
+    return (int)expected.size() == flattened_handles.size()
+        && std::equal(
+             expected.begin(), expected.end(), flattened_handles.begin(),
+             flattened_handles.end(), [](const auto& lhs, const auto& rhs) {
+               return lhs.entity_handle_ == rhs.entity_handle_
+                   && lhs.indent_ == rhs.indent_;
+             });
+  };
+
+  const auto make_handles = [](const int first_id, const int count) {
+    std::vector<hy::flattened_handle_t> handles;
+    repeat_n_it(count, [&](size_t i) {
+      handles.push_back({thh::handle_t(first_id + (int32_t)i, 0), 1});
+    });
+    return handles;
+  };
+
+  SUBCASE("constructed from vector") {
+    CHECK(flattened_handles.size() == 1000);
+    CHECK(matches_expected());
+    CHECK(flattened_handles[500].entity_handle_ == thh::handle_t(500, 0));
+  }
+
+  SUBCASE("rows inserted at front middle and back") {
+    for (const int index : {0, 500, 1200}) {
+      const auto handles = make_handles(10000 + index, 300);
+      expected.insert(expected.begin() + index, handles.begin(), handles.end());
+      flattened_handles.insert(
+        index, handles.data(), handles.data() + handles.size());
+    }
+    CHECK(matches_expected());
+  }
+
+  SUBCASE("rows erased across chunks") {
+    expected.erase(expected.begin() + 100, expected.begin() + 700);
+    flattened_handles.erase(100, 700);
+    CHECK(matches_expected());
+    expected.erase(expected.begin(), expected.end());
+    flattened_handles.erase(0, flattened_handles.size());
+    CHECK(flattened_handles.empty());
+  }
+
+  SUBCASE("reverse iteration matches") {
+    CHECK(std::equal(
+      expected.rbegin(), expected.rend(), flattened_handles.rbegin(),
+      flattened_handles.rend(), [](const auto& lhs, const auto& rhs) {
+        return lhs.entity_handle_ == rhs.entity_handle_;
+      }));
+  }
+
+  SUBCASE("sequence of edits matches vector") {
+    uint32_t seed = 7;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 8;
+    };
+    int next_id = 1000;
+    repeat_n(2000, [&] {
+      const int size = (int)expected.size();
+      if (next() % 2 == 0 || size == 0) {
+        const int index = next() % (size + 1);
+        const auto handles = make_handles(next_id, 1 + next() % 200);
+        next_id += (int)handles.size();
+        expected.insert(
+          expected.begin() + index, handles.begin(), handles.end());
+        flattened_handles.insert(
+          index, handles.data(), handles.data() + handles.size());
+      } else {
+        const int first = next() % size;
+        const int last = first + next() % std::min(200, size - first + 1);
+        expected.erase(expected.begin() + first, expected.begin() + last);
+        flattened_handles.erase(first, last);
+      }
+    });
+    CHECK(matches_expected());
+    std::vector<int> expected_indices(next_id, -1);
+    for (int i = 0; i < (int)expected.size(); i++) {
+      expected_indices[expected[i].entity_handle_.id_] = i;
+    }
+    bool indexed = true;
+    for (int id = 0; id < next_id; id++) {
+      const auto index = flattened_handles.index_of(thh::handle_t(id, 0));
+      indexed = indexed && index.value_or(-1) == expected_indices[id];
+    }
+    CHECK(indexed);
+  }
+}
+
+TEST_CASE("Virtual View") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  // each view records collapse state separately so they can be compared
+  hy::collapser_t collapser;
+  hy::collapser_t virtual_collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 5);
+  hy::virtual_view_t virtual_view(
+    entities, virtual_collapser, root_handles, 0, 5);
+
+  const auto matches_view = [&] {
+    if (
+      virtual_view.offset() != view.offset()
+      || virtual_view.selected_index() != view.selected_index()) {
+      return false;
+    }
+    const auto& flattened_handles = view.flattened_handles();
+    const int count = std::min(
+      flattened_handles.size() - view.offset(), view.count());
+    const auto& virtual_handles = virtual_view.flattened_handles();
+    return (int)virtual_handles.size() == count
+        && std::equal(
+             virtual_handles.begin(), virtual_handles.end(),
+             flattened_handles.begin() + view.offset(),
+             [](const auto& lhs, const auto& rhs) {
+               return lhs.entity_handle_ == rhs.entity_handle_
+                   && lhs.indent_ == rhs.indent_;
+             });
+  };
+
+  SUBCASE("only visible rows materialized") {
+    CHECK(virtual_view.flattened_handles().size() == 5);
+    CHECK(virtual_view.selected_handle() == root_handles[0]);
+    CHECK(matches_view());
+  }
+
+  SUBCASE("flattened handles found by index and neighbors") {
+    const auto flattened_handles =
+      hy::flatten_entities(entities, collapser, root_handles);
+    CHECK(
+      hy::flattened_handle_count(entities, collapser, root_handles)
+      == (int)flattened_handles.size());
+    for (int i = 0; i < (int)flattened_handles.size(); i++) {
+      const auto at =
+        hy::flattened_handle_at(i, entities, collapser, root_handles);
+      REQUIRE(at.has_value());
+      CHECK(at->entity_handle_ == flattened_handles[i].entity_handle_);
+      CHECK(at->indent_ == flattened_handles[i].indent_);
+      const auto next = hy::next_flattened_handle(
+        flattened_handles[i], entities, collapser, root_handles);
+      CHECK(next.has_value() == (i + 1 < (int)flattened_handles.size()));
+      if (next.has_value()) {
+        CHECK(next->entity_handle_ == flattened_handles[i + 1].entity_handle_);
+      }
+      const auto prev = hy::prev_flattened_handle(
+        flattened_handles[i], entities, collapser, root_handles);
+      CHECK(prev.has_value() == (i > 0));
+      if (prev.has_value()) {
+        CHECK(prev->entity_handle_ == flattened_handles[i - 1].entity_handle_);
+      }
+    }
+    CHECK(!hy::flattened_handle_at(
+             (int)flattened_handles.size(), entities, collapser, root_handles)
+             .has_value());
+  }
+
+  SUBCASE("go to offset clamped to keep view full") {
+    virtual_view.go_to_offset(100, entities, virtual_collapser, root_handles);
+    CHECK(virtual_view.offset() == 7);
+    CHECK(virtual_view.selected_index() == 7);
+    CHECK(virtual_view.flattened_handles().size() == 5);
+    virtual_view.go_to_offset(3, entities, virtual_collapser, root_handles);
+    CHECK(virtual_view.offset() == 3);
+    CHECK(
+      virtual_view.flattened_handles().front().entity_handle_
+      == view.flattened_handles()[3].entity_handle_);
+  }
+
+  SUBCASE("virtual view matches view through moves expands and collapses") {
+    uint32_t seed = 11;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 16;
+    };
+    bool matches = true;
+    repeat_n(2000, [&] {
+      switch (next() % 4) {
+        case 0:
+          view.move_up();
+          virtual_view.move_up(entities, virtual_collapser, root_handles);
+          break;
+        case 1:
+          view.move_down();
+          virtual_view.move_down(entities, virtual_collapser, root_handles);
+          break;
+        case 2:
+          view.collapse(entities, collapser);
+          virtual_view.collapse(entities, virtual_collapser, root_handles);
+          break;
+        case 3:
+          view.expand(entities, collapser);
+          virtual_view.expand(entities, virtual_collapser, root_handles);
+          break;
+      }
+      matches = matches && matches_view();
+    });
+    CHECK(matches);
+  }
+
+  SUBCASE("virtual view drawn the same as view") {
+    using values_t =
+      std::unordered_map<std::pair<int, int>, std::string, pair_hash>;
+    const auto draw = [&](values_t& values, const auto& drawn_view,
+                          const hy::collapser_t& drawn_collapser) {
+      int last_x = 0;
+      int last_y = 0;
+      hy::display_ops_t display_ops;
+      display_ops.connection_ = "|";
+      display_ops.end_ = "L";
+      display_ops.mid_ = "-";
+      display_ops.set_bold_fn_ = [](bool) {};
+      display_ops.set_invert_fn_ = [](bool) {};
+      display_ops.draw_fn_ = [&](const std::string_view str) {
+        values[std::pair(last_x, last_y)] = std::string(str);
+        last_x += str.size();
+      };
+      display_ops.draw_at_fn_ =
+        [&](const int x, const int y, const std::string_view str) {
+          values[std::pair(x, y)] = std::string(str);
+          last_x = x + str.size();
+          last_y = y;
+        };
+      hy::display_scrollable_hierarchy(
+        entities, root_handles, drawn_view, drawn_collapser, display_ops);
+    };
+
+    repeat_n(6, [&] {
+      view.move_down();
+      virtual_view.move_down(entities, virtual_collapser, root_handles);
+    });
+    view.collapse(entities, collapser);
+    virtual_view.collapse(entities, virtual_collapser, root_handles);
+    repeat_n(3, [&] {
+      view.move_up();
+      virtual_view.move_up(entities, virtual_collapser, root_handles);
+    });
+    REQUIRE(matches_view());
+
+    values_t values;
+    values_t virtual_values;
+    draw(values, view, collapser);
+    draw(virtual_values, virtual_view, virtual_collapser);
+    CHECK(values == virtual_values);
+  }
+}
+
+TEST_CASE("Parallel Flatten") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+  const auto bench_root_handles =
+    demo::create_bench_entities(entities, 100, 10);
+  root_handles.insert(
+    root_handles.end(), bench_root_handles.begin(), bench_root_handles.end());
+
+  hy::collapser_t collapser;
+  collapser.collapse(thh::handle_t(2, 0), entities);
+  repeat_n_it(root_handles.size(), [&](size_t i) {
+    if (i % 3 == 0) {
+      collapser.collapse(root_handles[i], entities);
+    }
+  });
+
+  const auto matches_serial = [&](hy::thread_pool_t& thread_pool) {
+    const auto serial =
+      hy::flatten_entities(entities, collapser, root_handles);
+    const auto parallel =
+      hy::flatten_entities(entities, collapser, root_handles, thread_pool);
+    return std::equal(
+      serial.begin(), serial.end(), parallel.begin(), parallel.end(),
+      [](const auto& lhs, const auto& rhs) {
+        return lhs.entity_handle_ == rhs.entity_handle_
+            && lhs.indent_ == rhs.indent_;
+      });
+  };
+
+  SUBCASE("parallel flatten matches serial flatten") {
+    for (const int thread_count : {1, 2, 4, 7}) {
+      hy::thread_pool_t thread_pool(thread_count);
+      CHECK(thread_pool.thread_count() == thread_count);
+      CHECK(matches_serial(thread_pool));
+      // pool can be reused
+      CHECK(matches_serial(thread_pool));
+    }
+  }
+
+  SUBCASE("parallel flatten of no roots is empty") {
+    hy::thread_pool_t thread_pool(4);
+    root_handles.clear();
+    CHECK(
+      hy::flatten_entities(entities, collapser, root_handles, thread_pool)
+        .empty());
+  }
+
+  SUBCASE("thread pool visits every index once") {
+    hy::thread_pool_t thread_pool(4);
+    std::vector<std::atomic<int>> visits(1000);
+    thread_pool.for_each(
+      (int)visits.size(), [&visits](const int i) { visits[i]++; });
+    CHECK(std::all_of(visits.begin(), visits.end(), [](const auto& visit) {
+      return visit == 1;
+    }));
+  }
+}
+
+TEST_CASE("Draw Commands") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 8);
+  view.move_down();
+  view.move_down();
+  view.collapse(entities, collapser);
+
+  using values_t =
+    std::unordered_map<std::pair<int, int>, std::string, pair_hash>;
+  int last_x = 0;
+  int last_y = 0;
+  int bold_count = 0;
+  values_t values;
+  hy::display_ops_t display_ops;
+  display_ops.connection_ = "|";
+  display_ops.end_ = "L";
+  display_ops.mid_ = "-";
+  display_ops.set_bold_fn_ = [&bold_count](const bool bold) {
+    bold_count += bold;
+  };
+  display_ops.set_invert_fn_ = [](bool) {};
+  display_ops.draw_fn_ = [&](const std::string_view str) {
+    values[std::pair(last_x, last_y)] = std::string(str);
+    last_x += str.size();
+  };
+  display_ops.draw_at_fn_ =
+    [&](const int x, const int y, const std::string_view str) {
+      values[std::pair(x, y)] = std::string(str);
+      last_x = x + str.size();
+      last_y = y;
+    };
+
+  hy::draw_commands_t draw_commands;
+  hy::display_scrollable_hierarchy(
+    entities, root_handles, view, collapser, draw_commands);
+
+  SUBCASE("replayed commands match display ops") {
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    const values_t expected = values;
+    values.clear();
+    const std::string_view glyphs[] = {"|", "L", "-"};
+    int replayed_bold_count = 0;
+    for (const auto& command : draw_commands.commands()) {
+      switch (command.type_) {
+        case hy::draw_command_t::type_e::glyph:
+          display_ops.draw_at_fn_(
+            command.x_, command.y_, glyphs[static_cast<int>(command.glyph_)]);
+          break;
+        case hy::draw_command_t::type_e::text:
+          display_ops.draw_fn_(draw_commands.text(command));
+          break;
+        case hy::draw_command_t::type_e::bold:
+          replayed_bold_count += command.enabled_;
+          break;
+        case hy::draw_command_t::type_e::invert:
+          break;
+      }
+    }
+    CHECK(values == expected);
+    CHECK(replayed_bold_count == bold_count);
+  }
+
+  SUBCASE("only attribute changes recorded") {
+    const auto& commands = draw_commands.commands();
+    const auto count = [&commands](const hy::draw_command_t::type_e type) {
+      return std::count_if(
+        commands.begin(), commands.end(),
+        [type](const auto& command) { return command.type_ == type; });
+    };
+    // selected row inverted and collapsed row bold (the same row)
+    CHECK(count(hy::draw_command_t::type_e::invert) == 2);
+    CHECK(count(hy::draw_command_t::type_e::bold) == 2);
+    CHECK(count(hy::draw_command_t::type_e::text) == 8);
+  }
+
+  SUBCASE("buffers reused across frames") {
+    const auto* commands = draw_commands.commands().data();
+    const auto size = draw_commands.commands().size();
+    draw_commands.clear();
+    CHECK(draw_commands.commands().empty());
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, draw_commands);
+    CHECK(draw_commands.commands().data() == commands);
+    CHECK(draw_commands.commands().size() == size);
+    CHECK(draw_commands.text(draw_commands.commands()[1]) == "entity_0");
+  }
+}
+
+// terminal holding the characters and attributes (b)old/(i)nverted on screen
+struct test_terminal_t {
+  explicit test_terminal_t(const int rows)
+    : chars_(rows), attributes_(rows) {}
+
+  void scroll(const int first_row, const int last_row, const int rows) {
+    scrolls_++;
+    for (auto* lines : {&chars_, &attributes_}) {
+      auto first = lines->begin() + first_row;
+      auto last = lines->begin() + last_row + 1;
+      if (rows > 0) {
+        std::rotate(first, first + rows, last);
+        std::fill(last - rows, last, std::string());
+      } else {
+        std::rotate(first, last + rows, last);
+        std::fill(first, first - rows, std::string());
+      }
+    }
+  }
+  void clear_row(const int row) {
+    cleared_rows_++;
+    chars_[row].clear();
+    attributes_[row].clear();
+  }
+  void set_bold(const bool bold) { bold_ = bold; }
+  void set_invert(const bool invert) { invert_ = invert; }
+  void draw_glyph(const int x, const int y, const hy::glyph_e glyph) {
+    const std::string_view glyphs[] = {"|", "L ", "- "};
+    x_ = x;
+    y_ = y;
+    draw(glyphs[static_cast<int>(glyph)]);
+  }
+  void draw(const std::string_view str) {
+    auto& chars = chars_[y_];
+    auto& attributes = attributes_[y_];
+    const size_t end = x_ + str.size();
+    chars.resize(std::max(chars.size(), end), ' ');
+    attributes.resize(std::max(attributes.size(), end), ' ');
+    chars.replace(x_, str.size(), str);
+    attributes.replace(
+      x_, str.size(), str.size(), invert_ ? 'i' : (bold_ ? 'b' : ' '));
+    x_ = end;
+  }
+
+  std::vector<std::string> chars_;
+  std::vector<std::string> attributes_;
+  int scrolls_ = 0;
+  int cleared_rows_ = 0;
+  int x_ = 0;
+  int y_ = 0;
+  bool bold_ = false;
+  bool invert_ = false;
+};
+
+TEST_CASE("Frame Renderer") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  const int row_count = 4;
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, row_count);
+
+  hy::draw_commands_t draw_commands;
+  hy::frame_renderer_t frame_renderer;
+  test_terminal_t terminal(row_count);
+
+  const auto render = [&] {
+    terminal.scrolls_ = 0;
+    terminal.cleared_rows_ = 0;
+    draw_commands.clear();
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, draw_commands);
+    frame_renderer.render(
+      draw_commands, view.offset(), view.count(), terminal);
+  };
+
+  // what a full redraw of the current frame puts on screen
+  const auto check_screen = [&] {
+    hy::frame_renderer_t full_renderer;
+    test_terminal_t full_terminal(row_count);
+    full_renderer.render(
+      draw_commands, view.offset(), view.count(), full_terminal);
+    CHECK(terminal.chars_ == full_terminal.chars_);
+    CHECK(terminal.attributes_ == full_terminal.attributes_);
+  };
+
+  render();
+  CHECK(terminal.cleared_rows_ == row_count);
+  CHECK(terminal.scrolls_ == 0);
+  check_screen();
+
+  SUBCASE("unchanged frame draws nothing") {
+    render();
+    CHECK(terminal.cleared_rows_ == 0);
+    CHECK(terminal.scrolls_ == 0);
+  }
+
+  SUBCASE("moving selection redraws old and new rows") {
+    view.move_down();
+    render();
+    CHECK(terminal.cleared_rows_ == 2);
+    check_screen();
+  }
+
+  SUBCASE("moving offset by one scrolls") {
+    repeat_n(row_count - 1, [&] {
+      view.move_down();
+      render();
+    });
+    const int offset = view.offset();
+    view.move_down();
+    render();
+    REQUIRE(view.offset() == offset + 1);
+    CHECK(terminal.scrolls_ == 1);
+    // the row scrolled into view and the row losing the selection
+    CHECK(terminal.cleared_rows_ == 2);
+    check_screen();
+
+    view.move_up();
+    render();
+    CHECK(terminal.scrolls_ == 0);
+    check_screen();
+
+    repeat_n(row_count - 1, [&] {
+      view.move_up();
+      render();
+    });
+    REQUIRE(view.offset() == offset);
+    CHECK(terminal.scrolls_ == 1);
+    check_screen();
+  }
+
+  SUBCASE("collapsing redraws rows after the change") {
+    view.move_down();
+    render();
+    view.collapse(entities, collapser);
+    render();
+    CHECK(terminal.scrolls_ == 0);
+    check_screen();
+  }
+
+  SUBCASE("invalidate redraws every row") {
+    frame_renderer.invalidate();
+    render();
+    CHECK(terminal.cleared_rows_ == row_count);
+    check_screen();
+  }
+}
+
+TEST_CASE("VT Buffer") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 4);
+  view.move_down();
+
+  hy::vt_buffer_t vt_buffer;
+  vt_buffer.connection_ = "|";
+  vt_buffer.end_ = "L ";
+  vt_buffer.mid_ = "- ";
+  vt_buffer.indent_width_ = 2;
+
+  SUBCASE("frame written as escape sequences") {
+    vt_buffer.begin_frame();
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, vt_buffer);
+    CHECK(
+      vt_buffer.bytes()
+      == "\x1b[1;1H\x1b[0J"
+         "\x1b[1;1H- entity_0"
+         "\x1b[2;1H|\x1b[2;3H- \x1b[7mentity_1\x1b[27m"
+         "\x1b[3;1H|\x1b[3;3HL entity_2"
+         "\x1b[4;1H|\x1b[4;5H- entity_5");
+  }
+
+  SUBCASE("display ops write the same bytes") {
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, vt_buffer);
+    const std::string expected = vt_buffer.bytes();
+    vt_buffer.clear();
+    CHECK(vt_buffer.bytes().empty());
+    const auto display_ops = hy::vt_display_ops(vt_buffer);
+    hy::display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, display_ops);
+    CHECK(vt_buffer.bytes() == expected);
+  }
+
+  SUBCASE("frame renderer terminal") {
+    vt_buffer.scroll(0, 3, 1);
+    vt_buffer.scroll(0, 3, -2);
+    vt_buffer.clear_row(2);
+    CHECK(
+      vt_buffer.bytes()
+      == "\x1b[1;4r\x1b[1S\x1b[r\x1b[1;4r\x1b[2T\x1b[r\x1b[3;1H\x1b[2K");
+  }
+}
+
+TEST_CASE("Snapshot") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+  view.move_down();
+  view.move_down();
+  view.collapse(entities, collapser); // entity_2
+
+  const auto path =
+    (std::filesystem::temp_directory_path() / "hierarchy-test.snapshot")
+      .string();
+  REQUIRE(hy::save_snapshot(path, entities, root_handles, collapser));
+
+  hy::snapshot_t snapshot;
+  REQUIRE(snapshot.open(path));
+
+  SUBCASE("entities stored breadth first") {
+    CHECK(snapshot.entity_count() == entities.size());
+    CHECK(snapshot.root_count() == 3);
+    CHECK(snapshot.name(0) == "entity_0");
+    CHECK(snapshot.name(1) == "entity_7");
+    CHECK(snapshot.name(2) == "entity_8");
+    CHECK(snapshot.parent(0) == -1);
+    CHECK(snapshot.child_count(0) == 2);
+    const int32_t first_child = snapshot.first_child(0);
+    CHECK(snapshot.name(first_child) == "entity_1");
+    CHECK(snapshot.name(first_child + 1) == "entity_2");
+    CHECK(snapshot.parent(first_child + 1) == 0);
+    CHECK(snapshot.collapsed(first_child + 1));
+    CHECK(!snapshot.collapsed(first_child));
+  }
+
+  SUBCASE("loaded hierarchy displays the same") {
+    thh::handle_vector_t<hy::entity_t> loaded_entities;
+    hy::collapser_t loaded_collapser;
+    const auto loaded_root_handles =
+      hy::load_snapshot(snapshot, loaded_entities, loaded_collapser);
+    const auto names_and_indents =
+      [](
+        const thh::handle_vector_t<hy::entity_t>& entities,
+        const std::vector<thh::handle_t>& root_handles,
+        const hy::collapser_t& collapser) {
+        std::vector<std::pair<std::string, int>> result;
+        for (const auto& flattened_handle :
+             hy::flatten_entities(entities, collapser, root_handles)) {
+          entities.call(flattened_handle.entity_handle_, [&](const auto& e) {
+            result.emplace_back(e.name_, flattened_handle.indent_);
+          });
+        }
+        return result;
+      };
+    CHECK(loaded_entities.size() == entities.size());
+    CHECK(loaded_root_handles.size() == root_handles.size());
+    CHECK(
+      names_and_indents(loaded_entities, loaded_root_handles, loaded_collapser)
+      == names_and_indents(entities, root_handles, collapser));
+  }
+
+  SUBCASE("invalid files are rejected") {
+    const auto invalid_path = path + ".invalid";
+    {
+      std::ofstream file(invalid_path, std::ios::binary | std::ios::trunc);
+      file << "not a snapshot";
+    }
+    hy::snapshot_t invalid_snapshot;
+    CHECK(!invalid_snapshot.open(invalid_path));
+    CHECK(invalid_snapshot.entity_count() == 0);
+    CHECK(!invalid_snapshot.open(path + ".missing"));
+    std::remove(invalid_path.c_str());
+  }
+
+  SUBCASE("out of range indices and name offsets are rejected") {
+    std::string bytes;
+    {
+      std::ifstream file(path, std::ios::binary);
+      bytes.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    // mirrors the snapshot layout, a 24 byte header followed by the parent,
+    // first child, child count and name offset arrays
+    const int32_t entity_count = snapshot.entity_count();
+    enum { parent, first_child, child_count, name_offset };
+    const auto opens_with = [&](
+                              const int array, const int32_t index,
+                              const int32_t value, const size_t size = 0) {
+      auto corrupted = bytes;
+      const size_t offset =
+        24 + sizeof(int32_t) * (size_t(array) * entity_count + index);
+      std::memcpy(corrupted.data() + offset, &value, sizeof value);
+      if (size != 0) {
+        corrupted.resize(size);
+      }
+      const auto corrupted_path = path + ".corrupted";
+      {
+        std::ofstream file(
+          corrupted_path, std::ios::binary | std::ios::trunc);
+        file.write(corrupted.data(), corrupted.size());
+      }
+      hy::snapshot_t corrupted_snapshot;
+      const bool opened = corrupted_snapshot.open(corrupted_path);
+      corrupted_snapshot.close();
+      std::remove(corrupted_path.c_str());
+      return opened;
+    };
+
+    const int32_t first_child_of_root = snapshot.first_child(0);
+    CHECK(opens_with(parent, first_child_of_root, 0));
+    CHECK(!opens_with(parent, first_child_of_root, 0, bytes.size() - 1));
+    CHECK(!opens_with(parent, first_child_of_root, entity_count));
+    CHECK(!opens_with(parent, first_child_of_root, -2));
+    CHECK(!opens_with(parent, first_child_of_root, 1));
+    CHECK(!opens_with(parent, 0, 1));
+    // a child can't come before its parent
+    CHECK(!opens_with(parent, 1, first_child_of_root));
+    CHECK(!opens_with(first_child, 0, entity_count - 1));
+    CHECK(!opens_with(first_child, 0, -1));
+    CHECK(!opens_with(first_child, 0, first_child_of_root + 1));
+    CHECK(!opens_with(child_count, 0, -1));
+    CHECK(!opens_with(child_count, 0, std::numeric_limits<int32_t>::max()));
+    CHECK(!opens_with(child_count, 0, 3));
+    CHECK(!opens_with(name_offset, 0, -1));
+    CHECK(!opens_with(name_offset, 1, int32_t(snapshot.name(0).size()) + 100));
+    CHECK(!opens_with(name_offset, entity_count, int32_t(bytes.size()) + 1));
+  }
+
+  snapshot.close();
+  std::remove(path.c_str());
+}
+
+TEST_CASE("Importer") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  std::vector<thh::handle_t> root_handles;
+
+  // name and indent of each row of the fully expanded hierarchy
+  const auto rows = [&] {
+    std::vector<std::pair<std::string, int>> result;
+    for (const auto& flattened_handle :
+         hy::flatten_entities(entities, hy::collapser_t(), root_handles)) {
+      entities.call(flattened_handle.entity_handle_, [&](const auto& entity) {
+        result.emplace_back(entity.name_, flattened_handle.indent_);
+      });
+    }
+    return result;
+  };
+
+  const std::vector<std::pair<std::string, int>> expected = {
+    {"a", 0}, {"b", 1}, {"c", 2}, {"d", 2}, {"e", 1}, {"f", 0}, {"g", 1}};
+
+  SUBCASE("indented") {
+    hy::importer_t importer(
+      hy::import_format_e::indented, entities, root_handles);
+    importer.feed("a\n  b\n    c\r\n    d\n\n  e\nf\n\tg");
+    importer.finish();
+    CHECK(importer.line_count() == 8);
+    CHECK(rows() == expected);
+  }
+
+  SUBCASE("paths") {
+    hy::importer_t importer(hy::import_format_e::paths, entities, root_handles);
+    importer.feed("a\na/b\na/b/c\na/b/d\na/e/\nf/g\n");
+    importer.finish();
+    CHECK(importer.line_count() == 6);
+    CHECK(rows() == expected);
+    CHECK(root_handles.size() == 2);
+  }
+
+  SUBCASE("blank paths keep the shared prefix") {
+    hy::importer_t importer(hy::import_format_e::paths, entities, root_handles);
+    importer.feed("a/b/c\n\na/b/d\n/\na/e\r\n\r\nf/g\n");
+    importer.finish();
+    CHECK(rows() == expected);
+    CHECK(entities.size() == 7);
+  }
+
+  SUBCASE("lines split across chunks") {
+    const std::string_view input = "a/b/c\na/b/d\na/e\nf/g";
+    hy::importer_t importer(hy::import_format_e::paths, entities, root_handles);
+    for (size_t i = 0; i < input.size(); i += 3) {
+      importer.feed(input.substr(i, 3));
+    }
+    importer.finish();
+    CHECK(rows() == expected);
+  }
+
+  SUBCASE("file") {
+    const auto path =
+      (std::filesystem::temp_directory_path() / "hierarchy-test.txt").string();
+    {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file << "a\n b\n  c\n  d\n e\nf\n g\n";
+    }
+    CHECK(hy::import_file(
+      path, hy::import_format_e::indented, entities, root_handles));
+    CHECK(rows() == expected);
+    std::remove(path.c_str());
+    CHECK(!hy::import_file(
+      path, hy::import_format_e::indented, entities, root_handles));
+  }
+}
+
+TEST_CASE("Bulk Entities") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  std::vector<thh::handle_t> root_handles;
+
+  // name and indent of each row of the fully expanded hierarchy
+  const auto rows = [&] {
+    std::vector<std::pair<std::string, int>> result;
+    for (const auto& flattened_handle :
+         hy::flatten_entities(entities, hy::collapser_t(), root_handles)) {
+      entities.call(flattened_handle.entity_handle_, [&](const auto& entity) {
+        result.emplace_back(entity.name_, flattened_handle.indent_);
+      });
+    }
+    return result;
+  };
+
+  const std::vector<std::pair<std::string, int>> expected = {
+    {"a", 0}, {"b", 1}, {"c", 2}, {"d", 2}, {"e", 1}, {"f", 0}, {"g", 1}};
+
+  SUBCASE("parent indices") {
+    // parents may come after their children
+    const auto handles = hy::add_entities(
+      {-1, 0, 6, 6, -1, 4, 0}, {"a", "e", "c", "d", "f", "g", "b"}, entities,
+      root_handles);
+    CHECK(handles.size() == 7);
+    CHECK(root_handles == std::vector<thh::handle_t>{handles[0], handles[4]});
+    CHECK(
+      rows()
+      == std::vector<std::pair<std::string, int>>{
+        {"a", 0}, {"e", 1}, {"b", 1}, {"c", 2}, {"d", 2}, {"f", 0}, {"g", 1}});
+    entities.call(handles[2], [&](const hy::entity_t& entity) {
+      CHECK(entity.parent_ == handles[6]);
+      CHECK(entity.children_.empty());
+    });
+    entities.call(handles[6], [&](const hy::entity_t& entity) {
+      CHECK(entity.children_.capacity() == 2);
+    });
+  }
+
+  SUBCASE("invalid parent indices are rejected") {
+    const std::vector<std::string> names = {"a", "b", "c"};
+    CHECK(hy::add_entities({-1, 0, 3}, names, entities, root_handles).empty());
+    CHECK(hy::add_entities({-1, -2, 0}, names, entities, root_handles).empty());
+    CHECK(hy::add_entities({-1, 0}, names, entities, root_handles).empty());
+    CHECK(
+      hy::add_entities({-1, 0, 1, 1}, names, entities, root_handles).empty());
+    // b and c are each other's parent, and c is its own parent
+    CHECK(hy::add_entities({-1, 2, 1}, names, entities, root_handles).empty());
+    CHECK(hy::add_entities({-1, 0, 2}, names, entities, root_handles).empty());
+    CHECK(entities.size() == 0);
+    CHECK(root_handles.empty());
+    CHECK(
+      hy::add_entities({2, -1, 1}, names, entities, root_handles).size() == 3);
+  }
+
+  SUBCASE("depths and names") {
+    const auto handles = hy::add_entities(
+      {{0, "a"}, {1, "b"}, {2, "c"}, {2, "d"}, {1, "e"}, {0, "f"}, {1, "g"}},
+      entities, root_handles);
+    CHECK(handles.size() == 7);
+    CHECK(root_handles.size() == 2);
+    CHECK(rows() == expected);
+    entities.call(handles[3], [&](const hy::entity_t& entity) {
+      CHECK(entity.parent_ == handles[1]);
+    });
+  }
+
+  SUBCASE("depths deeper than the previous entity are clamped") {
+    hy::add_entities(
+      {{0, "a"}, {3, "b"}, {5, "c"}, {2, "d"}, {1, "e"}, {-1, "f"}, {1, "g"}},
+      entities, root_handles);
+    CHECK(rows() == expected);
+  }
+
+  SUBCASE("roots appended after existing roots") {
+    root_handles = demo::create_sample_entities(entities);
+    hy::add_entities({{0, "a"}}, entities, root_handles);
+    CHECK(root_handles.size() == 4);
+    CHECK(entities.size() == 13);
+  }
+}
+
+TEST_CASE("Reparent") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+
+  // handle of the entity named entity_<id> (sample entities are named by id)
+  const auto handle = [](const int32_t id) { return thh::handle_t(id, 0); };
+  const auto select = [&](const thh::handle_t entity_handle) {
+    while (view.selected_handle() != entity_handle) {
+      view.move_down();
+    }
+  };
+  // the view must match flattening from scratch and cached counts must
+  // match counting from scratch
+  const auto check_view = [&] {
+    const auto expected =
+      hy::flatten_entities(entities, collapser, root_handles);
+    REQUIRE(view.flattened_handles().size() == (int32_t)expected.size());
+    for (int32_t i = 0; i < (int32_t)expected.size(); i++) {
+      CHECK(
+        view.flattened_handles()[i].entity_handle_
+        == expected[i].entity_handle_);
+      CHECK(view.flattened_handles()[i].indent_ == expected[i].indent_);
+    }
+    std::vector<int> counts;
+    for (const auto& flattened_handle : expected) {
+      counts.push_back(hy::expanded_count(
+        flattened_handle.entity_handle_, entities, collapser));
+    }
+    collapser.clear_expanded_counts();
+    for (size_t i = 0; i < expected.size(); i++) {
+      CHECK(
+        counts[i]
+        == hy::expanded_count(expected[i].entity_handle_, entities, collapser));
+    }
+  };
+
+  // warm the cached counts so they must be patched by the move
+  hy::expanded_count(root_handles.front(), entities, collapser);
+
+  SUBCASE("moved rows scrolled into view") {
+    view = hy::view_t(
+      hy::flatten_entities(entities, collapser, root_handles), 0, 3);
+    const auto selected_visible = [&] {
+      return *view.selected_index() >= view.offset()
+          && *view.selected_index() < view.offset() + view.count();
+    };
+    select(handle(1));
+    REQUIRE(view.move_selected_to(
+      thh::handle_t(), entities, collapser, root_handles));
+    CHECK(view.selected_index() == 11);
+    CHECK(selected_visible());
+    view.goto_entity(handle(8), entities, collapser);
+    REQUIRE(view.move_selected_to(
+      handle(0), entities, collapser, root_handles));
+    CHECK(view.selected_handle() == handle(8));
+    CHECK(view.selected_index() == 6);
+    CHECK(selected_visible());
+    view.move_up();
+    view.move_up();
+    view.move_up();
+    REQUIRE(view.move_selected_to(
+      handle(7), entities, collapser, root_handles));
+    CHECK(selected_visible());
+    check_view();
+  }
+
+  SUBCASE("move deeper") {
+    select(handle(7));
+    REQUIRE(view.move_selected_to(
+      handle(10), entities, collapser, root_handles));
+    CHECK(view.selected_handle() == handle(7));
+    CHECK(view.selected_indent() == 4);
+    entities.call(handle(7), [&](const hy::entity_t& entity) {
+      CHECK(entity.parent_ == handle(10));
+    });
+    CHECK(root_handles.size() == 2);
+    check_view();
+  }
+
+  SUBCASE("move shallower") {
+    select(handle(6));
+    REQUIRE(view.move_selected_to(
+      handle(8), entities, collapser, root_handles));
+    CHECK(view.selected_handle() == handle(6));
+    CHECK(view.selected_indent() == 1);
+    check_view();
+  }
+
+  SUBCASE("move to root") {
+    select(handle(2));
+    REQUIRE(view.move_selected_to(
+      thh::handle_t(), entities, collapser, root_handles));
+    CHECK(root_handles.back() == handle(2));
+    CHECK(view.selected_indent() == 0);
+    check_view();
+  }
+
+  SUBCASE("move under collapsed entity") {
+    select(handle(8));
+    view.collapse(entities, collapser);
+    view.move_up();
+    view.move_up();
+    REQUIRE(view.selected_handle() == handle(3));
+    REQUIRE(view.move_selected_to(
+      handle(8), entities, collapser, root_handles));
+    check_view();
+    select(handle(8));
+    view.expand(entities, collapser);
+    check_view();
+  }
+
+  SUBCASE("cycles rejected") {
+    select(handle(2));
+    CHECK(!view.move_selected_to(
+      handle(10), entities, collapser, root_handles));
+    CHECK(!view.move_selected_to(
+      handle(2), entities, collapser, root_handles));
+    CHECK(!hy::reparent(
+      handle(0), handle(6), entities, collapser, root_handles));
+    CHECK(view.selected_handle() == handle(2));
+    check_view();
+  }
+}
+
+TEST_CASE("Sibling Index") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+
+  // every recorded position must match the entity's actual position
+  const auto check_sibling_indices = [&] {
+    std::vector<const std::vector<thh::handle_t>*> siblings = {&root_handles};
+    while (!siblings.empty()) {
+      const auto* handles = siblings.back();
+      siblings.pop_back();
+      for (int32_t i = 0; i < (int32_t)handles->size(); i++) {
+        entities.call((*handles)[i], [&](const hy::entity_t& entity) {
+          CHECK(entity.sibling_index_ == i);
+          siblings.push_back(&entity.children_);
+        });
+      }
+    }
+  };
+
+  check_sibling_indices();
+
+  SUBCASE("add sibling and child") {
+    view.move_down();
+    view.add_sibling(entities, collapser, root_handles);
+    view.add_child(entities, collapser);
+    view.move_down();
+    view.move_down();
+    view.move_down();
+    view.add_sibling(entities, collapser, root_handles);
+    check_sibling_indices();
+  }
+
+  SUBCASE("remove") {
+    view.move_down();
+    view.move_down(); // entity_2
+    view.remove(entities, collapser, root_handles);
+    check_sibling_indices();
+    view.move_up();
+    view.move_up(); // entity_0
+    view.remove(entities, collapser, root_handles);
+    check_sibling_indices();
+    CHECK(root_handles.size() == 2);
+  }
+
+  SUBCASE("reparent") {
+    hy::reparent(
+      thh::handle_t(5, 0), thh::handle_t(8, 0), entities, collapser,
+      root_handles);
+    hy::reparent(
+      thh::handle_t(0, 0), thh::handle_t(9, 0), entities, collapser,
+      root_handles);
+    check_sibling_indices();
+  }
+
+  SUBCASE("bulk entities") {
+    hy::add_entities(
+      {{0, "a"}, {1, "b"}, {1, "c"}, {0, "d"}}, entities, root_handles);
+    hy::add_children(
+      root_handles.back(), {entities.add(), entities.add()}, entities);
+    check_sibling_indices();
+  }
+
+  SUBCASE("stale positions fall back to a search") {
+    std::vector<thh::handle_t> reversed(
+      root_handles.rbegin(), root_handles.rend());
+    CHECK(hy::sibling_index(reversed[0], reversed, entities) == 0);
+    CHECK(hy::sibling_index(reversed[2], reversed, entities) == 2);
+    CHECK(!hy::sibling_index(thh::handle_t(1, 0), reversed, entities));
+  }
+}
+
+TEST_CASE("Traversal Context") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::traversal_context_t traversal_context;
+
+  const auto flattened_equal = [](const auto& lhs, const auto& rhs) {
+    return std::equal(
+      lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      [](const auto& l, const auto& r) {
+        return l.entity_handle_ == r.entity_handle_ && l.indent_ == r.indent_;
+      });
+  };
+
+  SUBCASE("results match allocating versions") {
+    collapser.collapse(thh::handle_t(6, 0), entities);
+    for (const auto root_handle : root_handles) {
+      CHECK(flattened_equal(
+        hy::flatten_entity(
+          root_handle, 1, entities, collapser, traversal_context),
+        hy::flatten_entity(root_handle, 1, entities, collapser)));
+      CHECK(
+        hy::entity_and_descendants(root_handle, entities, traversal_context)
+        == hy::entity_and_descendants(root_handle, entities));
+      auto uncached_collapser = collapser;
+      uncached_collapser.clear_expanded_counts();
+      CHECK(
+        hy::expanded_count(
+          root_handle, entities, uncached_collapser, traversal_context)
+        == hy::expanded_count(root_handle, entities, collapser));
+    }
+  }
+
+  SUBCASE("buffers are reused") {
+    const auto* flattened = hy::flatten_entity(
+                              root_handles[0], 0, entities, collapser,
+                              traversal_context)
+                              .data();
+    const auto* descendants =
+      hy::entity_and_descendants(root_handles[0], entities, traversal_context)
+        .data();
+    CHECK(
+      hy::flatten_entity(
+        thh::handle_t(2, 0), 0, entities, collapser, traversal_context)
+        .data()
+      == flattened);
+    CHECK(
+      hy::entity_and_descendants(
+        thh::handle_t(2, 0), entities, traversal_context)
+        .data()
+      == descendants);
+  }
+
+  SUBCASE("sibling and child handles") {
+    CHECK(
+      &hy::sibling_handles(root_handles[0], entities, root_handles)
+      == &root_handles);
+    CHECK(
+      hy::sibling_handles(thh::handle_t(2, 0), entities, root_handles)
+      == hy::siblings(thh::handle_t(2, 0), entities, root_handles));
+    CHECK(
+      hy::child_handles(root_handles[0], entities)
+      == hy::siblings(thh::handle_t(2, 0), entities, root_handles));
+    CHECK(hy::child_handles(thh::handle_t(3, 0), entities).empty());
+    CHECK(hy::sibling_handles(thh::handle_t(), entities, root_handles).empty());
+    CHECK(hy::child_handles(thh::handle_t(), entities).empty());
+  }
+}
+
+TEST_CASE("Pre-order Traversal") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  collapser.collapse(thh::handle_t(6, 0), entities);
+
+  const auto flattened_equal = [](const auto& lhs, const auto& rhs) {
+    return std::equal(
+      lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+      [](const auto& l, const auto& r) {
+        return l.entity_handle_ == r.entity_handle_ && l.indent_ == r.indent_;
+      });
+  };
+
+  SUBCASE("visits rows in flattened order") {
+    for (const auto root_handle : root_handles) {
+      hy::pre_order_t pre_order(root_handle, 2, entities, collapser);
+      const std::vector<hy::flattened_handle_t> visited(
+        pre_order.begin(), pre_order.end());
+      CHECK(flattened_equal(
+        visited, hy::flatten_entity(root_handle, 2, entities, collapser)));
+    }
+    hy::pre_order_t pre_order(root_handles, entities, collapser);
+    const std::vector<hy::flattened_handle_t> visited(
+      pre_order.begin(), pre_order.end());
+    CHECK(flattened_equal(
+      visited, hy::flatten_entities(entities, collapser, root_handles)));
+  }
+
+  SUBCASE("visits every descendant when expanding all") {
+    const hy::expand_all_t expand_all;
+    hy::pre_order_t pre_order(root_handles[0], 0, entities, expand_all);
+    std::vector<thh::handle_t> visited;
+    for (const auto& flattened_handle : pre_order) {
+      visited.push_back(flattened_handle.entity_handle_);
+    }
+    CHECK(visited == hy::entity_and_descendants(root_handles[0], entities));
+  }
+
+  SUBCASE("stops early and skips descendants") {
+    const auto flattened =
+      hy::flatten_entities(entities, collapser, root_handles);
+    hy::pre_order_t pre_order(root_handles, entities, collapser);
+    CHECK(pre_order.current().entity_handle_ == root_handles[0]);
+    pre_order.next();
+    CHECK(pre_order.current().entity_handle_ == flattened[1].entity_handle_);
+    CHECK(pre_order.current().indent_ == 1);
+
+    // move past the first child's descendants to its next sibling
+    pre_order.skip_descendants();
+    pre_order.next();
+    const auto first_child = flattened[1].entity_handle_;
+    const auto next_sibling =
+      std::find_if(flattened.begin() + 2, flattened.end(), [](const auto& h) {
+        return h.indent_ <= 1;
+      });
+    CHECK(pre_order.current().entity_handle_ == next_sibling->entity_handle_);
+    CHECK(pre_order.current().entity_handle_ != first_child);
+
+    // restarting reuses the traversal
+    pre_order.reset(thh::handle_t(3, 0), 0, entities, collapser);
+    CHECK(!pre_order.done());
+    CHECK(pre_order.current().entity_handle_ == thh::handle_t(3, 0));
+    pre_order.next();
+    CHECK(pre_order.done());
+    CHECK(pre_order.begin() == pre_order.end());
+  }
+
+  SUBCASE("empty roots visit nothing") {
+    hy::pre_order_t pre_order(
+      std::vector<thh::handle_t>{}, entities, collapser);
+    CHECK(pre_order.done());
+    CHECK(pre_order.begin() == pre_order.end());
+  }
+}
+
+TEST_CASE("Name Index") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  // display order is 0, 1, 2, 5, 6, 10, 11, 7, 3, 4, 8, 9
+  hy::name_index_t name_index;
+  for (const auto& row : hy::flatten_entities(
+         entities, hy::collapser_t(), root_handles)) {
+    name_index.add(row.entity_handle_, entities);
+  }
+
+  const auto handles = [](const std::vector<int32_t>& ids) {
+    std::vector<thh::handle_t> handles;
+    for (const auto id : ids) {
+      handles.push_back(thh::handle_t(id, 0));
+    }
+    return handles;
+  };
+
+  // renamed directly (not through a view) so the index is updated by hand
+  const auto rename = [&](const int32_t id, const std::string_view name) {
+    entities.call(
+      thh::handle_t(id, 0), [name](auto& entity) { entity.name_ = name; });
+    name_index.update(thh::handle_t(id, 0), entities);
+  };
+
+  SUBCASE("finds names containing the query") {
+    CHECK(name_index.find("entity_1", entities) == handles({1, 10, 11}));
+    CHECK(name_index.find("ENTITY_1", entities) == handles({1, 10, 11}));
+    CHECK(name_index.find("ty_11", entities) == handles({11}));
+    CHECK(name_index.find("_1", entities) == handles({1, 10, 11}));
+    CHECK(name_index.find("entity_12", entities).empty());
+    CHECK(name_index.find("missing", entities).empty());
+    CHECK(name_index.find("", entities).empty());
+  }
+
+  SUBCASE("follows renames and removals") {
+    rename(4, "Light_Probe");
+    CHECK(
+      entities
+        .call_return(
+          thh::handle_t(4, 0),
+          [](const auto& entity) { return std::string(entity.name_); })
+        .value_or("")
+      == "Light_Probe");
+    CHECK(name_index.find("light", entities) == handles({4}));
+    CHECK(name_index.find("entity_4", entities).empty());
+
+    // renaming back revives the previous entries without duplicates
+    rename(4, "entity_4");
+    CHECK(name_index.find("entity_4", entities) == handles({4}));
+    CHECK(name_index.find("light", entities).empty());
+
+    name_index.remove(thh::handle_t(10, 0));
+    entities.remove(thh::handle_t(10, 0));
+    CHECK(name_index.find("entity_1", entities) == handles({1, 11}));
+    // removed without telling the index
+    entities.remove(thh::handle_t(11, 0));
+    CHECK(name_index.find("entity_1", entities) == handles({1}));
+    CHECK(name_index.find("y_", entities).size() == 10);
+  }
+
+  SUBCASE("follows edits made through a view") {
+    hy::hierarchy_events_t events;
+    hy::collapser_t collapser;
+    hy::view_t view(
+      hy::flatten_entities(entities, collapser, root_handles), 0, 20);
+    hy::subscribe(events, view, entities, collapser, root_handles);
+    hy::subscribe(events, name_index, entities);
+
+    // entity 1
+    view.move_down();
+    view.rename("Light_Probe", entities);
+    CHECK(name_index.find("light", entities) == handles({1}));
+    CHECK(name_index.find("entity_1", entities) == handles({10, 11}));
+
+    // entity 12 under entity 1 and entity 13 after it
+    view.add_child(entities, collapser);
+    view.add_sibling(entities, collapser, root_handles);
+    CHECK(name_index.find("entity_1", entities) == handles({10, 11, 12, 13}));
+
+    // entity 2 and its descendants (5, 6, 10 and 11) are reclaimed later
+    hy::entity_reclaimer_t reclaimer;
+    view.goto_entity(thh::handle_t(2, 0), entities, collapser);
+    view.remove(entities, collapser, root_handles, reclaimer);
+    CHECK(name_index.find("entity_1", entities) == handles({12, 13}));
+    CHECK(name_index.find("entity_5", entities).empty());
+    reclaimer.reclaim_all(entities, collapser);
+
+    // a reused id (with a new generation) is indexed under its new name
+    view.goto_entity(thh::handle_t(0, 0), entities, collapser);
+    const auto added = view.add_child(entities, collapser);
+    REQUIRE(added.has_value());
+    const auto handle = added->flattened_handle_.entity_handle_;
+    CHECK(
+      name_index.find(
+        std::string("entity_") + std::to_string(handle.id_), entities)
+      == std::vector<thh::handle_t>{handle});
+    CHECK(name_index.find("y_", entities).size() == 9);
+  }
+
+  SUBCASE("stale entries are compacted") {
+    const auto entry_count = name_index.entry_count();
+    for (int id = 0; id < 12; id++) {
+      rename(id, "x");
+    }
+    CHECK(name_index.entry_count() < entry_count / 2);
+    CHECK(name_index.find("x", entities).size() == 12);
+    CHECK(name_index.find("entity", entities).empty());
+  }
+
+  SUBCASE("next and previous match follow display order") {
+    const auto matches = name_index.find("entity_1", entities);
+    const auto next = [&](const int32_t id) {
+      return hy::next_match(
+        matches, thh::handle_t(id, 0), entities, root_handles);
+    };
+    const auto previous = [&](const int32_t id) {
+      return hy::previous_match(
+        matches, thh::handle_t(id, 0), entities, root_handles);
+    };
+    CHECK(next(0) == thh::handle_t(1, 0));
+    CHECK(next(1) == thh::handle_t(10, 0));
+    CHECK(next(5) == thh::handle_t(10, 0));
+    CHECK(next(10) == thh::handle_t(11, 0));
+    CHECK(next(11) == thh::handle_t(1, 0));
+    CHECK(next(8) == thh::handle_t(1, 0));
+    CHECK(previous(5) == thh::handle_t(1, 0));
+    CHECK(previous(1) == thh::handle_t(11, 0));
+    CHECK(previous(7) == thh::handle_t(11, 0));
+    CHECK(
+      hy::next_match(matches, thh::handle_t(), entities, root_handles)
+      == thh::handle_t(1, 0));
+    CHECK(
+      hy::previous_match(matches, thh::handle_t(), entities, root_handles)
+      == thh::handle_t(11, 0));
+    CHECK(!hy::next_match({}, thh::handle_t(1, 0), entities, root_handles)
+             .has_value());
+  }
+
+  SUBCASE("view jumps to hidden matches") {
+    hy::collapser_t collapser;
+    collapser.collapse(thh::handle_t(2, 0), entities);
+    hy::view_t view(
+      hy::flatten_entities(entities, collapser, root_handles), 0, 10);
+    const auto matches = name_index.find("entity_10", entities);
+    const auto match =
+      hy::next_match(matches, view.selected_handle(), entities, root_handles);
+    REQUIRE(match.has_value());
+    CHECK(view.goto_entity(*match, entities, collapser));
+    CHECK(view.selected_handle() == thh::handle_t(10, 0));
+    CHECK(!collapser.collapsed(thh::handle_t(2, 0)));
+    CHECK(!view.goto_entity(thh::handle_t(), entities, collapser));
+  }
+}
+
+TEST_CASE("Filtered View") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  // rows (handle id and indent) of entities containing query and their
+  // ancestors, found from every entity in display order
+  const auto expected_rows = [&](const std::string_view query) {
+    std::vector<std::pair<int32_t, int32_t>> rows;
+    for (const auto& row : hy::flatten_entities(
+           entities, hy::collapser_t(), root_handles)) {
+      const auto& handles =
+        hy::entity_and_descendants(row.entity_handle_, entities);
+      if (std::any_of(handles.begin(), handles.end(), [&](const auto handle) {
+            return entities
+              .call_return(
+                handle,
+                [&](const hy::entity_t& entity) {
+                  return hy::name_contains(entity.name_, query);
+                })
+              .value_or(false);
+          })) {
+        rows.emplace_back(row.entity_handle_.id_, row.indent_);
+      }
+    }
+    return rows;
+  };
+  const auto view_rows = [](const hy::filtered_view_t& view) {
+    std::vector<std::pair<int32_t, int32_t>> rows;
+    for (int index = 0; index < view.row_count(); index++) {
+      rows.emplace_back(
+        view.row(index).entity_handle_.id_, view.row(index).indent_);
+    }
+    return rows;
+  };
+
+  hy::filtered_view_t view(10);
+
+  SUBCASE("shows matches and their ancestors") {
+    CHECK(view.row_count() == 0);
+    CHECK(!view.selected_index().has_value());
+    view.set_query("entity_1", entities, root_handles);
+    CHECK(view.query() == "entity_1");
+    CHECK(
+      view_rows(view)
+      == std::vector<std::pair<int32_t, int32_t>>{
+        {0, 0}, {1, 1}, {2, 1}, {6, 2}, {10, 3}, {11, 2}});
+    CHECK(!view.matched(0));
+    CHECK(view.matched(1));
+    CHECK(!view.matched(3));
+    CHECK(view.matched(4));
+    CHECK(view.parent_row(0) == -1);
+    CHECK(view.parent_row(4) == 3);
+    CHECK(view.parent_row(5) == 2);
+    CHECK(view.last_sibling(0));
+    CHECK(!view.last_sibling(1));
+    CHECK(view.last_sibling(2));
+    CHECK(!view.last_sibling(3));
+    CHECK(view.last_sibling(5));
+
+    view.set_query("ENTITY_7", entities, root_handles);
+    CHECK(view_rows(view) == std::vector<std::pair<int32_t, int32_t>>{{7, 0}});
+    CHECK(view.last_sibling(0));
+    view.set_query("missing", entities, root_handles);
+    CHECK(view.row_count() == 0);
+    CHECK(view.selected_handle() == thh::handle_t());
+    view.set_query("", entities, root_handles);
+    CHECK(view.row_count() == 12);
+
+    view.clear();
+    CHECK(view.row_count() == 0);
+    CHECK(view.query().empty());
+  }
+
+  SUBCASE("narrowing and widening match a new scan") {
+    const std::string_view queries[] = {
+      "e", "ent", "entity_1", "entity_10", "entity_1", "ity_1", "y_",
+      "y_9", "y_", "", "4", "entity_4", "entity_"};
+    for (const auto query : queries) {
+      view.set_query(query, entities, root_handles);
+      CHECK(view_rows(view) == expected_rows(query));
+      hy::filtered_view_t scanned(10);
+      scanned.set_query(query, entities, root_handles);
+      for (int index = 0; index < view.row_count(); index++) {
+        CHECK(view.matched(index) == scanned.matched(index));
+        CHECK(view.last_sibling(index) == scanned.last_sibling(index));
+        CHECK(view.parent_row(index) == scanned.parent_row(index));
+      }
+    }
+  }
+
+  SUBCASE("filter narrows matches with or without a query") {
+    const auto matched_handles = [&view] {
+      std::vector<int32_t> ids;
+      for (int index = 0; index < view.row_count(); index++) {
+        if (view.matched(index)) {
+          ids.push_back(view.row(index).entity_handle_.id_);
+        }
+      }
+      return ids;
+    };
+    const auto leaves = [](const hy::entity_t& entity) {
+      return entity.children_.empty();
+    };
+
+    view.set_filter(leaves, entities, root_handles);
+    CHECK(view.query().empty());
+    CHECK(matched_handles() == std::vector<int32_t>{1, 5, 10, 11, 3, 4, 9});
+    CHECK(view.row_count() == 12);
+    view.set_query("entity_1", entities, root_handles);
+    CHECK(matched_handles() == std::vector<int32_t>{1, 10, 11});
+    // narrowing only checks names
+    view.set_query("entity_11", entities, root_handles);
+    CHECK(matched_handles() == std::vector<int32_t>{11});
+    view.set_query("entity_", entities, root_handles);
+    CHECK(matched_handles() == std::vector<int32_t>{1, 5, 10, 11, 3, 4, 9});
+
+    view.set_filter(
+      [](const hy::entity_t& entity) { return !entity.children_.empty(); },
+      entities, root_handles);
+    CHECK(matched_handles() == std::vector<int32_t>{0, 2, 6, 7, 8});
+    view.set_filter(nullptr, entities, root_handles);
+    CHECK(view.row_count() == 12);
+
+    view.clear();
+    view.set_filter(leaves, entities, root_handles);
+    view.set_filter(nullptr, entities, root_handles);
+    CHECK(view.row_count() == 0);
+    CHECK(view.query().empty());
+  }
+
+  SUBCASE("selection follows the selected entity") {
+    view.set_query("entity_1", entities, root_handles);
+    repeat_n(5, [&] { view.move_down(); });
+    CHECK(view.selected_handle() == thh::handle_t(11, 0));
+    view.set_query("entity_11", entities, root_handles);
+    CHECK(view.selected_index() == 2);
+    CHECK(view.selected_handle() == thh::handle_t(11, 0));
+    view.set_query("entity_1", entities, root_handles);
+    CHECK(view.selected_handle() == thh::handle_t(11, 0));
+    view.set_query("entity_10", entities, root_handles);
+    CHECK(view.selected_index() == 0);
+    view.move_up();
+    CHECK(view.selected_index() == 0);
+  }
+
+  SUBCASE("selection follows the selected entity through updates") {
+    view.set_query("entity", entities, root_handles);
+    // entity 9 under root 8, after the rows of roots 0 and 7
+    repeat_n(11, [&] { view.move_down(); });
+    REQUIRE(view.selected_handle() == thh::handle_t(9, 0));
+
+    // rows before the selected entity are removed
+    entities.call(thh::handle_t(5, 0), [](auto& entity) {
+      entity.name_ = "removed_5";
+    });
+    view.update(thh::handle_t(5, 0), entities, root_handles);
+    CHECK(view.selected_index() == 10);
+    CHECK(view.selected_handle() == thh::handle_t(9, 0));
+
+    // the selected entity's own root is rescanned
+    entities.call(thh::handle_t(8, 0), [](auto& entity) {
+      entity.name_ = "removed_8";
+    });
+    view.update(thh::handle_t(8, 0), entities, root_handles);
+    CHECK(view.selected_index() == 10);
+    CHECK(view.selected_handle() == thh::handle_t(9, 0));
+
+    // no longer shown so the first row is selected
+    entities.call(thh::handle_t(9, 0), [](auto& entity) {
+      entity.name_ = "removed_9";
+    });
+    view.update(thh::handle_t(9, 0), entities, root_handles);
+    CHECK(view.selected_index() == 0);
+  }
+
+  SUBCASE("updates follow entity changes") {
+    view.set_query("entity_1", entities, root_handles);
+
+    entities.call(thh::handle_t(4, 0), [](auto& entity) {
+      entity.name_ = "entity_14";
+    });
+    view.update(thh::handle_t(4, 0), entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+    CHECK(view.row(view.row_count() - 1).entity_handle_ == thh::handle_t(4, 0));
+
+    // removed entity (updated through its parent)
+    entities.remove(thh::handle_t(10, 0));
+    entities.call(thh::handle_t(6, 0), [](auto& entity) {
+      entity.children_.clear();
+    });
+    view.update(thh::handle_t(6, 0), entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+
+    // removed root (no parent to pass so the root itself is passed)
+    entities.remove(thh::handle_t(4, 0));
+    entities.remove(thh::handle_t(3, 0));
+    entities.remove(thh::handle_t(7, 0));
+    root_handles.erase(root_handles.begin() + 1);
+    view.update(thh::handle_t(7, 0), entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+
+    // new root
+    const auto handle = entities.add();
+    entities.call(handle, [](auto& entity) { entity.name_ = "entity_1z"; });
+    root_handles.push_back(handle);
+    view.update(handle, entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+    view.set_query("entity_1z", entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1z"));
+    view.set_query("entity_1", entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+  }
+
+  SUBCASE("shortening after an update rebuilds rows") {
+    view.set_query("entity", entities, root_handles);
+    view.set_query("entity_1", entities, root_handles);
+    view.set_query("entity_10", entities, root_handles);
+    entities.call(thh::handle_t(5, 0), [](auto& entity) {
+      entity.name_ = "entity_15";
+    });
+    view.update(thh::handle_t(5, 0), entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_10"));
+    view.set_query("entity_1", entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity_1"));
+    view.set_query("entity", entities, root_handles);
+    CHECK(view_rows(view) == expected_rows("entity"));
+  }
+
+  SUBCASE("updates splice rows at every query level") {
+    thh::handle_vector_t<hy::entity_t> bench_entities;
+    auto bench_root_handles =
+      demo::create_bench_entities(bench_entities, 16, 4);
+    hy::collapser_t collapser;
+    const auto matches_scan = [&] {
+      hy::filtered_view_t scanned(10);
+      scanned.set_query(view.query(), bench_entities, bench_root_handles);
+      if (scanned.row_count() != view.row_count()) {
+        return false;
+      }
+      for (int index = 0; index < view.row_count(); index++) {
+        if (
+          view.row(index).entity_handle_ != scanned.row(index).entity_handle_
+          || view.row(index).indent_ != scanned.row(index).indent_
+          || view.matched(index) != scanned.matched(index)
+          || view.last_sibling(index) != scanned.last_sibling(index)
+          || view.parent_row(index) != scanned.parent_row(index)) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    uint32_t seed = 3;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 16;
+    };
+    const std::string_view queries[] = {"y_", "y_1", "y_12"};
+    repeat_n(200, [&] {
+      // every level is kept in the history
+      for (const auto query : queries) {
+        view.set_query(query, bench_entities, bench_root_handles);
+      }
+      const auto handle = thh::handle_t(next() % 64, 0);
+      if (next() % 2 == 0) {
+        const auto name = std::string("entity_") + std::to_string(next() % 200);
+        bench_entities.call(
+          handle, [&name](auto& entity) { entity.name_ = name; });
+        view.update(handle, bench_entities, bench_root_handles);
+      } else {
+        const auto previous_parent =
+          bench_entities
+            .call_return(handle, [](const auto& entity) { return entity.parent_; })
+            .value_or(thh::handle_t());
+        const auto parent = next() % 4 == 0 ? thh::handle_t()
+                                            : thh::handle_t(next() % 64, 0);
+        if (hy::reparent(
+              handle, parent, bench_entities, collapser, bench_root_handles)) {
+          view.update(handle, bench_entities, bench_root_handles);
+          if (previous_parent != thh::handle_t()) {
+            view.update(previous_parent, bench_entities, bench_root_handles);
+          }
+        }
+      }
+      CHECK(matches_scan());
+      view.set_query("y_1", bench_entities, bench_root_handles);
+      CHECK(matches_scan());
+      view.set_query("y_", bench_entities, bench_root_handles);
+      CHECK(matches_scan());
+    });
+  }
+
+  SUBCASE("parallel scan matches serial scan") {
+    hy::thread_pool_t thread_pool(4);
+    const auto matches_serial = [&](
+                                  const thh::handle_vector_t<hy::entity_t>&
+                                    scanned_entities,
+                                  const std::vector<thh::handle_t>&
+                                    scanned_root_handles) {
+      hy::filtered_view_t serial_view(10);
+      hy::filtered_view_t parallel_view(10, &thread_pool);
+      const std::string_view queries[] = {"1", "12", "2", "", "_2", "_25"};
+      for (const auto query : queries) {
+        serial_view.set_query(query, scanned_entities, scanned_root_handles);
+        parallel_view.set_query(query, scanned_entities, scanned_root_handles);
+        REQUIRE(serial_view.row_count() == parallel_view.row_count());
+        for (int index = 0; index < serial_view.row_count(); index++) {
+          CHECK(
+            serial_view.row(index).entity_handle_
+            == parallel_view.row(index).entity_handle_);
+          CHECK(serial_view.row(index).indent_ == parallel_view.row(index).indent_);
+          CHECK(serial_view.matched(index) == parallel_view.matched(index));
+          CHECK(
+            serial_view.last_sibling(index)
+            == parallel_view.last_sibling(index));
+          CHECK(
+            serial_view.parent_row(index) == parallel_view.parent_row(index));
+        }
+      }
+    };
+
+    // enough roots to share out
+    thh::handle_vector_t<hy::entity_t> bench_entities;
+    matches_serial(
+      bench_entities, demo::create_bench_entities(bench_entities, 64, 4));
+    // few roots, split by their children (and a long chain that is only
+    // split down to a limited depth)
+    matches_serial(entities, root_handles);
+    thh::handle_vector_t<hy::entity_t> chain_entities;
+    matches_serial(
+      chain_entities, demo::create_bench_entities(chain_entities, 1, 32));
+  }
+
+  SUBCASE("draws connectors between shown siblings") {
+    struct backend_t {
+      void set_bold(const bool bold) { bold_ = bold; }
+      void set_invert(bool) {}
+      void draw_glyph(const int x, const int y, const hy::glyph_e glyph) {
+        rows_.resize(std::max((int)rows_.size(), y + 1));
+        rows_[y].resize(x, ' ');
+        rows_[y] += glyph == hy::glyph_e::connection ? "|"
+                  : glyph == hy::glyph_e::end        ? "L"
+                                                     : "-";
+      }
+      void draw(const std::string_view str) {
+        rows_.back() += bold_ ? "*" + std::string(str) : std::string(str);
+      }
+      int indent_width() const { return 1; }
+
+      std::vector<std::string> rows_;
+      bool bold_ = false;
+    };
+
+    view.set_query("entity_1", entities, root_handles);
+    backend_t backend;
+    hy::display_scrollable_hierarchy(entities, view, backend);
+    CHECK(
+      backend.rows_
+      == std::vector<std::string>{
+        "Lentity_0", " -*entity_1", " Lentity_2", "  -entity_6",
+        "  |L*entity_10", "  L*entity_11"});
+  }
+}
+
+TEST_CASE("Hierarchy Events") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::hierarchy_events_t events;
+  // each view has its own collapse state
+  hy::collapser_t collapser_a;
+  hy::collapser_t collapser_b;
+  collapser_b.collapse(thh::handle_t(7, 0), entities);
+  hy::view_t view_a(
+    hy::flatten_entities(entities, collapser_a, root_handles), 0, 10);
+  hy::view_t view_b(
+    hy::flatten_entities(entities, collapser_b, root_handles), 0, 10);
+  hy::subscribe(events, view_a, entities, collapser_a, root_handles);
+  hy::subscribe(events, view_b, entities, collapser_b, root_handles);
+
+  const auto matches_entities = [&](
+                                  const hy::view_t& view,
+                                  const hy::collapser_t& collapser) {
+    const auto flattened =
+      hy::flatten_entities(entities, collapser, root_handles);
+    auto uncached_collapser = collapser;
+    uncached_collapser.clear_expanded_counts();
+    bool counted = true;
+    for (const auto root_handle : root_handles) {
+      counted = counted
+             && hy::expanded_count(root_handle, entities, collapser)
+                  == hy::expanded_count(
+                    root_handle, entities, uncached_collapser);
+    }
+    return counted
+        && std::equal(
+             flattened.begin(), flattened.end(),
+             view.flattened_handles().begin(), view.flattened_handles().end(),
+             [](const auto& lhs, const auto& rhs) {
+               return lhs.entity_handle_ == rhs.entity_handle_
+                   && lhs.indent_ == rhs.indent_;
+             });
+  };
+
+  SUBCASE("edits through one view patch the other") {
+    // entity 2
+    repeat_n(2, [&] { view_a.move_down(); });
+    view_a.add_child(entities, collapser_a);
+    CHECK(view_b.flattened_handles().size() == 11);
+    CHECK(matches_entities(view_b, collapser_b));
+    view_a.add_sibling(entities, collapser_a, root_handles);
+    CHECK(matches_entities(view_b, collapser_b));
+    // under collapsed entity 7 so no rows are added
+    view_a.move_selected_to(
+      thh::handle_t(7, 0), entities, collapser_a, root_handles);
+    CHECK(view_b.flattened_handles().size() == 6);
+    CHECK(matches_entities(view_b, collapser_b));
+    view_a.remove(entities, collapser_a, root_handles);
+    CHECK(matches_entities(view_b, collapser_b));
+    CHECK(matches_entities(view_a, collapser_a));
+  }
+
+  SUBCASE("selected entity stays selected") {
+    // entity 7
+    repeat_n(7, [&] { view_b.move_down(); });
+    CHECK(view_b.selected_handle() == thh::handle_t(7, 0));
+    // remove entity 2 (and its four descendants) above it
+    repeat_n(2, [&] { view_a.move_down(); });
+    view_a.remove(entities, collapser_a, root_handles);
+    CHECK(view_b.selected_handle() == thh::handle_t(7, 0));
+    CHECK(view_b.selected_index() == 2);
+  }
+
+  SUBCASE("renamed entity is published") {
+    std::vector<hy::hierarchy_event_t> published;
+    events.subscribe([&published](const hy::hierarchy_event_t& event) {
+      published.push_back(event);
+    });
+    view_a.move_down();
+    view_a.rename("renamed", entities);
+    REQUIRE(published.size() == 1);
+    CHECK(published.front().type_ == hy::hierarchy_event_e::renamed);
+    CHECK(published.front().entity_handle_ == thh::handle_t(1, 0));
+    CHECK(published.front().parent_handle_ == thh::handle_t(0, 0));
+  }
+
+  SUBCASE("renaming through a view updates every subscriber") {
+    hy::name_index_t name_index;
+    for (const auto root_handle : root_handles) {
+      name_index.add_subtree(root_handle, entities);
+    }
+    hy::subscribe(events, name_index, entities);
+    hy::filtered_view_t filtered_view(10);
+    filtered_view.set_query("probe", entities, root_handles);
+    hy::subscribe(events, filtered_view, entities, root_handles);
+    CHECK(filtered_view.row_count() == 0);
+
+    // entity 5 (under entities 0 and 2)
+    view_a.goto_entity(thh::handle_t(5, 0), entities, collapser_a);
+    view_a.rename("Light_Probe", entities);
+    CHECK(
+      entities
+        .call_return(
+          thh::handle_t(5, 0),
+          [](const auto& entity) { return std::string(entity.name_); })
+        .value_or("")
+      == "Light_Probe");
+    CHECK(
+      name_index.find("probe", entities)
+      == std::vector<thh::handle_t>{thh::handle_t(5, 0)});
+    REQUIRE(filtered_view.row_count() == 3);
+    CHECK(filtered_view.row(2).entity_handle_ == thh::handle_t(5, 0));
+
+    view_a.rename("entity_5", entities);
+    CHECK(name_index.find("probe", entities).empty());
+    CHECK(name_index.find("entity_5", entities).size() == 1);
+    CHECK(filtered_view.row_count() == 0);
+  }
+
+  SUBCASE("unsubscribed view is not patched") {
+    const auto subscription = hy::subscribe(
+      events, view_b, entities, collapser_b, root_handles);
+    events.unsubscribe(subscription);
+    // the first subscription of view_b is still patched
+    view_a.add_child(entities, collapser_a);
+    CHECK(matches_entities(view_b, collapser_b));
+  }
+
+  SUBCASE("views stay consistent through edits made through either") {
+    uint32_t seed = 7;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 16;
+    };
+    repeat_n(1000, [&] {
+      const bool a = next() % 2 == 0;
+      auto& view = a ? view_a : view_b;
+      auto& collapser = a ? collapser_a : collapser_b;
+      switch (next() % 9) {
+        case 0:
+          view.add_child(entities, collapser);
+          break;
+        case 1:
+          view.add_sibling(entities, collapser, root_handles);
+          break;
+        case 2:
+          view.collapse(entities, collapser);
+          break;
+        case 3:
+          view.expand(entities, collapser);
+          break;
+        case 4:
+          if (next() % 4 == 0) {
+            view.remove(entities, collapser, root_handles);
+          }
+          break;
+        case 5:
+          view.move_selected_to(
+            (a ? view_b : view_a).selected_handle(), entities, collapser,
+            root_handles);
+          break;
+        case 6:
+          view.move_up();
+          break;
+        default:
+          view.move_down();
+          break;
+      }
+      REQUIRE(matches_entities(view_a, collapser_a));
+      REQUIRE(matches_entities(view_b, collapser_b));
+    });
+  }
+}
+
+TEST_CASE("Journal") {
+  thh::handle_vector_t<hy::entity_t> entities;
+  auto root_handles = demo::create_sample_entities(entities);
+
+  hy::collapser_t collapser;
+  hy::view_t view(
+    hy::flatten_entities(entities, collapser, root_handles), 0, 10);
+  hy::journal_t journal;
+
+  // every entity (handles change when restored so names are used)
+  const auto describe = [&] {
+    std::vector<std::string> description;
+    for (const auto& row :
+         hy::flatten_entities(entities, hy::collapser_t(), root_handles)) {
+      entities.call(row.entity_handle_, [&](const hy::entity_t& entity) {
+        description.push_back(
+          std::string(row.indent_, ' ') + std::string(entity.name_)
+          + (collapser.collapsed(row.entity_handle_) ? "+" : ""));
+      });
+    }
+    return description;
+  };
+  const auto matches_entities = [&](
+                                  const hy::view_t& view,
+                                  const hy::collapser_t& collapser) {
+    const auto flattened =
+      hy::flatten_entities(entities, collapser, root_handles);
+    auto uncached_collapser = collapser;
+    uncached_collapser.clear_expanded_counts();
+    bool counted = true;
+    for (const auto root_handle : root_handles) {
+      counted = counted
+             && hy::expanded_count(root_handle, entities, collapser)
+                  == hy::expanded_count(
+                    root_handle, entities, uncached_collapser);
+    }
+    return counted
+        && std::equal(
+             flattened.begin(), flattened.end(),
+             view.flattened_handles().begin(), view.flattened_handles().end(),
+             [](const auto& lhs, const auto& rhs) {
+               return lhs.entity_handle_ == rhs.entity_handle_
+                   && lhs.indent_ == rhs.indent_;
+             });
+  };
+
+  SUBCASE("undo and redo each edit") {
+    std::vector<std::vector<std::string>> descriptions = {describe()};
+    // entity 2
+    repeat_n(2, [&] { view.move_down(); });
+    journal.add_child(view, entities, collapser);
+    descriptions.push_back(describe());
+    journal.collapse(view, entities, collapser);
+    descriptions.push_back(describe());
+    journal.add_sibling(view, entities, collapser, root_handles);
+    descriptions.push_back(describe());
+    // entity 2 under entity 8
+    journal.move_selected_to(
+      thh::handle_t(8, 0), view, entities, collapser, root_handles);
+    descriptions.push_back(describe());
+    // entity 0 (without the moved entity 2)
+    repeat_n(10, [&] { view.move_up(); });
+    journal.remove(view, entities, collapser, root_handles);
+    descriptions.push_back(describe());
+    // entity 7
+    journal.remove(view, entities, collapser, root_handles);
+    descriptions.push_back(describe());
+    CHECK(
+      descriptions.back()
+      == std::vector<std::string>{
+        "entity_8", " entity_9", " entity_2+", "  entity_5", "  entity_6",
+        "   entity_10", "  entity_11", "  entity_12"});
+
+    for (int i = (int)descriptions.size() - 2; i >= 0; i--) {
+      REQUIRE(journal.undo(view, entities, collapser, root_handles));
+      CHECK(describe() == descriptions[i]);
+      CHECK(matches_entities(view, collapser));
+    }
+    CHECK(!journal.undo(view, entities, collapser, root_handles));
+    for (int i = 1; i < (int)descriptions.size(); i++) {
+      REQUIRE(journal.redo(view, entities, collapser, root_handles));
+      CHECK(describe() == descriptions[i]);
+      CHECK(matches_entities(view, collapser));
+    }
+    CHECK(!journal.redo(view, entities, collapser, root_handles));
+  }
+
+  SUBCASE("undone entity is selected") {
+    journal.remove(view, entities, collapser, root_handles);
+    journal.undo(view, entities, collapser, root_handles);
+    CHECK(view.selected_index() == 0);
+    entities.call(view.selected_handle(), [](const hy::entity_t& entity) {
+      CHECK(entity.name_ == "entity_0");
+    });
+  }
+
+  SUBCASE("removed entities released by reclaim") {
+    journal.remove(view, entities, collapser, root_handles);
+    CHECK(entities.size() == 12);
+    CHECK(journal.reclaim(3, entities, collapser) == 3);
+    journal.reclaim(100, entities, collapser);
+    CHECK(entities.size() == 5);
+    // restored from the packed entities
+    journal.undo(view, entities, collapser, root_handles);
+    CHECK(entities.size() == 12);
+    CHECK(matches_entities(view, collapser));
+  }
+
+  SUBCASE("new edit discards undone edits") {
+    journal.add_child(view, entities, collapser);
+    journal.undo(view, entities, collapser, root_handles);
+    CHECK(journal.can_redo());
+    journal.collapse(view, entities, collapser);
+    CHECK(!journal.can_redo());
+    CHECK(journal.entry_count() == 1);
+  }
+
+  SUBCASE("oldest entries dropped past max entries") {
+    hy::journal_t short_journal(2);
+    repeat_n(3, [&] { short_journal.add_child(view, entities, collapser); });
+    CHECK(short_journal.entry_count() == 2);
+    CHECK(short_journal.undo(view, entities, collapser, root_handles));
+    CHECK(short_journal.undo(view, entities, collapser, root_handles));
+    CHECK(!short_journal.undo(view, entities, collapser, root_handles));
+    CHECK(matches_entities(view, collapser));
+  }
+
+  SUBCASE("journal cleared when an edit packs more than max bytes") {
+    hy::journal_t small_journal(256, 64);
+    small_journal.add_child(view, entities, collapser);
+    // entity 0 and its seven descendants
+    small_journal.remove(view, entities, collapser, root_handles);
+    CHECK(!small_journal.can_undo());
+    CHECK(small_journal.packed_bytes() == 0);
+  }
+
+  SUBCASE("other views follow undo and redo") {
+    hy::hierarchy_events_t events;
+    hy::collapser_t other_collapser;
+    other_collapser.collapse(thh::handle_t(2, 0), entities);
+    hy::view_t other_view(
+      hy::flatten_entities(entities, other_collapser, root_handles), 0, 10);
+    hy::subscribe(events, view, entities, collapser, root_handles);
+    hy::subscribe(
+      events, other_view, entities, other_collapser, root_handles);
+    view.move_down();
+    journal.move_selected_to(
+      thh::handle_t(9, 0), view, entities, collapser, root_handles);
+    view.move_up();
+    journal.remove(view, entities, collapser, root_handles);
+    CHECK(matches_entities(other_view, other_collapser));
+    journal.undo(view, entities, collapser, root_handles);
+    CHECK(matches_entities(other_view, other_collapser));
+    journal.undo(view, entities, collapser, root_handles);
+    CHECK(matches_entities(other_view, other_collapser));
+    journal.redo(view, entities, collapser, root_handles);
+    journal.redo(view, entities, collapser, root_handles);
+    CHECK(matches_entities(other_view, other_collapser));
+  }
+
+  SUBCASE("undoing every edit restores the entities") {
+    // keeps every edit
+    hy::journal_t full_journal(1000);
+    const auto initial = describe();
+    uint32_t seed = 11;
+    const auto next = [&seed] {
+      seed = seed * 1664525u + 1013904223u;
+      return seed >> 16;
+    };
+    repeat_n(1000, [&] {
+      switch (next() % 10) {
+        case 0:
+          full_journal.add_child(view, entities, collapser);
+          break;
+        case 1:
+          full_journal.add_sibling(view, entities, collapser, root_handles);
+          break;
+        case 2:
+          full_journal.collapse(view, entities, collapser);
+          break;
+        case 3:
+          full_journal.expand(view, entities, collapser);
+          break;
+        case 4:
+          if (next() % 4 == 0) {
+            full_journal.remove(view, entities, collapser, root_handles);
+          }
+          break;
+        case 5:
+          full_journal.move_selected_to(
+            view.recorded_handle(), view, entities, collapser, root_handles);
+          view.record_handle();
+          break;
+        case 6:
+          full_journal.undo(view, entities, collapser, root_handles);
+          break;
+        case 7:
+          full_journal.redo(view, entities, collapser, root_handles);
+          break;
+        case 8:
+          view.move_up();
+          break;
+        default:
+          view.move_down();
+          break;
+      }
+      REQUIRE(matches_entities(view, collapser));
+    });
+    while (full_journal.undo(view, entities, collapser, root_handles)) {
+      REQUIRE(matches_entities(view, collapser));
+    }
+    CHECK(describe() == initial);
+  }
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  // a single draw recorded by draw_commands_t
+  struct draw_command_t {
+    enum class type_e : uint8_t { glyph, text, bold, invert };
+
+    type_e type_ = type_e::glyph;
+    glyph_e glyph_ = glyph_e::connection; // glyph
+    bool enabled_ = false; // bold and invert
+    int32_t x_ = 0; // glyph
+    int32_t y_ = 0; // glyph
+    // text (drawn after the preceding glyph), a span of draw_commands_t text
+    int32_t text_offset_ = 0;
+    int32_t text_size_ = 0;
+  };
+
+  // caller owned buffer of draw commands for a frame, used as a display
+  // backend (see display_backend_t) to record a frame instead of drawing it
+  // note: clear keeps all allocated memory so rendering the same amount
+  // (or less) each frame does not allocate
+  struct draw_commands_t {
+    void clear();
+
+    void set_bold(bool bold);
+    void set_invert(bool invert);
+    void draw_glyph(int x, int y, glyph_e glyph);
+    void draw(std::string_view str);
+    int indent_width() const { return indent_width_; }
+
+    const std::vector<draw_command_t>& commands() const { return commands_; }
+    std::string_view text(const draw_command_t& command) const {
+      return std::string_view(text_).substr(
+        command.text_offset_, command.text_size_);
+    }
+
+    int indent_width_ = 1;
+
+  private:
+    std::vector<draw_command_t> commands_;
+    std::string text_;
+    // only changes to attributes are recorded
+    bool bold_ = false;
+    bool invert_ = false;
+  };
+} // namespace hy
@@ -1,81 +1,366 @@
 #pragma once
 
+#include "hierarchy/flattened-handles.hpp"
+#include "hierarchy/name-pool.hpp"
+
 #include <thh-handle-vector/handle-vector.hpp>
 
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace hy {
+  struct collapser_t;
+  struct hierarchy_event_t;
+  struct hierarchy_events_t;
+  struct soa_hierarchy_t;
+  struct thread_pool_t;
+
   struct entity_t {
     entity_t() = default;
-    explicit entity_t(std::string name) : name_(std::move(name)) {}
-    std::string name_;
+    explicit entity_t(std::string_view name) : name_(name) {}
+    // interned in entity_names() so entities don't each own an allocation
+    pooled_name_t name_;
     std::vector<thh::handle_t> children_;
     thh::handle_t parent_;
+    // position in the parent's children_ (or root_handles for roots)
+    int32_t sibling_index_ = 0;
   };
 
+  // append child_handles to entity_handle's children, pass the collapser
+  // (if any) whose expanded counts may be cached so entity_handle and its
+  // ancestors are updated for the new rows
   void add_children(
     thh::handle_t entity_handle,
     const std::vector<thh::handle_t>& child_handles,
-    thh::handle_vector_t<entity_t>& entities);
+    thh::handle_vector_t<entity_t>& entities,
+    collapser_t* collapser = nullptr);
+
+  // create entities in bulk, parent_indices holds the index of each entity's
+  // parent (-1 for roots) and children keep the order they appear in
+  // note: each entity is visited once and its children_ sized exactly once,
+  // returns the new handles (in the same order) and appends new roots to
+  // root_handles (use add_children to attach them to an existing entity)
+  // nothing is added (and no handles returned) if names and parent_indices
+  // differ in size, an index is out of range or the parents form a cycle
+  std::vector<thh::handle_t> add_entities(
+    const std::vector<int32_t>& parent_indices,
+    const std::vector<std::string>& names,
+    thh::handle_vector_t<entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles);
+  // create entities in bulk from a depth first list of depths and names, an
+  // entity is a child of the closest previous entity one level shallower
+  std::vector<thh::handle_t> add_entities(
+    const std::vector<std::pair<int, std::string>>& depth_names,
+    thh::handle_vector_t<entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles);
+
+  // position of entity_handle in siblings (its parent's children_ or
+  // root_handles) in O(1) using entity_t::sibling_index_, falls back to a
+  // search if the position is stale (e.g. root_handles built by hand)
+  std::optional<int32_t> sibling_index(
+    thh::handle_t entity_handle, const std::vector<thh::handle_t>& siblings,
+    const thh::handle_vector_t<entity_t>& entities);
 
   std::vector<thh::handle_t> siblings(
     thh::handle_t entity_handle, const thh::handle_vector_t<entity_t>& entities,
     const std::vector<thh::handle_t>& root_handles);
+  // siblings without a copy, the parent's children_ (or root_handles for
+  // roots), empty if entity_handle is invalid
+  const std::vector<thh::handle_t>& sibling_handles(
+    thh::handle_t entity_handle, const thh::handle_vector_t<entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles);
+  // children without a copy, empty if entity_handle is invalid
+  const std::vector<thh::handle_t>& child_handles(
+    thh::handle_t entity_handle,
+    const thh::handle_vector_t<entity_t>& entities);
 
   bool has_children(
     thh::handle_t handle, const thh::handle_vector_t<hy::entity_t>& entities);
 
   struct collapser_t {
+    // note: expanding without entities discards all cached expanded counts
     void expand(thh::handle_t entity_handle);
+    void expand(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities);
     void collapse(
       thh::handle_t entity_handle,
       const thh::handle_vector_t<hy::entity_t>& entities);
+    void collapse(
+      thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy);
     bool expanded(thh::handle_t handle) const;
     bool collapsed(thh::handle_t handle) const;
+    // forget collapse state of an entity that is being removed, cached
+    // counts are kept so the caller must update its ancestors (view_t::remove
+    // does) before it is removed
+    void remove(thh::handle_t entity_handle);
+
+    // cached number of visible rows for an entity and its descendants
+    std::optional<int> cached_expanded_count(thh::handle_t handle) const;
+    void cache_expanded_count(thh::handle_t handle, int count) const;
+    // apply a change in visible rows below parent_handle to it and each
+    // ancestor, stopping at the first collapsed entity
+    void update_expanded_count(
+      thh::handle_t parent_handle, int delta,
+      const thh::handle_vector_t<hy::entity_t>& entities);
+    // discard all cached expanded counts (e.g. after editing entities
+    // directly instead of through view_t)
+    void clear_expanded_counts() { expanded_count_epoch_++; }
 
   private:
-    std::vector<thh::handle_t> collapsed_;
+    void set_collapsed(thh::handle_t entity_handle);
+    // generation of each collapsed handle, indexed by handle id (-1 if
+    // expanded), stale handles never match as the generation will differ
+    std::vector<int32_t> collapsed_;
+
+    struct expanded_count_t {
+      int32_t gen_ = -1;
+      int32_t epoch_ = -1;
+      int32_t count_ = 0;
+    };
+    // indexed by handle id, valid when generation and epoch match
+    mutable std::vector<expanded_count_t> expanded_counts_;
+    int32_t expanded_count_epoch_ = 0;
+  };
+
+  // collapser for pre_order_t that visits every descendant
+  struct expand_all_t {
+    bool collapsed(thh::handle_t /*handle*/) const { return false; }
+  };
+
+  // lazily visits entities in the order flatten_entity produces, yielding one
+  // (handle, indent) at a time, descendants of entities collapser reports as
+  // collapsed (collapser_t, interaction_t or expand_all_t) are skipped
+  // note: entities and collapser must outlive the traversal, and entities
+  // must not be added or removed while it is in progress
+  template<typename Collapser>
+  struct pre_order_t {
+    struct iterator_t {
+      using iterator_category = std::input_iterator_tag;
+      using value_type = flattened_handle_t;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const flattened_handle_t*;
+      using reference = const flattened_handle_t&;
+
+      iterator_t() = default;
+      explicit iterator_t(pre_order_t* pre_order) : pre_order_(pre_order) {}
+
+      reference operator*() const { return pre_order_->current(); }
+      pointer operator->() const { return &pre_order_->current(); }
+      iterator_t& operator++() {
+        pre_order_->next();
+        return *this;
+      }
+
+      // iterators compare equal when both have finished (end is null)
+      friend bool operator==(const iterator_t& lhs, const iterator_t& rhs) {
+        return lhs.done() == rhs.done();
+      }
+      friend bool operator!=(const iterator_t& lhs, const iterator_t& rhs) {
+        return !(lhs == rhs);
+      }
+
+    private:
+      bool done() const { return pre_order_ == nullptr || pre_order_->done(); }
+
+      pre_order_t* pre_order_ = nullptr;
+    };
+
+    pre_order_t() = default;
+    pre_order_t(
+      thh::handle_t entity_handle, int indent,
+      const thh::handle_vector_t<entity_t>& entities,
+      const Collapser& collapser);
+    // visit each root and its descendants in turn (roots have indent 0)
+    pre_order_t(
+      const std::vector<thh::handle_t>& root_handles,
+      const thh::handle_vector_t<entity_t>& entities,
+      const Collapser& collapser);
+
+    // restart the traversal, reusing the stack allocated so far
+    void reset(
+      thh::handle_t entity_handle, int indent,
+      const thh::handle_vector_t<entity_t>& entities,
+      const Collapser& collapser);
+    void reset(
+      const std::vector<thh::handle_t>& root_handles,
+      const thh::handle_vector_t<entity_t>& entities,
+      const Collapser& collapser);
+
+    bool done() const { return done_; }
+    const flattened_handle_t& current() const { return current_; }
+    // entity of the current row (null if its handle is invalid)
+    const entity_t* entity() const { return entity_; }
+    void next() {
+      // children are pushed when moving past an entity so skip_descendants
+      // can be called after looking at it
+      if (
+        !skip_descendants_ && entity_ != nullptr
+        && !entity_->children_.empty()
+        && !collapser_->collapsed(current_.entity_handle_)) {
+        push_children();
+      }
+      pop();
+    }
+    // the next call to next() moves past the descendants of current
+    void skip_descendants() { skip_descendants_ = true; }
+    // append the current and all remaining rows to flattened and finish,
+    // cheaper than calling next() for each row
+    void append_remaining(std::vector<flattened_handle_t>& flattened);
+
+    iterator_t begin() { return iterator_t(this); }
+    iterator_t end() { return iterator_t(); }
+
+  private:
+    void push_children();
+    void pop() {
+      skip_descendants_ = false;
+      done_ = stack_.empty();
+      if (!done_) {
+        current_ = stack_.back();
+        stack_.pop_back();
+        entity_ = entities_
+                    ->call_return(
+                      current_.entity_handle_,
+                      [](const entity_t& entity) { return &entity; })
+                    .value_or(nullptr);
+      }
+    }
+
+    const thh::handle_vector_t<entity_t>* entities_ = nullptr;
+    const Collapser* collapser_ = nullptr;
+    // rows still to visit, next row at the back
+    std::vector<flattened_handle_t> stack_;
+    flattened_handle_t current_{};
+    const entity_t* entity_ = nullptr;
+    bool done_ = true;
+    bool skip_descendants_ = false;
   };
 
+  // scratch memory for traversals, keep one and pass it to repeated calls so
+  // they allocate nothing once its buffers have grown
+  struct traversal_context_t {
+    // expanded_count post-order traversal
+    struct count_frame_t {
+      thh::handle_t handle_;
+      const std::vector<thh::handle_t>* children_;
+      size_t next_child_;
+      int count_;
+    };
+    std::vector<count_frame_t> count_frames_;
+    // flatten_entity traversal and result
+    pre_order_t<collapser_t> visible_;
+    std::vector<flattened_handle_t> flattened_handles_;
+    // entity_and_descendants stack and result
+    std::vector<thh::handle_t> handle_stack_;
+    std::vector<thh::handle_t> handles_;
+  };
+
+  // number of visible rows for an entity and its descendants, results are
+  // cached in collapser and kept up to date by view_t operations
   int expanded_count(
     const thh::handle_t& entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities,
     const collapser_t& collapser);
-
-  struct flattened_handle_t {
-    thh::handle_t entity_handle_;
-    int32_t indent_;
-  };
+  int expanded_count(
+    const thh::handle_t& entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser, traversal_context_t& traversal_context);
+
+  // make entity_handle (and its descendants) the last child of parent_handle
+  // (or the last root if parent_handle is null), cached expanded counts are
+  // kept up to date, returns false if either handle is invalid or the move
+  // would create a cycle (found by walking parent_handle's ancestors)
+  bool reparent(
+    thh::handle_t entity_handle, thh::handle_t parent_handle,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles);
+
+  // remove entity_handle (and its descendants) from its parent's children (or
+  // root_handles) leaving it without a parent, and insert an unlinked entity
+  // at sibling_index among parent_handle's children (or root_handles)
+  // note: cached expanded counts are not updated (view_t::notify does)
+  void unlink_entity(
+    thh::handle_t entity_handle, thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles);
+  void link_entity(
+    thh::handle_t entity_handle, thh::handle_t parent_handle,
+    int32_t sibling_index, thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles);
 
   struct flattened_handle_position_t {
     flattened_handle_t flattened_handle_;
     int32_t index_;
   };
 
-  struct indent_tracker_t {
-    int indent_ = 0;
-    int count_ = 0;
-  };
-
   std::optional<int> go_to_entity(
     thh::handle_t entity_handle, const thh::handle_vector_t<hy::entity_t>& entities,
     collapser_t& collapser, std::vector<flattened_handle_t>& flattened_handles);
+  std::optional<int> go_to_entity(
+    thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    flattened_handles_t& flattened_handles);
 
   std::vector<flattened_handle_t> flatten_entity(
     thh::handle_t entity_handle, int indent,
     const thh::handle_vector_t<hy::entity_t>& entities,
     const collapser_t& collapser);
+  // result is held by traversal_context until it is next used to flatten
+  const std::vector<flattened_handle_t>& flatten_entity(
+    thh::handle_t entity_handle, int indent,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser, traversal_context_t& traversal_context);
 
   std::vector<flattened_handle_t> flatten_entities(
     const thh::handle_vector_t<hy::entity_t>& entities,
     const collapser_t& collapser,
     const std::vector<thh::handle_t>& root_handles);
+  // flattens roots in parallel on thread_pool, the result is identical to
+  // the serial version
+  std::vector<flattened_handle_t> flatten_entities(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles,
+    thread_pool_t& thread_pool);
 
   std::vector<thh::handle_t> entity_and_descendants(
     thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities);
+  // result is held by traversal_context until it is next used to find
+  // descendants
+  const std::vector<thh::handle_t>& entity_and_descendants(
+    thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    traversal_context_t& traversal_context);
+
+  // entities unlinked from the hierarchy that are still to be removed,
+  // releasing them a batch at a time means removing a large subtree doesn't
+  // stall a single frame
+  // note: queued entities keep their handles (and their slots in entities)
+  // until they are reclaimed
+  struct entity_reclaimer_t {
+    // queue an unlinked entity (one that is not a root or a child of another
+    // entity) and all of its descendants
+    void push(thh::handle_t entity_handle);
+    // remove up to budget queued entities, forgetting their collapse state,
+    // returns the number removed
+    int reclaim(
+      int budget, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser);
+    void reclaim_all(
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser);
+    bool empty() const { return handles_.empty(); }
+
+  private:
+    // queued entities whose children are not queued yet (in pre-order)
+    std::vector<thh::handle_t> handles_;
+  };
 
   // view into the collection of entities
   struct view_t {
@@ -89,6 +374,11 @@ namespace hy {
     void expand(
       const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser);
 
+    // select entity_handle (expanding its collapsed ancestors if it is
+    // hidden), returns false if it is not in the view
+    bool goto_entity(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser);
     void goto_recorded_handle(
       const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser);
     void record_handle();
@@ -103,8 +393,42 @@ namespace hy {
     void remove(
       thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
       std::vector<thh::handle_t>& root_handles);
+    // unlink the selected entity and erase its rows, it is queued on
+    // reclaimer with its descendants to be removed later so (with its
+    // expanded count cached) the cost doesn't depend on the subtree size
+    void remove(
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles,
+      entity_reclaimer_t& reclaimer);
+    // reparent the selected entity and move its rows (if still visible) to
+    // their new position, the cost depends on the number of rows moved and
+    // not the number of rows in the view
+    bool move_selected_to(
+      thh::handle_t parent_handle, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, std::vector<thh::handle_t>& root_handles);
+    // rename the selected entity, the name index and filtered views learn of
+    // renames through their subscriptions (see publish_to)
+    void rename(
+      std::string_view name, thh::handle_vector_t<hy::entity_t>& entities);
+
+    // publish the edits above to events (except to subscription, the view's
+    // own listener), nullptr stops publishing
+    void publish_to(hierarchy_events_t* events, int32_t subscription = -1);
+    // patch the rows for an edit made elsewhere (the entities must be as the
+    // edit left them), the cost depends on the number of rows added or
+    // removed and the selected entity stays selected if it is still visible
+    void apply(
+      const hierarchy_event_t& event,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, const std::vector<thh::handle_t>& root_handles);
+    // apply an edit made directly to the entities (e.g. by journal_t) to this
+    // view and publish it to the others
+    void notify(
+      const hierarchy_event_t& event,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, const std::vector<thh::handle_t>& root_handles);
 
-    const std::vector<flattened_handle_t>& flattened_handles() const {
+    const flattened_handles_t& flattened_handles() const {
       return flattened_handles_;
     }
 
@@ -116,11 +440,24 @@ namespace hy {
     std::optional<int> selected_indent() const;
 
   private:
-    std::vector<flattened_handle_t> flattened_handles_;
+    flattened_handles_t flattened_handles_;
+    // reused by operations so editing the view doesn't allocate scratch memory
+    traversal_context_t traversal_context_;
     int offset_ = 0;
     int count_ = 20;
     std::optional<int> selected_ = 0;
     thh::handle_t recorded_handle_;
+    hierarchy_events_t* events_ = nullptr;
+    int32_t subscription_ = -1;
+
+    void publish(const hierarchy_event_t& event) const;
+    // insert the rows of entity_handle (and its visible descendants) if its
+    // parent is visible and expanded, returns the number inserted
+    int32_t insert_rows(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles);
   };
 
   std::pair<thh::handle_t, int> root_handle(
@@ -154,6 +491,67 @@ namespace hy {
     int indent_width_ = 1;
   };
 
+  // connector glyphs drawn before each row
+  enum class glyph_e : uint8_t {
+    connection, // line continuing past this row
+    end, // last child
+    mid // child with siblings below
+  };
+
+  // display backends are any type providing
+  //   void set_bold(bool bold);
+  //   void set_invert(bool invert);
+  //   void draw_glyph(int x, int y, glyph_e glyph);
+  //   void draw(std::string_view str); // continues from the last glyph
+  //   int indent_width() const;
+  // calls are resolved at compile time so a backend can be inlined
+  template<typename Backend>
+  using display_backend_t = decltype(std::declval<Backend&>().draw_glyph(
+    0, 0, glyph_e::connection));
+
+  // display backend forwarding to the std::function callbacks of display_ops_t
+  struct display_ops_backend_t {
+    void set_bold(const bool bold) const { display_ops_->set_bold_fn_(bold); }
+    void set_invert(const bool invert) const {
+      display_ops_->set_invert_fn_(invert);
+    }
+    void draw_glyph(const int x, const int y, const glyph_e glyph) const {
+      switch (glyph) {
+        case glyph_e::connection:
+          display_ops_->draw_at_fn_(x, y, display_ops_->connection_);
+          break;
+        case glyph_e::end:
+          display_ops_->draw_at_fn_(x, y, display_ops_->end_);
+          break;
+        case glyph_e::mid:
+          display_ops_->draw_at_fn_(x, y, display_ops_->mid_);
+          break;
+      }
+    }
+    void draw(const std::string_view str) const {
+      display_ops_->draw_fn_(str);
+    }
+    int indent_width() const { return display_ops_->indent_width_; }
+
+    const display_ops_t* display_ops_ = nullptr;
+  };
+
+  // draw the rows [first, last) starting at row zero, connections come from
+  // the sibling positions of each row's ancestors so the cost depends only on
+  // the number of rows drawn and their depth
+  template<typename Iterator, typename Backend>
+  void display_flattened_handles(
+    Iterator first, Iterator last, std::optional<int> selected_row,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles,
+    const collapser_t& collapser, Backend& backend);
+
+  template<typename Backend, typename = display_backend_t<Backend>>
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const view_t& view,
+    const collapser_t& collapser, Backend& backend);
+
   void display_scrollable_hierarchy(
     const thh::handle_vector_t<hy::entity_t>& entities,
     const std::vector<thh::handle_t>& root_handles, const view_t& view,
@@ -219,6 +617,14 @@ namespace hy {
     const std::vector<thh::handle_t>& root_handles, const display_fn& display,
     const scope_exit_fn& scope_exit,
     const display_connection_fn& display_connection);
+
+  // backend provides display, scope_exit and display_connection member
+  // functions matching display_fn, scope_exit_fn and display_connection_fn
+  template<typename Backend>
+  void display_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const interaction_t& interaction,
+    const std::vector<thh::handle_t>& root_handles, Backend& backend);
 } // namespace hy
 
 namespace demo {
@@ -236,3 +642,5 @@ namespace demo {
     const std::vector<thh::handle_t>& root_handles,
     hy::interaction_t& interaction);
 } // namespace demo
+
+#include "entity.inl"
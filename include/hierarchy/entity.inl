@@ -0,0 +1,237 @@
+#include <algorithm>
+
+namespace hy {
+  namespace detail {
+    inline thh::handle_t parent_handle(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          entity_handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    }
+
+    inline bool last_sibling(
+      const thh::handle_t entity_handle, const thh::handle_t parent_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles) {
+      if (parent_handle == thh::handle_t()) {
+        return !root_handles.empty() && root_handles.back() == entity_handle;
+      }
+      return entities
+        .call_return(
+          parent_handle,
+          [entity_handle](const entity_t& parent) {
+            return !parent.children_.empty()
+                && parent.children_.back() == entity_handle;
+          })
+        .value_or(false);
+    }
+  } // namespace detail
+
+  template<typename Iterator, typename Backend>
+  void display_flattened_handles(
+    Iterator first, const Iterator last, const std::optional<int> selected_row,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles,
+    const collapser_t& collapser, Backend& backend) {
+    for (int row = 0; first != last; ++first, ++row) {
+      const flattened_handle_t& flattened_handle = *first;
+      const auto parent_handle =
+        detail::parent_handle(flattened_handle.entity_handle_, entities);
+      // draw a connection for each ancestor with siblings still to come
+      auto ancestor_handle = parent_handle;
+      for (int indent = flattened_handle.indent_ - 1;
+           indent >= 0 && ancestor_handle != thh::handle_t(); --indent) {
+        const auto ancestor_parent_handle =
+          detail::parent_handle(ancestor_handle, entities);
+        if (!detail::last_sibling(
+              ancestor_handle, ancestor_parent_handle, entities,
+              root_handles)) {
+          backend.draw_glyph(
+            indent * backend.indent_width(), row, glyph_e::connection);
+        }
+        ancestor_handle = ancestor_parent_handle;
+      }
+      backend.draw_glyph(
+        flattened_handle.indent_ * backend.indent_width(), row,
+        detail::last_sibling(
+          flattened_handle.entity_handle_, parent_handle, entities,
+          root_handles)
+          ? glyph_e::end
+          : glyph_e::mid);
+      if (row == selected_row) {
+        backend.set_invert(true);
+      }
+      if (collapser.collapsed(flattened_handle.entity_handle_)) {
+        backend.set_bold(true);
+      }
+      entities.call(flattened_handle.entity_handle_, [&](const auto& entity) {
+        backend.draw(entity.name_);
+      });
+      backend.set_invert(false);
+      backend.set_bold(false);
+    }
+  }
+
+  template<typename Backend, typename>
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const view_t& view,
+    const collapser_t& collapser, Backend& backend) {
+    const int total_handles = view.flattened_handles().size();
+    const int offset = std::min(view.offset(), total_handles);
+    const int count = std::min(total_handles - offset, view.count());
+    display_flattened_handles(
+      view.flattened_handles().begin() + offset,
+      view.flattened_handles().begin() + offset + count,
+      view.selected_index().has_value()
+        ? std::optional<int>(*view.selected_index() - offset)
+        : std::nullopt,
+      entities, root_handles, collapser, backend);
+  }
+
+  template<typename Backend>
+  void display_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const interaction_t& interaction,
+    const std::vector<thh::handle_t>& root_handles, Backend& backend) {
+    // siblings still to visit at each indent (children of the entity last
+    // visited at the indent above)
+    std::vector<int> remaining(1, (int)root_handles.size());
+    int level = 0; // the level (row) in the hierarchy
+    int last_indent = 0; // most recent indent (col)
+    pre_order_t pre_order(root_handles, entities, interaction);
+    for (; !pre_order.done(); pre_order.next()) {
+      const auto entity_handle = pre_order.current().entity_handle_;
+      const int curr_indent = pre_order.current().indent_;
+
+      int last = last_indent;
+      while (curr_indent < last) {
+        backend.scope_exit();
+        last--;
+      }
+
+      const bool last_element = --remaining[curr_indent] == 0;
+      for (int indent = curr_indent - 1; indent >= 0; indent--) {
+        if (remaining[indent] != 0) {
+          backend.display_connection(level, indent);
+        }
+      }
+
+      if (const entity_t* entity = pre_order.entity(); entity != nullptr) {
+        const auto& children = entity->children_;
+        const bool collapsed = interaction.collapsed(entity_handle);
+
+        display_info_t display_info;
+        display_info.level = level;
+        display_info.indent = curr_indent;
+        display_info.entity_handle = entity_handle;
+        display_info.selected = interaction.selected() == entity_handle;
+        display_info.collapsed = collapsed && !children.empty();
+        display_info.has_children = !children.empty();
+        display_info.name = entity->name_;
+        display_info.last = last_element;
+
+        backend.display(display_info);
+
+        if (!children.empty() && !collapsed) {
+          remaining.resize(curr_indent + 2);
+          remaining[curr_indent + 1] = (int)children.size();
+        }
+      }
+      level++;
+      last_indent = curr_indent;
+    }
+
+    while (last_indent > 0) {
+      backend.scope_exit();
+      last_indent--;
+    }
+  }
+
+  template<typename Collapser>
+  pre_order_t<Collapser>::pre_order_t(
+    const thh::handle_t entity_handle, const int indent,
+    const thh::handle_vector_t<entity_t>& entities,
+    const Collapser& collapser) {
+    reset(entity_handle, indent, entities, collapser);
+  }
+
+  template<typename Collapser>
+  pre_order_t<Collapser>::pre_order_t(
+    const std::vector<thh::handle_t>& root_handles,
+    const thh::handle_vector_t<entity_t>& entities,
+    const Collapser& collapser) {
+    reset(root_handles, entities, collapser);
+  }
+
+  template<typename Collapser>
+  void pre_order_t<Collapser>::reset(
+    const thh::handle_t entity_handle, const int indent,
+    const thh::handle_vector_t<entity_t>& entities,
+    const Collapser& collapser) {
+    entities_ = &entities;
+    collapser_ = &collapser;
+    stack_.clear();
+    stack_.push_back(flattened_handle_t{entity_handle, indent});
+    pop();
+  }
+
+  template<typename Collapser>
+  void pre_order_t<Collapser>::reset(
+    const std::vector<thh::handle_t>& root_handles,
+    const thh::handle_vector_t<entity_t>& entities,
+    const Collapser& collapser) {
+    entities_ = &entities;
+    collapser_ = &collapser;
+    stack_.clear();
+    for (auto it = root_handles.rbegin(); it != root_handles.rend(); ++it) {
+      stack_.push_back(flattened_handle_t{*it, 0});
+    }
+    pop();
+  }
+
+  template<typename Collapser>
+  void pre_order_t<Collapser>::append_remaining(
+    std::vector<flattened_handle_t>& flattened) {
+    if (done_) {
+      return;
+    }
+    flattened.push_back(current_);
+    if (
+      !skip_descendants_ && entity_ != nullptr && !entity_->children_.empty()
+      && !collapser_->collapsed(current_.entity_handle_)) {
+      push_children();
+    }
+    // same traversal as next() without storing the state of each row
+    const auto& entities = *entities_;
+    const auto& collapser = *collapser_;
+    auto& stack = stack_;
+    while (!stack.empty()) {
+      const auto row = stack.back();
+      stack.pop_back();
+      flattened.push_back(row);
+      entities.call(row.entity_handle_, [&](const entity_t& entity) {
+        if (
+          !entity.children_.empty()
+          && !collapser.collapsed(row.entity_handle_)) {
+          for (auto it = entity.children_.rbegin();
+               it != entity.children_.rend(); ++it) {
+            stack.push_back(flattened_handle_t{*it, row.indent_ + 1});
+          }
+        }
+      });
+    }
+    pop();
+  }
+
+  template<typename Collapser>
+  void pre_order_t<Collapser>::push_children() {
+    const int indent = current_.indent_ + 1;
+    const auto& children = entity_->children_;
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      stack_.push_back(flattened_handle_t{*it, indent});
+    }
+  }
+} // namespace hy
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  struct thread_pool_t;
+
+  // condition entities must meet to match a filtered view (as well as
+  // containing its query)
+  using entity_filter_fn = std::function<bool(const entity_t&)>;
+
+  // view of the entities with names containing a query (case insensitive)
+  // and the ancestors leading to them, every matching entity is shown so
+  // collapse state is ignored
+  // rows are found once by scanning every entity (in parallel on thread_pool
+  // if provided, split by subtree), a query containing the previous query
+  // only checks the current matches (and keeps the rows if none are lost),
+  // shortening the query back to an earlier one restores the rows shown for
+  // it and other queries require a new scan
+  // note: call update after adding, removing, renaming or moving entities
+  // (subscribe does this for edits made through views)
+  struct filtered_view_t {
+    explicit filtered_view_t(int count, thread_pool_t* thread_pool = nullptr);
+
+    void set_query(
+      std::string_view query,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles);
+    // empty until a query is set
+    std::string_view query() const;
+    // only entities filter accepts can match, every entity is scanned again,
+    // queries narrow the matches as usual (without calling filter again) and
+    // with no query set every entity filter accepts is shown (an empty
+    // filter with no query stops filtering)
+    // note: filter is called on thread_pool's threads if there is one
+    void set_filter(
+      entity_filter_fn filter,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles);
+    // stop filtering (clearing the filter) and release all rows
+    void clear();
+
+    // rescan the rows under entity_handle's root (dropping the rows of
+    // entity_handle if it was a root that has been removed or reparented),
+    // after removing an entity pass its parent and after moving an entity
+    // pass its previous parent too
+    // note: only the root's rows are scanned and shown again (for the
+    // current query and each shorter one kept), rows after them are only
+    // shifted
+    void update(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles);
+    // rescan every entity for the current query
+    void refresh(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles);
+
+    void move_up();
+    void move_down();
+
+    int row_count() const { return (int)shown_.size(); }
+    const flattened_handle_t& row(const int index) const {
+      return scanned_.rows_[shown_[index].row_];
+    }
+    // true if the row matches the query (false for rows only shown as the
+    // ancestor of a match)
+    bool matched(const int index) const {
+      return scanned_.match_depths_[shown_[index].row_]
+          >= (int32_t)queries_.size();
+    }
+    // true if no siblings are shown after the row
+    bool last_sibling(const int index) const { return shown_[index].last_; }
+    // index of the row's parent (-1 for roots)
+    int parent_row(const int index) const { return shown_[index].parent_; }
+
+    int offset() const { return offset_; }
+    int count() const { return count_; }
+
+    thh::handle_t selected_handle() const;
+    std::optional<int> selected_index() const;
+    std::optional<int> selected_indent() const;
+
+  private:
+    // scanned rows with the match depth and lower case name of each row,
+    // names are stored contiguously so checking them does not look up each
+    // entity
+    struct rows_t {
+      // name must already be lower case
+      void push_back(
+        const flattened_handle_t& row, int32_t match_depth,
+        std::string_view name);
+      // append rows [first, last) of rows
+      void append(const rows_t& rows, size_t first, size_t last);
+      // replace rows [first, last) with rows
+      void replace(size_t first, size_t last, const rows_t& rows);
+      void clear();
+      size_t size() const { return rows_.size(); }
+      // end of the rows under the root at root_rows_[root]
+      int32_t root_end(const size_t root) const {
+        return root + 1 < root_rows_.size() ? root_rows_[root + 1]
+                                            : (int32_t)rows_.size();
+      }
+      std::string_view name(const size_t row) const {
+        const auto first = name_offsets_[row];
+        return std::string_view(names_).substr(
+          first, name_offsets_[row + 1] - first);
+      }
+
+      std::vector<flattened_handle_t> rows_;
+      // number of queries (from the first) each row's name matches, rows
+      // matching the current query may count queries since shortened
+      std::vector<int32_t> match_depths_;
+      // offset of each name in names_ (and the end of the last name)
+      std::vector<int64_t> name_offsets_ = {0};
+      std::string names_;
+      // index of each root row (indent 0)
+      std::vector<int32_t> root_rows_;
+    };
+
+    struct shown_row_t {
+      int32_t row_; // index in scanned_
+      int32_t parent_;
+      bool last_;
+    };
+
+    // rows shown from level_ (the number of queries) until the next snapshot
+    struct shown_snapshot_t {
+      int level_;
+      std::vector<shown_row_t> shown_;
+    };
+
+    // a subtree to scan, or a single row (of a subtree split into a unit for
+    // each child) that is kept if it matches or a unit below it has rows
+    struct scan_unit_t {
+      flattened_handle_t row_;
+      bool single_;
+    };
+
+    void scan(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles);
+    // scan root_handles to rows, keeping rows shown for the first query,
+    // subtrees are split into units to scan them in parallel
+    void scan_roots(
+      const thh::handle_t* root_handles, int root_count,
+      const thh::handle_vector_t<hy::entity_t>& entities, rows_t& rows) const;
+    // scan units to rows (single rows are always added) and record where the
+    // rows of each unit end
+    void scan_units(
+      const scan_unit_t* units, int unit_count,
+      const thh::handle_vector_t<hy::entity_t>& entities, rows_t& rows,
+      int64_t* unit_ends) const;
+    // restore the rows shown for an earlier level (or rebuild them)
+    void show_level(int level);
+    // rebuild shown_ from every scanned row
+    void show_scanned(int level);
+    // check the current matches against query (the next level) and rebuild
+    // shown_ from the current shown rows if any are lost
+    void show_shown(int level, std::string_view query);
+    // build next_shown_ from the input rows that match or have a match below
+    template<typename RowFn, typename MatchedFn>
+    void show(int64_t input_count, RowFn row_at, MatchedFn matched_at);
+    // replace scanned rows [first, last) with rows and show them in shown_
+    // and each snapshot in shown_history_
+    void splice(int32_t first, int32_t last, const rows_t& rows);
+    // replace the rows shown from scanned rows [first, last) (now
+    // [first, next_last)) with those shown for level
+    void splice_shown(
+      std::vector<shown_row_t>& shown, int32_t first, int32_t last,
+      int32_t next_last, int level);
+    // scanned row of the selected entity (if any)
+    std::optional<int32_t> selected_row() const;
+    // scanned row of entity_handle, searching every scanned row (only used
+    // after a new scan)
+    std::optional<int32_t> scanned_row(thh::handle_t entity_handle) const;
+    // select the previously selected entity (on scanned row selected_row)
+    // again if it is still shown, found by a binary search of shown_
+    void restore_selection(std::optional<int32_t> selected_row);
+
+    // call fn for each chunk in [0, chunk_count)
+    template<typename Fn>
+    void for_each_chunk(int chunk_count, const Fn& fn) const;
+    int chunk_count(int64_t count) const;
+
+    // each query contains the one before it, the first is the query the
+    // rows were scanned with
+    std::vector<std::string> queries_;
+    entity_filter_fn filter_;
+    // rows shown for the first query in display order
+    rows_t scanned_;
+    // rows shown for the current (last) query, first built at shown_level_
+    std::vector<shown_row_t> shown_;
+    int shown_level_ = 0;
+    // rows shown for shorter queries (levels before shown_level_)
+    std::vector<shown_snapshot_t> shown_history_;
+    // scratch memory reused between queries
+    std::vector<shown_row_t> next_shown_;
+    std::vector<std::vector<shown_row_t>> chunk_shown_;
+
+    thread_pool_t* thread_pool_ = nullptr;
+    int offset_ = 0;
+    int count_ = 20;
+    int selected_ = 0;
+  };
+
+  // update filtered_view for edits published to events, returns the
+  // subscription
+  // note: entities and root_handles must outlive the subscription
+  int32_t subscribe(
+    hierarchy_events_t& events, filtered_view_t& filtered_view,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles);
+
+  // draw the visible rows of view with the usual connectors, a row is joined
+  // to the next of its siblings still shown, matching rows are drawn bold
+  template<typename Backend, typename = display_backend_t<Backend>>
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const filtered_view_t& view, Backend& backend) {
+    const int offset = std::min(view.offset(), view.row_count());
+    const int count = std::min(view.row_count() - offset, view.count());
+    for (int row = 0; row < count; row++) {
+      const int index = offset + row;
+      const flattened_handle_t& flattened_handle = view.row(index);
+      // draw a connection for each ancestor with siblings still to come
+      int indent = flattened_handle.indent_ - 1;
+      for (int ancestor = view.parent_row(index); ancestor != -1;
+           ancestor = view.parent_row(ancestor), indent--) {
+        if (!view.last_sibling(ancestor)) {
+          backend.draw_glyph(
+            indent * backend.indent_width(), row, glyph_e::connection);
+        }
+      }
+      backend.draw_glyph(
+        flattened_handle.indent_ * backend.indent_width(), row,
+        view.last_sibling(index) ? glyph_e::end : glyph_e::mid);
+      if (index == view.selected_index()) {
+        backend.set_invert(true);
+      }
+      if (view.matched(index)) {
+        backend.set_bold(true);
+      }
+      entities.call(flattened_handle.entity_handle_, [&](const auto& entity) {
+        backend.draw(entity.name_);
+      });
+      backend.set_invert(false);
+      backend.set_bold(false);
+    }
+  }
+
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const filtered_view_t& view, const display_ops_t& display_ops);
+} // namespace hy
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <thh-handle-vector/handle-vector.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace hy {
+  struct flattened_handle_t {
+    thh::handle_t entity_handle_;
+    int32_t indent_;
+  };
+
+  // ordered sequence of flattened handles stored as a rope of fixed capacity
+  // chunks (an implicit treap ordered by row), inserting or erasing a run of k
+  // rows costs O(k + log n) and random access costs O(log n), the row of an
+  // entity handle is found in O(log n) by recording the chunk holding it
+  // note: iterators and references are invalidated by insert/erase/clear
+  struct flattened_handles_t {
+    static constexpr int32_t chunk_capacity = 128;
+
+    // random access iterator, sequential access is amortized O(1)
+    struct const_iterator {
+      using iterator_category = std::random_access_iterator_tag;
+      using value_type = flattened_handle_t;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const flattened_handle_t*;
+      using reference = const flattened_handle_t&;
+
+      const_iterator() = default;
+      const_iterator(const flattened_handles_t* handles, int32_t index)
+        : handles_(handles), index_(index) {}
+
+      reference operator*() const {
+        return handles_->locate(index_, node_, node_begin_);
+      }
+      pointer operator->() const { return &**this; }
+      reference operator[](const difference_type n) const {
+        return *(*this + n);
+      }
+
+      const_iterator& operator++() {
+        index_++;
+        return *this;
+      }
+      const_iterator operator++(int) {
+        auto it = *this;
+        index_++;
+        return it;
+      }
+      const_iterator& operator--() {
+        index_--;
+        return *this;
+      }
+      const_iterator operator--(int) {
+        auto it = *this;
+        index_--;
+        return it;
+      }
+      const_iterator& operator+=(const difference_type n) {
+        index_ += (int32_t)n;
+        return *this;
+      }
+      const_iterator& operator-=(const difference_type n) {
+        index_ -= (int32_t)n;
+        return *this;
+      }
+      friend const_iterator operator+(
+        const_iterator it, const difference_type n) {
+        return it += n;
+      }
+      friend const_iterator operator+(
+        const difference_type n, const_iterator it) {
+        return it += n;
+      }
+      friend const_iterator operator-(
+        const_iterator it, const difference_type n) {
+        return it -= n;
+      }
+      friend difference_type operator-(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ - rhs.index_;
+      }
+      friend bool operator==(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ == rhs.index_;
+      }
+      friend bool operator!=(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ != rhs.index_;
+      }
+      friend bool operator<(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ < rhs.index_;
+      }
+      friend bool operator>(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ > rhs.index_;
+      }
+      friend bool operator<=(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ <= rhs.index_;
+      }
+      friend bool operator>=(
+        const const_iterator& lhs, const const_iterator& rhs) {
+        return lhs.index_ >= rhs.index_;
+      }
+
+      int32_t index() const { return index_; }
+
+    private:
+      const flattened_handles_t* handles_ = nullptr;
+      int32_t index_ = 0;
+      // chunk last accessed and the row it begins at
+      mutable int32_t node_ = -1;
+      mutable int32_t node_begin_ = 0;
+    };
+
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    flattened_handles_t() = default;
+    explicit flattened_handles_t(
+      const std::vector<flattened_handle_t>& flattened_handles);
+
+    int32_t size() const { return count(root_); }
+    bool empty() const { return root_ == -1; }
+
+    const flattened_handle_t& operator[](int32_t index) const;
+
+    // row of entity_handle (if present), if an entity handle appears more
+    // than once the most recently inserted row is returned
+    std::optional<int32_t> index_of(thh::handle_t entity_handle) const;
+
+    void insert(int32_t index, const flattened_handle_t& flattened_handle);
+    // inserts the rows [first, last) before index
+    void insert(
+      int32_t index, const flattened_handle_t* first,
+      const flattened_handle_t* last);
+    // erases the rows [first, last)
+    void erase(int32_t first, int32_t last);
+    void clear();
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    const_reverse_iterator rbegin() const {
+      return const_reverse_iterator(end());
+    }
+    const_reverse_iterator rend() const {
+      return const_reverse_iterator(begin());
+    }
+
+  private:
+    struct node_t {
+      int32_t left_ = -1;
+      int32_t right_ = -1;
+      int32_t parent_ = -1;
+      uint32_t priority_ = 0;
+      int32_t count_ = 0; // rows in this subtree
+      int32_t size_ = 0; // rows in this chunk
+      flattened_handle_t rows_[chunk_capacity];
+    };
+
+    int32_t count(const int32_t node) const {
+      return node == -1 ? 0 : nodes_[node].count_;
+    }
+    void update(int32_t node);
+    int32_t allocate_node();
+    void free_node(int32_t node);
+    void free_tree(int32_t node);
+    // record node as the chunk holding rows [first, size) of node
+    void index_rows(int32_t node, int32_t first);
+    std::pair<int32_t, int32_t> split(int32_t node, int32_t index);
+    int32_t merge(int32_t left, int32_t right);
+    // merge that also combines the chunks either side of the join if they fit
+    int32_t join(int32_t left, int32_t right);
+    int32_t build(
+      const flattened_handle_t* first, const flattened_handle_t* last);
+    int32_t find(int32_t index, int32_t& node_begin) const;
+    int32_t next_node(int32_t node) const;
+    int32_t prev_node(int32_t node) const;
+    const flattened_handle_t& locate(
+      int32_t index, int32_t& node, int32_t& node_begin) const;
+
+    std::vector<node_t> nodes_;
+    std::vector<int32_t> free_nodes_;
+    // chunk holding each entity handle, indexed by handle id (stale entries
+    // are detected as the chunk will no longer hold the handle)
+    std::vector<int32_t> handle_nodes_;
+    int32_t root_ = -1;
+    // scratch memory for build and free_tree (kept to avoid allocating)
+    std::vector<int32_t> spine_;
+    std::vector<int32_t> pre_order_;
+    std::vector<int32_t> node_stack_;
+    uint32_t seed_ = 2463534242;
+  };
+} // namespace hy
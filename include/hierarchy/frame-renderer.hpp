@@ -0,0 +1,113 @@
+#pragma once
+
+#include "hierarchy/draw-commands.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace hy {
+  // renders frames of draw commands to a terminal, keeping the previous frame
+  // so only rows whose content or attributes changed are redrawn and moving
+  // the view by one row scrolls the terminal instead of redrawing every row
+  //
+  // terminals are any type providing
+  //   void scroll(int first_row, int last_row, int rows); // positive is up
+  //   void clear_row(int row);
+  // and the display backend functions (see display_backend_t)
+  struct frame_renderer_t {
+    template<typename Terminal>
+    void render(
+      const draw_commands_t& draw_commands, int offset, int row_count,
+      Terminal& terminal);
+
+    // forget the previous frame so the next render redraws every row
+    void invalidate() { valid_ = false; }
+
+  private:
+    // commands [begin_, end_) draw a row, bold_ and invert_ are the
+    // attributes when the row begins
+    struct row_t {
+      int32_t begin_ = 0;
+      int32_t end_ = 0;
+      bool bold_ = false;
+      bool invert_ = false;
+    };
+
+    static void split_rows(
+      const draw_commands_t& draw_commands, std::vector<row_t>& rows);
+    static bool rows_equal(
+      const draw_commands_t& lhs_commands, const row_t& lhs,
+      const draw_commands_t& rhs_commands, const row_t& rhs);
+
+    draw_commands_t previous_;
+    std::vector<row_t> previous_rows_;
+    std::vector<row_t> rows_;
+    int previous_offset_ = 0;
+    int previous_row_count_ = 0;
+    bool valid_ = false;
+  };
+
+  template<typename Terminal>
+  void frame_renderer_t::render(
+    const draw_commands_t& draw_commands, const int offset,
+    const int row_count, Terminal& terminal) {
+    split_rows(draw_commands, rows_);
+
+    // previous row now displayed at row is row + scroll
+    int scroll = 0;
+    if (
+      valid_ && row_count == previous_row_count_
+      && (offset - previous_offset_ == 1 || offset - previous_offset_ == -1)) {
+      scroll = offset - previous_offset_;
+      terminal.scroll(0, row_count - 1, scroll);
+    }
+
+    for (int row = 0; row < row_count; row++) {
+      const int previous_row = row + scroll;
+      const bool previous_drawn = valid_ && previous_row >= 0
+                               && previous_row < (int)previous_rows_.size();
+      const bool drawn = row < (int)rows_.size();
+      if (drawn && previous_drawn) {
+        if (rows_equal(
+              draw_commands, rows_[row], previous_,
+              previous_rows_[previous_row])) {
+          continue;
+        }
+      }
+      if (!drawn && valid_ && !previous_drawn) {
+        // already blank (never drawn or scrolled into view)
+        continue;
+      }
+      terminal.clear_row(row);
+      if (drawn) {
+        terminal.set_bold(rows_[row].bold_);
+        terminal.set_invert(rows_[row].invert_);
+        for (int32_t c = rows_[row].begin_; c < rows_[row].end_; c++) {
+          const auto& command = draw_commands.commands()[c];
+          switch (command.type_) {
+            case draw_command_t::type_e::glyph:
+              terminal.draw_glyph(command.x_, row, command.glyph_);
+              break;
+            case draw_command_t::type_e::text:
+              terminal.draw(draw_commands.text(command));
+              break;
+            case draw_command_t::type_e::bold:
+              terminal.set_bold(command.enabled_);
+              break;
+            case draw_command_t::type_e::invert:
+              terminal.set_invert(command.enabled_);
+              break;
+          }
+        }
+      }
+    }
+    terminal.set_bold(false);
+    terminal.set_invert(false);
+
+    previous_ = draw_commands;
+    std::swap(previous_rows_, rows_);
+    previous_offset_ = offset;
+    previous_row_count_ = row_count;
+    valid_ = true;
+  }
+} // namespace hy
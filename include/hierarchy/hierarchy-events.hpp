@@ -0,0 +1,50 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace hy {
+  enum class hierarchy_event_e { added, removed, moved, renamed };
+
+  // an edit to the hierarchy, published once the entities have changed
+  struct hierarchy_event_t {
+    hierarchy_event_e type_;
+    thh::handle_t entity_handle_;
+    // parent the entity was added or moved to, or removed from (null for
+    // roots)
+    thh::handle_t parent_handle_;
+    // parent the entity was moved from (moved only)
+    thh::handle_t previous_parent_handle_;
+  };
+
+  using hierarchy_listener_fn = std::function<void(const hierarchy_event_t&)>;
+
+  // edits made through one view passed on to the other views of the same
+  // entities, listeners are called as each edit is published so the
+  // entities are exactly as the edit left them
+  // note: removed entities (and their descendants) are still valid while
+  // the removed event is published
+  struct hierarchy_events_t {
+    // returns the subscription to pass to unsubscribe (and publish)
+    int32_t subscribe(hierarchy_listener_fn listener);
+    void unsubscribe(int32_t subscription);
+    // call every listener except the one for source (the publisher's own)
+    void publish(const hierarchy_event_t& event, int32_t source = -1) const;
+
+  private:
+    std::vector<std::pair<int32_t, hierarchy_listener_fn>> listeners_;
+    int32_t next_subscription_ = 0;
+  };
+
+  // publish edits made through view and patch its rows for edits made
+  // elsewhere, returns the subscription
+  // note: entities, collapser and root_handles must outlive the subscription
+  int32_t subscribe(
+    hierarchy_events_t& events, view_t& view,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+} // namespace hy
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  enum class import_format_e {
+    indented, // one name per line, children indented more than their parent
+    paths // one path per line (e.g. a/b/c), as output by find
+  };
+
+  // builds a hierarchy from text fed in chunks (lines may span chunks),
+  // parents are resolved with a stack of the previous line's ancestors
+  // the lines of each chunk are created together with add_entities (each
+  // entity's children_ is sized once) when the chunk has been parsed
+  // note: paths only share entities with the previous line's ancestors so
+  // input should list paths depth first (e.g. sorted or find output)
+  struct importer_t {
+    importer_t(
+      import_format_e format, thh::handle_vector_t<hy::entity_t>& entities,
+      std::vector<thh::handle_t>& root_handles);
+
+    void feed(std::string_view chunk);
+    // import the last line if the input did not end with a newline
+    void finish();
+
+    int64_t line_count() const { return line_count_; }
+
+  private:
+    void import_line(std::string_view line);
+    void import_indented(std::string_view line);
+    void import_path(std::string_view line);
+    // queue an entity below the deepest ancestor, returns its batch index
+    int32_t add_entity(std::string_view name);
+    // create the queued entities and link them to their parents
+    void flush();
+
+    struct ancestor_t {
+      thh::handle_t handle_;
+      int32_t batch_index_ = -1; // until flushed
+      int indent_ = 0; // indented
+      std::string name_; // paths
+    };
+
+    import_format_e format_;
+    thh::handle_vector_t<hy::entity_t>* entities_;
+    std::vector<thh::handle_t>* root_handles_;
+    // ancestors_[0, depth_) are the ancestors of the next line, entries past
+    // depth_ are kept to reuse their name allocations
+    std::vector<ancestor_t> ancestors_;
+    size_t depth_ = 0;
+    std::string partial_line_;
+    int64_t line_count_ = 0;
+
+    // entities queued since the last flush, parents outside the batch are
+    // held in batch_parent_handles_ (null for roots)
+    std::vector<int32_t> batch_parent_indices_;
+    std::vector<std::string> batch_names_;
+    std::vector<thh::handle_t> batch_parent_handles_;
+    std::vector<thh::handle_t> batch_root_handles_;
+  };
+
+  // import a file in chunks, returns false if the file could not be read
+  // note: entities are reserved for the number of lines estimated from the
+  // file size and the length of the lines in the first chunk
+  bool import_file(
+    const std::string& path, import_format_e format,
+    thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles);
+} // namespace hy
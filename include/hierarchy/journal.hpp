@@ -0,0 +1,174 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  // undo and redo for edits made through a view, each edit is performed by
+  // the journal and recorded as a small entry, removed entities are packed
+  // (names, child counts and collapse state in pre-order) so undoing a
+  // removal recreates them without flattening the other entities
+  // entries past max_entries or max_bytes (of packed entities) are dropped
+  // oldest first, an edit packing more than max_bytes clears the journal
+  // note: undo and redo expect the entities to be as the edit left them, so
+  // call clear after editing (or expanding and collapsing) the entities any
+  // other way
+  struct journal_t {
+    explicit journal_t(
+      int32_t max_entries = 256, int64_t max_bytes = int64_t(64) << 20);
+
+    void expand(
+      view_t& view, const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser);
+    void collapse(
+      view_t& view, const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser);
+    std::optional<flattened_handle_position_t> add_child(
+      view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser);
+    flattened_handle_position_t add_sibling(
+      view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, std::vector<thh::handle_t>& root_handles);
+    // the removed entities are packed in a single pass and released later
+    // (see reclaim)
+    void remove(
+      view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, std::vector<thh::handle_t>& root_handles);
+    bool move_selected_to(
+      thh::handle_t parent_handle, view_t& view,
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles);
+
+    // reverse the last edit (or repeat the last edit undone), the entity
+    // edited is selected if it is visible, returns false if there is nothing
+    // to undo (or redo)
+    // note: entities restored by undo (or redo) get new handles, handles
+    // held by the journal are updated to match
+    bool undo(
+      view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, std::vector<thh::handle_t>& root_handles);
+    bool redo(
+      view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, std::vector<thh::handle_t>& root_handles);
+    bool can_undo() const { return !undo_.empty(); }
+    bool can_redo() const { return !redo_.empty(); }
+
+    // release up to budget removed entities, returns the number released
+    int reclaim(
+      int budget, thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser);
+    // forget every entry (removed entities are still released by reclaim)
+    void clear();
+
+    int32_t entry_count() const {
+      return int32_t(undo_.size() + redo_.size());
+    }
+    // memory held by packed entities
+    int64_t packed_bytes() const { return packed_bytes_; }
+
+  private:
+    // an entity and its descendants in pre-order
+    struct packed_entities_t {
+      std::vector<thh::handle_t> handles_;
+      std::vector<int32_t> child_counts_;
+      std::vector<bool> collapsed_;
+      // offset of each name in names_ (and the end of the last name)
+      std::vector<int64_t> name_offsets_ = {0};
+      std::string names_;
+
+      int32_t size() const { return (int32_t)handles_.size(); }
+      std::string_view name(const int32_t index) const {
+        const auto first = name_offsets_[index];
+        return std::string_view(names_).substr(
+          first, name_offsets_[index + 1] - first);
+      }
+      int64_t bytes() const;
+    };
+
+    enum class edit_e { expand, collapse, add, remove, move };
+
+    struct entry_t {
+      entry_t(
+        edit_e edit, thh::handle_t entity_handle,
+        thh::handle_t parent_handle = thh::handle_t(),
+        int32_t sibling_index = 0,
+        thh::handle_t previous_parent_handle = thh::handle_t(),
+        int32_t previous_sibling_index = 0)
+        : edit_(edit),
+          entity_handle_(entity_handle),
+          parent_handle_(parent_handle),
+          sibling_index_(sibling_index),
+          previous_parent_handle_(previous_parent_handle),
+          previous_sibling_index_(previous_sibling_index) {}
+
+      edit_e edit_;
+      thh::handle_t entity_handle_;
+      // parent after the edit (before it for remove)
+      thh::handle_t parent_handle_;
+      int32_t sibling_index_ = 0;
+      // position before a move
+      thh::handle_t previous_parent_handle_;
+      int32_t previous_sibling_index_ = 0;
+      // entities to restore for add (once undone) and remove
+      packed_entities_t packed_;
+    };
+
+    void record(entry_t entry);
+    // pack, unlink and queue entity_handle for reclaiming
+    void erase(
+      thh::handle_t entity_handle, packed_entities_t& packed, view_t& view,
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles);
+    // recreate packed at sibling_index below parent_handle, returns the new
+    // handle of the first entity
+    thh::handle_t restore(
+      packed_entities_t& packed, thh::handle_t parent_handle,
+      int32_t sibling_index, view_t& view,
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles);
+    void move(
+      thh::handle_t entity_handle, thh::handle_t parent_handle,
+      int32_t sibling_index, view_t& view,
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles);
+    // apply entry (forward) or reverse it, returns the entity to select
+    thh::handle_t replay(
+      entry_t& entry, bool forward, view_t& view,
+      thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+      std::vector<thh::handle_t>& root_handles);
+    void pack(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser, packed_entities_t& packed);
+    // point handles held by entries at the entities recreated by restore
+    void remap_entries();
+
+    std::deque<entry_t> undo_;
+    std::vector<entry_t> redo_;
+    entity_reclaimer_t reclaimer_;
+    int32_t max_entries_;
+    int64_t max_bytes_;
+    int64_t packed_bytes_ = 0;
+
+    // scratch memory reused between edits
+    struct remapped_t {
+      thh::handle_t from_;
+      thh::handle_t to_;
+    };
+    // indexed by the id of the previous handle
+    std::vector<remapped_t> remapped_;
+    std::vector<thh::handle_t> handle_stack_;
+    struct restored_parent_t {
+      thh::handle_t handle_;
+      int32_t remaining_children_;
+      bool children_visible_;
+    };
+    std::vector<restored_parent_t> parent_stack_;
+  };
+} // namespace hy
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace hy {
+  // case insensitive (ascii) substring test used to match names
+  bool name_contains(std::string_view name, std::string_view query);
+
+  // case insensitive (ascii) substring search over entity names, entities are
+  // listed under each trigram (three character sequence) of their name and
+  // candidates from the shortest list of the query's trigrams are checked
+  // against the name the entity was indexed with
+  // note: changes to entity_t::name_ made directly are not seen by the index
+  // until update is called (subscribe keeps it up to date with edits made
+  // through views), entities removed without calling remove are never
+  // returned but their entries are only reclaimed when a list is compacted
+  struct name_index_t {
+    // index an entity (an entity already indexed is updated)
+    void add(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities);
+    // index an entity and its descendants
+    void add_subtree(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities);
+    void remove(thh::handle_t entity_handle);
+    // remove an entity and its descendants (call before they are removed
+    // from entities)
+    void remove_subtree(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities);
+    // reindex an entity whose name has changed (rename entities through
+    // view_t::rename so every subscriber is updated)
+    void update(
+      thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities);
+    void clear();
+
+    // entities with names containing query (ordered by handle id), queries
+    // shorter than a trigram check every indexed entity
+    std::vector<thh::handle_t> find(
+      std::string_view query,
+      const thh::handle_vector_t<hy::entity_t>& entities) const;
+
+    // entries in all lists (including stale entries not yet compacted)
+    int64_t entry_count() const;
+
+  private:
+    struct entries_t {
+      std::vector<thh::handle_t> handles_;
+      // entries of entities that were removed or renamed since the list was
+      // last compacted (an estimate, renaming back revives entries)
+      int32_t stale_ = 0;
+    };
+
+    // the name an entity was indexed with (shares the entity's pooled name)
+    struct indexed_t {
+      thh::handle_t handle_;
+      pooled_name_t name_;
+    };
+
+    // indexed name of entity_handle (nullptr if it is not indexed)
+    const pooled_name_t* indexed_name(thh::handle_t entity_handle) const;
+    // count a stale entry and compact the list once half of it is stale
+    void mark_stale(entries_t& entries, std::optional<uint32_t> trigram);
+
+    std::unordered_map<uint32_t, entries_t> trigrams_;
+    // every indexed entity
+    entries_t all_;
+    // indexed by handle id
+    std::vector<indexed_t> indexed_;
+    // scratch memory for the trigrams of names being updated
+    std::vector<uint32_t> name_trigrams_;
+    std::vector<uint32_t> previous_trigrams_;
+    traversal_context_t traversal_context_;
+  };
+
+  // keep name_index up to date with edits published to events (added and
+  // removed subtrees and renamed entities), returns the subscription
+  // note: entities must outlive the subscription
+  int32_t subscribe(
+    hierarchy_events_t& events, name_index_t& name_index,
+    const thh::handle_vector_t<hy::entity_t>& entities);
+
+  // the match following/preceding entity_handle in display order (the order
+  // of the fully expanded hierarchy), wrapping around at either end, the
+  // first/last match is returned if entity_handle is null
+  // note: positions are compared by walking each match's ancestors so the
+  // cost is the number of matches times their depth
+  std::optional<thh::handle_t> next_match(
+    const std::vector<thh::handle_t>& matches, thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles);
+  std::optional<thh::handle_t> previous_match(
+    const std::vector<thh::handle_t>& matches, thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles);
+} // namespace hy
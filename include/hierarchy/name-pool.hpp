@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  // compact id of a name stored in a name_pool_t
+  using name_id_t = int32_t;
+  inline constexpr name_id_t null_name_id = -1;
+
+  // interned, reference counted names stored contiguously in one buffer
+  // views returned by name() are invalidated by any intern, rename or release
+  // (release can compact the buffer)
+  struct name_pool_t {
+    // returns the id of an existing matching name or stores a new one
+    name_id_t intern(std::string_view name);
+    // drops a reference, storage is reclaimed when no references remain
+    // (releasing a name with no references left is ignored)
+    void release(name_id_t id);
+    // interns the new name and releases the old one
+    name_id_t rename(name_id_t id, std::string_view name);
+    // adds a reference to an interned name (e.g. when copying its id)
+    void retain(name_id_t id);
+    std::string_view name(name_id_t id) const;
+
+    // number of unique names currently referenced
+    int32_t size() const { return size_; }
+    // bytes used by the name buffer (including released names not yet
+    // compacted)
+    int32_t buffer_size() const { return (int32_t)buffer_.size(); }
+    void reserve(int32_t name_count, int32_t buffer_size);
+
+  private:
+    struct entry_t {
+      int32_t offset_ = 0;
+      int32_t length_ = 0;
+      int32_t refs_ = 0;
+      uint32_t hash_ = 0;
+    };
+
+    // hash stored with the id so probing rarely touches entries_
+    struct lookup_slot_t {
+      name_id_t id_;
+      uint32_t hash_;
+    };
+
+    name_id_t find(std::string_view name, uint32_t hash) const;
+    void insert_lookup(name_id_t id);
+    void erase_lookup(name_id_t id);
+    void rehash_lookup(size_t capacity);
+    void compact();
+
+    std::string buffer_;
+    std::vector<entry_t> entries_;
+    std::vector<name_id_t> free_ids_;
+    // open addressing table of ids (linear probing)
+    std::vector<lookup_slot_t> lookup_;
+    int32_t lookup_used_ = 0; // live ids and tombstones
+    int32_t size_ = 0;
+    int32_t released_bytes_ = 0;
+  };
+
+  // pool shared by the names of every entity_t (see pooled_name_t)
+  // note: names may be read from several threads while none are being
+  // created, assigned or destroyed, changes must come from one thread
+  name_pool_t& entity_names();
+
+  // name interned in entity_names(), copies share the pooled storage and
+  // the name is released when the last copy is destroyed
+  struct pooled_name_t {
+    pooled_name_t() = default;
+    explicit pooled_name_t(std::string_view name);
+    pooled_name_t(const pooled_name_t& name);
+    pooled_name_t(pooled_name_t&& name) noexcept;
+    pooled_name_t& operator=(const pooled_name_t& name);
+    pooled_name_t& operator=(pooled_name_t&& name) noexcept;
+    pooled_name_t& operator=(std::string_view name);
+    ~pooled_name_t();
+
+    // invalidated by any change to a name (see name_pool_t::name)
+    std::string_view view() const { return entity_names().name(id_); }
+    operator std::string_view() const { return view(); }
+    name_id_t id() const { return id_; }
+    bool empty() const { return view().empty(); }
+    size_t size() const { return view().size(); }
+
+    friend bool operator==(const pooled_name_t& lhs, std::string_view rhs) {
+      return lhs.view() == rhs;
+    }
+    friend bool operator!=(const pooled_name_t& lhs, std::string_view rhs) {
+      return lhs.view() != rhs;
+    }
+
+  private:
+    name_id_t id_ = null_name_id;
+  };
+} // namespace hy
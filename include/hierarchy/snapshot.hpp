@@ -0,0 +1,58 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  // binary snapshot of a hierarchy (entity names, parent and child links,
+  // root handles and collapse state)
+  // note: entities are stored breadth first so the children of each entity
+  // are contiguous, roots are the first root_count entities, snapshot
+  // indices are not handles (handles are assigned when loading)
+  bool save_snapshot(
+    const std::string& path, const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles,
+    const collapser_t& collapser);
+
+  // read only snapshot mapped into memory, names are served from the mapping
+  struct snapshot_t {
+    snapshot_t() = default;
+    snapshot_t(const snapshot_t&) = delete;
+    snapshot_t& operator=(const snapshot_t&) = delete;
+    snapshot_t(snapshot_t&& snapshot) noexcept;
+    snapshot_t& operator=(snapshot_t&& snapshot) noexcept;
+    ~snapshot_t();
+
+    // returns false if the file could not be mapped or is not a snapshot
+    // (including one with any index or name offset out of range)
+    bool open(const std::string& path);
+    void close();
+
+    int32_t entity_count() const;
+    int32_t root_count() const;
+    std::string_view name(int32_t index) const;
+    int32_t parent(int32_t index) const; // -1 for roots
+    int32_t first_child(int32_t index) const;
+    int32_t child_count(int32_t index) const;
+    bool collapsed(int32_t index) const;
+
+  private:
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+  };
+
+  // add the entities of snapshot to entities and collapse those that were
+  // collapsed, returns the root handles
+  std::vector<thh::handle_t> load_snapshot(
+    const snapshot_t& snapshot, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser);
+} // namespace hy
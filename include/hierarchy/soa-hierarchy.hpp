@@ -0,0 +1,100 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+#include "hierarchy/name-pool.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace hy {
+  // struct-of-arrays alternative to thh::handle_vector_t<entity_t>
+  // hierarchy links are stored in dense arrays indexed by slot (handle id) so
+  // traversals walk flat arrays instead of chasing per entity allocations
+  struct soa_hierarchy_t {
+    static constexpr int32_t null_slot = -1;
+
+    thh::handle_t add();
+    // removes the entity and all of its descendants
+    bool remove(thh::handle_t handle);
+    void reserve(int32_t capacity);
+
+    bool has_handle(thh::handle_t handle) const;
+    int32_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // handle for an occupied slot (generation is looked up)
+    thh::handle_t handle(const int32_t slot) const {
+      return thh::handle_t(slot, generation_[slot]);
+    }
+
+    int32_t parent(const int32_t slot) const { return parent_[slot]; }
+    int32_t first_child(const int32_t slot) const { return first_child_[slot]; }
+    int32_t last_child(const int32_t slot) const { return last_child_[slot]; }
+    int32_t next_sibling(const int32_t slot) const {
+      return next_sibling_[slot];
+    }
+    int32_t prev_sibling(const int32_t slot) const {
+      return prev_sibling_[slot];
+    }
+    int32_t child_count(const int32_t slot) const { return child_count_[slot]; }
+
+    // names are interned in a shared pool, see name_pool_t
+    void set_name(thh::handle_t handle, std::string_view name);
+    std::string_view name(thh::handle_t handle) const;
+    const name_pool_t& names() const { return names_; }
+
+    // appends child as the last child of parent, returns false (and leaves
+    // the hierarchy unchanged) if child already has a parent or is parent or
+    // one of its ancestors (which would create a cycle)
+    bool link(int32_t parent_slot, int32_t child_slot);
+    // detaches slot from its parent (no-op for roots)
+    void unlink(int32_t slot);
+
+  private:
+    std::vector<int32_t> generation_;
+    std::vector<int32_t> parent_;
+    std::vector<int32_t> first_child_;
+    std::vector<int32_t> last_child_;
+    std::vector<int32_t> next_sibling_;
+    std::vector<int32_t> prev_sibling_;
+    std::vector<int32_t> child_count_;
+    std::vector<name_id_t> name_;
+    std::vector<bool> occupied_;
+    name_pool_t names_;
+    std::vector<int32_t> free_slots_;
+    int32_t size_ = 0;
+  };
+
+  void add_children(
+    thh::handle_t entity_handle,
+    const std::vector<thh::handle_t>& child_handles,
+    soa_hierarchy_t& hierarchy);
+
+  std::vector<thh::handle_t> siblings(
+    thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy,
+    const std::vector<thh::handle_t>& root_handles);
+
+  bool has_children(thh::handle_t handle, const soa_hierarchy_t& hierarchy);
+
+  int expanded_count(
+    const thh::handle_t& entity_handle, const soa_hierarchy_t& hierarchy,
+    const collapser_t& collapser);
+
+  std::vector<flattened_handle_t> flatten_entity(
+    thh::handle_t entity_handle, int indent, const soa_hierarchy_t& hierarchy,
+    const collapser_t& collapser);
+
+  std::vector<flattened_handle_t> flatten_entities(
+    const soa_hierarchy_t& hierarchy, const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+
+  std::vector<thh::handle_t> entity_and_descendants(
+    thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy);
+} // namespace hy
+
+namespace demo {
+  std::vector<thh::handle_t> create_bench_entities(
+    hy::soa_hierarchy_t& hierarchy, const int root_count,
+    const int handle_count);
+} // namespace demo
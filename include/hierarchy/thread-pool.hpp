@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hy {
+  // fixed set of worker threads that run a task for each index of a range,
+  // the calling thread also runs tasks so a pool of one thread has no workers
+  struct thread_pool_t {
+    explicit thread_pool_t(
+      int thread_count = (int)std::thread::hardware_concurrency());
+    ~thread_pool_t();
+
+    thread_pool_t(const thread_pool_t&) = delete;
+    thread_pool_t& operator=(const thread_pool_t&) = delete;
+
+    // total number of threads tasks run on (including the calling thread)
+    int thread_count() const { return (int)workers_.size() + 1; }
+
+    // call fn for each index in [0, count) and wait for all calls to finish
+    // note: must not be called from within fn
+    void for_each(int count, const std::function<void(int)>& fn);
+
+  private:
+    void work();
+    void run_tasks();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable start_;
+    std::condition_variable done_;
+    const std::function<void(int)>* fn_ = nullptr;
+    int count_ = 0;
+    std::atomic<int> next_ = 0;
+    int working_ = 0; // workers yet to finish the current range
+    int64_t generation_ = 0; // incremented for each range
+    bool stop_ = false;
+  };
+} // namespace hy
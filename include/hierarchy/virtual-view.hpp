@@ -0,0 +1,112 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <optional>
+#include <vector>
+
+namespace hy {
+  // row following/preceding flattened_handle in the flattened hierarchy, found
+  // by walking the hierarchy directly (no flattened list is required)
+  std::optional<flattened_handle_t> next_flattened_handle(
+    const flattened_handle_t& flattened_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+  std::optional<flattened_handle_t> prev_flattened_handle(
+    const flattened_handle_t& flattened_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+
+  // row at index in the flattened hierarchy, found by descending through the
+  // expanded counts of each subtree (computed and cached on first use)
+  std::optional<flattened_handle_t> flattened_handle_at(
+    int index, const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+
+  // total number of rows in the flattened hierarchy
+  int flattened_handle_count(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles);
+
+  // view into the collection of entities that only holds the visible rows,
+  // moving the selection steps to neighboring rows through the hierarchy so
+  // creating a view starting at the first row does not depend on the number
+  // of entities
+  // note: jumping to an offset, expanding and collapsing compute expanded
+  // counts for the subtrees involved the first time they are used
+  struct virtual_view_t {
+    virtual_view_t(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles, int offset, int count);
+
+    void move_up(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles);
+    void move_down(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles);
+    void collapse(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, const std::vector<thh::handle_t>& root_handles);
+    void expand(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, const std::vector<thh::handle_t>& root_handles);
+    // move the view (and selection) to start at offset, clamped so the view
+    // stays full where possible
+    void go_to_offset(
+      int offset, const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles);
+
+    // rows [offset, offset + count) of the flattened hierarchy (fewer at the
+    // end of the hierarchy)
+    const std::vector<flattened_handle_t>& flattened_handles() const {
+      return flattened_handles_;
+    }
+
+    int offset() const { return offset_; }
+    int count() const { return count_; }
+
+    thh::handle_t selected_handle() const;
+    std::optional<int> selected_index() const;
+    std::optional<int> selected_indent() const;
+
+  private:
+    // materialize rows after the last row until the view is full
+    void fill(
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const collapser_t& collapser,
+      const std::vector<thh::handle_t>& root_handles);
+
+    std::vector<flattened_handle_t> flattened_handles_;
+    int offset_ = 0;
+    int count_ = 20;
+    int selected_ = 0;
+  };
+
+  template<typename Backend, typename = display_backend_t<Backend>>
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const virtual_view_t& view,
+    const collapser_t& collapser, Backend& backend) {
+    const auto& flattened_handles = view.flattened_handles();
+    display_flattened_handles(
+      flattened_handles.begin(), flattened_handles.end(),
+      view.selected_index().has_value()
+        ? std::optional<int>(*view.selected_index() - view.offset())
+        : std::nullopt,
+      entities, root_handles, collapser, backend);
+  }
+
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const virtual_view_t& view,
+    const collapser_t& collapser, const display_ops_t& display_ops);
+} // namespace hy
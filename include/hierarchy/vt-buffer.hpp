@@ -0,0 +1,49 @@
+#pragma once
+
+#include "hierarchy/entity.hpp"
+
+#include <string>
+#include <string_view>
+
+namespace hy {
+  // writes frames as VT (ANSI) escape sequences to an in-memory byte buffer,
+  // the same sequences main-win.cpp writes to the console, so frames can be
+  // rendered and measured without a terminal
+  // note: usable as a display backend (see display_backend_t) and as a
+  // terminal for frame_renderer_t
+  struct vt_buffer_t {
+    // home the cursor and clear the screen
+    void begin_frame();
+    // discard written bytes (keeps allocated memory)
+    void clear();
+
+    void set_bold(bool bold);
+    void set_invert(bool invert);
+    void draw_glyph(int x, int y, glyph_e glyph);
+    void draw_at(int x, int y, std::string_view str);
+    void draw(std::string_view str);
+    int indent_width() const { return indent_width_; }
+
+    void scroll(int first_row, int last_row, int rows);
+    void clear_row(int row);
+
+    const std::string& bytes() const { return bytes_; }
+
+    std::string connection_ = "\xE2\x94\x82";
+    std::string end_ = "\xE2\x94\x94\xE2\x94\x80\xE2\x94\x80 ";
+    std::string mid_ = "\xE2\x94\x9C\xE2\x94\x80\xE2\x94\x80 ";
+    int indent_width_ = 4;
+
+  private:
+    void move_cursor(int x, int y);
+    void write_number(int number);
+
+    std::string bytes_;
+    // only changes to attributes are written
+    bool bold_ = false;
+    bool invert_ = false;
+  };
+
+  // display_ops_t writing to vt_buffer (which must outlive the callbacks)
+  display_ops_t vt_display_ops(vt_buffer_t& vt_buffer);
+} // namespace hy
@@ -1,10 +1,13 @@
+#include "hierarchy/draw-commands.hpp"
 #include "hierarchy/entity.hpp"
+#include "hierarchy/frame-renderer.hpp"
 
 #include <algorithm>
 #include <locale.h>
 #include <optional>
 #include <stack>
 #include <string.h>
+#include <string_view>
 #include <utility>
 
 #ifdef _WIN32
@@ -13,6 +16,39 @@
 #include <ncurses.h>
 #endif
 
+namespace {
+  // glyphs indexed by hy::glyph_e
+  const std::string_view glyphs[] = {
+    "\xE2\x94\x82", "\xE2\x94\x94\xE2\x94\x80\xE2\x94\x80 ",
+    "\xE2\x94\x9C\xE2\x94\x80\xE2\x94\x80 "};
+
+  // terminal for hy::frame_renderer_t drawing to stdscr
+  struct curses_terminal_t {
+    void scroll(const int first_row, const int last_row, const int rows) {
+      setscrreg(first_row, last_row);
+      scrl(rows);
+      setscrreg(0, LINES - 1);
+    }
+    void clear_row(const int row) {
+      move(row, 0);
+      clrtoeol();
+    }
+    void set_bold(const bool bold) {
+      bold ? attron(A_BOLD) : attroff(A_BOLD);
+    }
+    void set_invert(const bool invert) {
+      invert ? attron(A_REVERSE) : attroff(A_REVERSE);
+    }
+    void draw_glyph(const int x, const int y, const hy::glyph_e glyph) {
+      const auto str = glyphs[static_cast<int>(glyph)];
+      mvprintw(y, x, "%.*s", int(str.length()), str.data());
+    }
+    void draw(const std::string_view str) {
+      printw("%.*s", int(str.length()), str.data());
+    }
+  };
+} // namespace
+
 int main(int argc, char** argv) {
   thh::handle_vector_t<hy::entity_t> entities;
   auto root_handles = demo::create_sample_entities(entities);
@@ -26,6 +62,8 @@ int main(int argc, char** argv) {
   keypad(stdscr, true); // enable function keys
   noecho(); // don't echo while we do getch
   curs_set(0); // hide cursor
+  scrollok(stdscr, true); // allow scrolling the view region
+  idlok(stdscr, true); // scroll with the terminal instead of redrawing
 
   hy::collapser_t collapser;
   // temp - keep root handles expanded
@@ -33,46 +71,29 @@ int main(int argc, char** argv) {
   //   collapser.collapse(handle, entities);
   // }
 
-  hy::display_ops_t display_ops;
-  display_ops.connection_ = "\xE2\x94\x82";
-  display_ops.end_ = "\xE2\x94\x94\xE2\x94\x80\xE2\x94\x80 ";
-  display_ops.mid_ = "\xE2\x94\x9C\xE2\x94\x80\xE2\x94\x80 ";
-  display_ops.indent_width_ = 4;
-
-  display_ops.set_bold_fn_ = [](const bool bold) {
-    if (bold) {
-      attron(A_BOLD);
-    } else {
-      attroff(A_BOLD);
-    }
-  };
-  display_ops.set_invert_fn_ = [](const bool invert) {
-    if (invert) {
-      attron(A_REVERSE);
-    } else {
-      attroff(A_REVERSE);
-    }
-  };
-  display_ops.draw_fn_ = [](const std::string_view str) {
-    printw("%.*s", int(str.length()), str.data());
-  };
-  display_ops.draw_at_fn_ =
-    [](const int x, const int y, const std::string_view str) {
-      mvprintw(y, x, "%.*s", int(str.length()), str.data());
-    };
+  // reused each frame
+  hy::draw_commands_t draw_commands;
+  draw_commands.indent_width_ = 4;
+  // redraws only the rows that changed since the last frame
+  hy::frame_renderer_t frame_renderer;
+  curses_terminal_t terminal;
 
   hy::view_t view(
     hy::flatten_entities(entities, collapser, root_handles), 0, 10);
+  // removed entities are released a batch per frame
+  hy::entity_reclaimer_t reclaimer;
 
   for (bool running = true; running;) {
-    clear();
-
+    draw_commands.clear();
     hy::display_scrollable_hierarchy(
-      entities, root_handles, view, collapser, display_ops);
+      entities, root_handles, view, collapser, draw_commands);
+    frame_renderer.render(draw_commands, view.offset(), view.count(), terminal);
 
     refresh();
     move(0, 0);
 
+    // don't wait for input while there are removed entities to release
+    timeout(reclaimer.empty() ? -1 : 0);
     switch (const int key = getch(); key) {
       case KEY_UP:
         view.move_up();
@@ -99,12 +120,19 @@ int main(int argc, char** argv) {
         view.add_sibling(entities, collapser, root_handles);
         break;
       case 'd':
-        view.remove(entities, collapser, root_handles);
+        view.remove(entities, collapser, root_handles, reclaimer);
+        break;
+      case 'm':
+        // move the selected entity under the recorded entity (or to the
+        // roots if nothing is recorded)
+        view.move_selected_to(
+          view.recorded_handle(), entities, collapser, root_handles);
         break;
       default:
         // noop
         break;
     }
+    reclaimer.reclaim(1 << 14, entities, collapser);
   }
 
   endwin();
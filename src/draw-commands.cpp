@@ -0,0 +1,49 @@
+#include "hierarchy/draw-commands.hpp"
+
+namespace hy {
+  void draw_commands_t::clear() {
+    commands_.clear();
+    text_.clear();
+    bold_ = false;
+    invert_ = false;
+  }
+
+  void draw_commands_t::set_bold(const bool bold) {
+    if (bold != bold_) {
+      draw_command_t command;
+      command.type_ = draw_command_t::type_e::bold;
+      command.enabled_ = bold;
+      commands_.push_back(command);
+      bold_ = bold;
+    }
+  }
+
+  void draw_commands_t::set_invert(const bool invert) {
+    if (invert != invert_) {
+      draw_command_t command;
+      command.type_ = draw_command_t::type_e::invert;
+      command.enabled_ = invert;
+      commands_.push_back(command);
+      invert_ = invert;
+    }
+  }
+
+  void draw_commands_t::draw_glyph(
+    const int x, const int y, const glyph_e glyph) {
+    draw_command_t command;
+    command.type_ = draw_command_t::type_e::glyph;
+    command.glyph_ = glyph;
+    command.x_ = x;
+    command.y_ = y;
+    commands_.push_back(command);
+  }
+
+  void draw_commands_t::draw(const std::string_view str) {
+    draw_command_t command;
+    command.type_ = draw_command_t::type_e::text;
+    command.text_offset_ = (int32_t)text_.size();
+    command.text_size_ = (int32_t)str.size();
+    commands_.push_back(command);
+    text_.append(str);
+  }
+} // namespace hy
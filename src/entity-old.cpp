@@ -133,77 +133,22 @@ namespace hy {
     const std::vector<thh::handle_t>& root_handles, const display_fn& display,
     const scope_exit_fn& scope_exit,
     const display_connection_fn& display_connection) {
-    std::deque<thh::handle_t> entity_handle_stack;
-    for (auto it = root_handles.begin(); it != root_handles.end(); ++it) {
-      entity_handle_stack.push_front(*it);
-    }
-
-    std::deque<indent_tracker_t> indent_tracker;
-    indent_tracker.push_front(
-      indent_tracker_t{0, (int)entity_handle_stack.size()});
-
-    int level = 0; // the level (row) in the hierarchy
-    int last_indent = 0; // most recent indent (col)
-    while (!entity_handle_stack.empty()) {
-      const auto curr_indent = indent_tracker.front().indent_;
-
-      int last = last_indent;
-      while (curr_indent < last) {
-        scope_exit();
-        last--;
+    // forward to the std::function callbacks
+    struct backend_t {
+      void display(const display_info_t& display_info) const {
+        display_(display_info);
       }
-
-      const bool last_element = [&] {
-        auto& indent_ref = indent_tracker.front();
-        indent_ref.count_--;
-        if (indent_ref.count_ == 0) {
-          indent_tracker.pop_front();
-          return true;
-        }
-        return false;
-      }();
-
-      for (const auto ind : indent_tracker) {
-        if (ind.count_ != 0 && ind.indent_ != curr_indent) {
-          display_connection(level, ind.indent_);
-        }
+      void scope_exit() const { scope_exit_(); }
+      void display_connection(const int level, const int indent) const {
+        display_connection_(level, indent);
       }
 
-      const auto entity_handle = entity_handle_stack.back();
-      entity_handle_stack.pop_back();
-
-      entities.call(entity_handle, [&](const auto& entity) {
-        const auto& children = entity.children_;
-
-        display_info_t display_info;
-        display_info.level = level;
-        display_info.indent = curr_indent;
-        display_info.entity_handle = entity_handle;
-        display_info.selected = interaction.selected() == entity_handle;
-        display_info.collapsed =
-          interaction.collapsed(entity_handle) && !children.empty();
-        display_info.has_children = !children.empty();
-        display_info.name = entity.name_;
-        display_info.last = last_element;
-
-        display(display_info);
-
-        if (!children.empty() && !interaction.collapsed(entity_handle)) {
-          indent_tracker.push_front(
-            indent_tracker_t{curr_indent + 1, (int)children.size()});
-          for (auto it = children.rbegin(); it != children.rend(); ++it) {
-            entity_handle_stack.push_back(*it);
-          }
-        }
-      });
-      level++;
-      last_indent = curr_indent;
-    }
-
-    while (last_indent > 0) {
-      scope_exit();
-      last_indent--;
-    }
+      const display_fn& display_;
+      const scope_exit_fn& scope_exit_;
+      const display_connection_fn& display_connection_;
+    };
+    backend_t backend{display, scope_exit, display_connection};
+    display_hierarchy(entities, interaction, root_handles, backend);
   }
 } // namespace hy
 
@@ -1,9 +1,27 @@
 #include "hierarchy/entity.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+#include "hierarchy/thread-pool.hpp"
 
-#include <deque>
+#include <algorithm>
+#include <charconv>
+#include <limits>
 #include <numeric>
+#include <type_traits>
+#include <utility>
 
 namespace hy {
+  namespace {
+    // name a new entity "entity_<id>", formatted in place instead of
+    // building a temporary string (the name is interned)
+    void set_default_name(entity_t& entity, const int32_t id) {
+      char name[32] = "entity_";
+      const int prefix_length = 7;
+      const auto result =
+        std::to_chars(name + prefix_length, name + sizeof(name), id);
+      entity.name_ = std::string_view(name, result.ptr - name);
+    }
+  } // namespace
+
   bool has_children(
     const thh::handle_t handle,
     const thh::handle_vector_t<hy::entity_t>& entities) {
@@ -30,26 +48,244 @@ namespace hy {
       .value_or(std::vector<thh::handle_t>{});
   }
 
+  namespace {
+    const std::vector<thh::handle_t> no_handles;
+  } // namespace
+
+  const std::vector<thh::handle_t>& sibling_handles(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    const auto* handles =
+      entities
+        .call_return(
+          entity_handle,
+          [&](const entity_t& entity) {
+            return entities
+              .call_return(
+                entity.parent_,
+                [](const entity_t& parent) { return &parent.children_; })
+              .value_or(&root_handles);
+          })
+        .value_or(&no_handles);
+    return *handles;
+  }
+
+  const std::vector<thh::handle_t>& child_handles(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<entity_t>& entities) {
+    return *entities
+              .call_return(
+                entity_handle,
+                [](const entity_t& entity) { return &entity.children_; })
+              .value_or(&no_handles);
+  }
+
   void add_children(
     const thh::handle_t entity_handle,
     const std::vector<thh::handle_t>& child_handles,
-    thh::handle_vector_t<entity_t>& entities) {
-    entities.call(entity_handle, [&child_handles](auto& entity) {
+    thh::handle_vector_t<entity_t>& entities, collapser_t* collapser) {
+    int32_t sibling_index = 0;
+    entities.call(entity_handle, [&](auto& entity) {
+      sibling_index = (int32_t)entity.children_.size();
       entity.children_.insert(
         entity.children_.end(), child_handles.begin(), child_handles.end());
     });
     std::for_each(
       child_handles.begin(), child_handles.end(),
-      [&entities, entity_handle](const auto child_handle) {
-        entities.call(child_handle, [entity_handle](auto& entity) {
+      [&entities, entity_handle, &sibling_index](const auto child_handle) {
+        entities.call(child_handle, [&](auto& entity) {
           entity.parent_ = entity_handle;
+          entity.sibling_index_ = sibling_index++;
         });
       });
+    if (collapser != nullptr) {
+      int count = 0;
+      for (const auto child_handle : child_handles) {
+        count += hy::expanded_count(child_handle, entities, *collapser);
+      }
+      collapser->update_expanded_count(entity_handle, count, entities);
+    }
+  }
+
+  std::optional<int32_t> sibling_index(
+    const thh::handle_t entity_handle,
+    const std::vector<thh::handle_t>& siblings,
+    const thh::handle_vector_t<entity_t>& entities) {
+    if (const auto index =
+          entities
+            .call_return(
+              entity_handle,
+              [](const entity_t& entity) { return entity.sibling_index_; })
+            .value_or(-1);
+        index >= 0 && index < (int32_t)siblings.size()
+        && siblings[index] == entity_handle) {
+      return index;
+    }
+    if (auto sibling =
+          std::find(siblings.begin(), siblings.end(), entity_handle);
+        sibling != siblings.end()) {
+      return (int32_t)(sibling - siblings.begin());
+    }
+    return {};
+  }
+
+  namespace {
+    // erase the sibling at index, the siblings after it move up one position
+    void erase_sibling(
+      std::vector<thh::handle_t>& siblings, const int32_t index,
+      thh::handle_vector_t<entity_t>& entities) {
+      siblings.erase(siblings.begin() + index);
+      for (int32_t i = index; i < (int32_t)siblings.size(); i++) {
+        entities.call(
+          siblings[i], [i](entity_t& entity) { entity.sibling_index_ = i; });
+      }
+    }
+
+    std::vector<thh::handle_t>* mutable_child_handles(
+      const thh::handle_t parent_handle,
+      thh::handle_vector_t<entity_t>& entities,
+      std::vector<thh::handle_t>& root_handles) {
+      return parent_handle == thh::handle_t()
+             ? &root_handles
+             : entities
+                 .call_return(
+                   parent_handle,
+                   [](entity_t& parent) { return &parent.children_; })
+                 .value_or(nullptr);
+    }
+  } // namespace
+
+  namespace {
+    template<typename NameFn>
+    std::vector<thh::handle_t> add_entities_impl(
+      const std::vector<int32_t>& parent_indices, NameFn&& name_fn,
+      thh::handle_vector_t<entity_t>& entities,
+      std::vector<thh::handle_t>& root_handles) {
+      const auto count = (int32_t)parent_indices.size();
+      // children of entity i are children[child_offsets[i], child_offsets[i+1])
+      std::vector<int32_t> child_offsets(count + 1, 0);
+      for (const auto parent_index : parent_indices) {
+        if (parent_index != -1) {
+          child_offsets[parent_index + 1]++;
+        }
+      }
+      std::partial_sum(
+        child_offsets.begin(), child_offsets.end(), child_offsets.begin());
+      std::vector<int32_t> children(child_offsets.back());
+      std::vector<int32_t> child_counts(count, 0);
+      std::vector<int32_t> sibling_indices(count, 0);
+      std::vector<thh::handle_t> handles;
+      handles.reserve(count);
+      for (int32_t index = 0; index < count; index++) {
+        if (const auto parent_index = parent_indices[index];
+            parent_index != -1) {
+          sibling_indices[index] = child_counts[parent_index]++;
+          children[child_offsets[parent_index] + sibling_indices[index]] =
+            index;
+        }
+        handles.push_back(entities.add());
+      }
+
+      for (int32_t index = 0; index < count; index++) {
+        const auto parent_index = parent_indices[index];
+        entities.call(handles[index], [&](entity_t& entity) {
+          entity.name_ = name_fn(index);
+          if (parent_index != -1) {
+            entity.parent_ = handles[parent_index];
+            entity.sibling_index_ = sibling_indices[index];
+          } else {
+            entity.sibling_index_ = (int32_t)root_handles.size();
+          }
+          entity.children_.reserve(
+            child_offsets[index + 1] - child_offsets[index]);
+          for (int32_t c = child_offsets[index]; c < child_offsets[index + 1];
+               c++) {
+            entity.children_.push_back(handles[children[c]]);
+          }
+        });
+        if (parent_index == -1) {
+          root_handles.push_back(handles[index]);
+        }
+      }
+      return handles;
+    }
+
+    // every parent index is -1 or in range and following parents from any
+    // entity reaches a root (there are no cycles)
+    bool valid_parent_indices(const std::vector<int32_t>& parent_indices) {
+      const auto count = (int32_t)parent_indices.size();
+      for (const auto parent_index : parent_indices) {
+        if (parent_index < -1 || parent_index >= count) {
+          return false;
+        }
+      }
+      // entities reaching a root are marked so each is walked past once
+      enum class visit_e : uint8_t { unvisited, visiting, reaches_root };
+      std::vector<visit_e> visits(count, visit_e::unvisited);
+      for (int32_t index = 0; index < count; index++) {
+        int32_t current = index;
+        while (current != -1 && visits[current] == visit_e::unvisited) {
+          visits[current] = visit_e::visiting;
+          current = parent_indices[current];
+        }
+        if (current != -1 && visits[current] == visit_e::visiting) {
+          return false;
+        }
+        for (current = index;
+             current != -1 && visits[current] == visit_e::visiting;
+             current = parent_indices[current]) {
+          visits[current] = visit_e::reaches_root;
+        }
+      }
+      return true;
+    }
+  } // namespace
+
+  std::vector<thh::handle_t> add_entities(
+    const std::vector<int32_t>& parent_indices,
+    const std::vector<std::string>& names,
+    thh::handle_vector_t<entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles) {
+    if (
+      names.size() != parent_indices.size()
+      || !valid_parent_indices(parent_indices)) {
+      return {};
+    }
+    return add_entities_impl(
+      parent_indices,
+      [&names](const int32_t index) -> const std::string& {
+        return names[index];
+      },
+      entities, root_handles);
+  }
+
+  std::vector<thh::handle_t> add_entities(
+    const std::vector<std::pair<int, std::string>>& depth_names,
+    thh::handle_vector_t<entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles) {
+    // index of the most recent entity at each depth
+    std::vector<int32_t> ancestors;
+    std::vector<int32_t> parent_indices;
+    parent_indices.reserve(depth_names.size());
+    for (const auto& [depth, name] : depth_names) {
+      // a depth can be at most one deeper than the previous entity
+      const auto clamped_depth = std::clamp(depth, 0, (int)ancestors.size());
+      ancestors.resize(clamped_depth);
+      parent_indices.push_back(ancestors.empty() ? -1 : ancestors.back());
+      ancestors.push_back((int32_t)parent_indices.size() - 1);
+    }
+    return add_entities_impl(
+      parent_indices,
+      [&depth_names](const int32_t index) -> const std::string& {
+        return depth_names[index].second;
+      },
+      entities, root_handles);
   }
 
   bool collapser_t::collapsed(const thh::handle_t handle) const {
-    return std::find(collapsed_.begin(), collapsed_.end(), handle)
-        != collapsed_.end();
+    return handle.id_ >= 0 && handle.id_ < (int32_t)collapsed_.size()
+        && collapsed_[handle.id_] == handle.gen_;
   }
 
   bool collapser_t::expanded(const thh::handle_t handle) const {
@@ -58,9 +294,25 @@ namespace hy {
 
   void collapser_t::expand(const thh::handle_t entity_handle) {
     if (collapsed(entity_handle)) {
-      collapsed_.erase(
-        std::remove(collapsed_.begin(), collapsed_.end(), entity_handle),
-        collapsed_.end());
+      collapsed_[entity_handle.id_] = -1;
+      clear_expanded_counts();
+    }
+  }
+
+  void collapser_t::expand(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    if (collapsed(entity_handle)) {
+      collapsed_[entity_handle.id_] = -1;
+      // descendant counts are kept up to date while collapsed
+      int count = 1;
+      entities.call(entity_handle, [&](const entity_t& entity) {
+        for (const auto child_handle : entity.children_) {
+          count += expanded_count(child_handle, entities, *this);
+        }
+        update_expanded_count(entity.parent_, count - 1, entities);
+      });
+      cache_expanded_count(entity_handle, count);
     }
   }
 
@@ -68,68 +320,203 @@ namespace hy {
     const thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities) {
     if (!collapsed(entity_handle) && has_children(entity_handle, entities)) {
-      collapsed_.push_back(entity_handle);
+      const int count = expanded_count(entity_handle, entities, *this);
+      set_collapsed(entity_handle);
+      entities.call(entity_handle, [&](const entity_t& entity) {
+        update_expanded_count(entity.parent_, 1 - count, entities);
+      });
     }
   }
 
+  std::optional<int> collapser_t::cached_expanded_count(
+    const thh::handle_t handle) const {
+    if (handle.id_ >= 0 && handle.id_ < (int32_t)expanded_counts_.size()) {
+      if (const auto& expanded_count = expanded_counts_[handle.id_];
+          expanded_count.gen_ == handle.gen_
+          && expanded_count.epoch_ == expanded_count_epoch_) {
+        return expanded_count.count_;
+      }
+    }
+    return {};
+  }
+
+  void collapser_t::cache_expanded_count(
+    const thh::handle_t handle, const int count) const {
+    if (handle.id_ < 0) {
+      return;
+    }
+    if (handle.id_ >= (int32_t)expanded_counts_.size()) {
+      expanded_counts_.resize(handle.id_ + 1);
+    }
+    expanded_counts_[handle.id_] =
+      expanded_count_t{handle.gen_, expanded_count_epoch_, count};
+  }
+
+  void collapser_t::update_expanded_count(
+    const thh::handle_t parent_handle, const int delta,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    if (delta == 0) {
+      return;
+    }
+    // counts of collapsed entities are always one, so changes below them
+    // don't affect their ancestors
+    for (auto handle = parent_handle;
+         handle != thh::handle_t() && !collapsed(handle);) {
+      if (const auto count = cached_expanded_count(handle); count.has_value()) {
+        cache_expanded_count(handle, *count + delta);
+      }
+      handle =
+        entities
+          .call_return(
+            handle, [](const entity_t& entity) { return entity.parent_; })
+          .value_or(thh::handle_t());
+    }
+  }
+
+  void collapser_t::set_collapsed(const thh::handle_t entity_handle) {
+    if (entity_handle.id_ >= (int32_t)collapsed_.size()) {
+      collapsed_.resize(entity_handle.id_ + 1, -1);
+    }
+    collapsed_[entity_handle.id_] = entity_handle.gen_;
+  }
+
+  void collapser_t::remove(const thh::handle_t entity_handle) {
+    // unlike expand the cached counts stay valid as the caller has already
+    // updated the ancestors
+    if (collapsed(entity_handle)) {
+      collapsed_[entity_handle.id_] = -1;
+    }
+  }
+
+  void entity_reclaimer_t::push(const thh::handle_t entity_handle) {
+    handles_.push_back(entity_handle);
+  }
+
+  int entity_reclaimer_t::reclaim(
+    const int budget, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    // one pass over the subtree, each entity queues its children as it is
+    // removed
+    int removed = 0;
+    while (removed < budget && !handles_.empty()) {
+      const auto handle = handles_.back();
+      handles_.pop_back();
+      entities.call(handle, [this](const entity_t& entity) {
+        handles_.insert(
+          handles_.end(), entity.children_.rbegin(), entity.children_.rend());
+      });
+      collapser.remove(handle);
+      if (entities.remove(handle)) {
+        removed++;
+      }
+    }
+    return removed;
+  }
+
+  void entity_reclaimer_t::reclaim_all(
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser) {
+    reclaim(std::numeric_limits<int>::max(), entities, collapser);
+  }
+
   int expanded_count(
     const thh::handle_t& entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities,
     const collapser_t& collapser) {
-    std::vector<thh::handle_t> handles(1, entity_handle);
-    int count = 1;
-    while (!handles.empty()) {
-      auto handle = handles.back();
-      handles.pop_back();
-      if (!collapser.collapsed(handle)) {
-        entities.call(handle, [&](const auto& entity) {
-          count += entity.children_.size();
-          handles.insert(
-            handles.end(), entity.children_.begin(), entity.children_.end());
-        });
+    traversal_context_t traversal_context;
+    return expanded_count(
+      entity_handle, entities, collapser, traversal_context);
+  }
+
+  int expanded_count(
+    const thh::handle_t& entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser, traversal_context_t& traversal_context) {
+    if (collapser.collapsed(entity_handle)) {
+      return 1;
+    }
+    if (const auto count = collapser.cached_expanded_count(entity_handle);
+        count.has_value()) {
+      return *count;
+    }
+
+    // post-order traversal caching the count of every visible descendant
+    using frame_t = traversal_context_t::count_frame_t;
+    const auto children = [&entities](const thh::handle_t handle) {
+      return entities
+        .call_return(
+          handle, [](const entity_t& entity) { return &entity.children_; })
+        .value_or(nullptr);
+    };
+    auto& frames = traversal_context.count_frames_;
+    frames.clear();
+    frames.push_back(frame_t{entity_handle, children(entity_handle), 0, 1});
+    while (true) {
+      auto& frame = frames.back();
+      if (
+        frame.children_ != nullptr
+        && frame.next_child_ < frame.children_->size()) {
+        const auto child_handle = (*frame.children_)[frame.next_child_++];
+        if (collapser.collapsed(child_handle)) {
+          frame.count_++;
+        } else if (const auto count =
+                     collapser.cached_expanded_count(child_handle);
+                   count.has_value()) {
+          frame.count_ += *count;
+        } else {
+          frames.push_back(
+            frame_t{child_handle, children(child_handle), 0, 1});
+        }
+        continue;
+      }
+      const int count = frame.count_;
+      if (frame.children_ != nullptr) {
+        collapser.cache_expanded_count(frame.handle_, count);
+      }
+      frames.pop_back();
+      if (frames.empty()) {
+        return count;
       }
+      frames.back().count_ += count;
     }
-    return count;
   }
 
   std::vector<flattened_handle_t> flatten_entity(
     const thh::handle_t entity_handle, const int indent,
     const thh::handle_vector_t<hy::entity_t>& entities,
     const collapser_t& collapser) {
-    std::vector<flattened_handle_t> flattened;
-    std::deque<indent_tracker_t> indent_tracker(1, {indent, 1});
-    std::vector<thh::handle_t> handles(1, entity_handle);
-    while (!handles.empty()) {
-      const auto curr_indent = indent_tracker.front().indent_;
-
-      if (!indent_tracker.empty()) {
-        auto& indent_ref = indent_tracker.front();
-        indent_ref.count_--;
-        if (indent_ref.count_ == 0) {
-          indent_tracker.pop_front();
-        }
-      }
+    traversal_context_t traversal_context;
+    return flatten_entity(
+      entity_handle, indent, entities, collapser, traversal_context);
+  }
 
-      const auto handle = handles.back();
-      flattened.push_back(flattened_handle_t{handle, curr_indent});
-      handles.pop_back();
-      entities.call(handle, [&](const auto& entity) {
-        if (!entity.children_.empty() && !collapser.collapsed(handle)) {
-          indent_tracker.push_front(
-            indent_tracker_t{curr_indent + 1, (int)entity.children_.size()});
-          handles.insert(
-            handles.end(), entity.children_.rbegin(), entity.children_.rend());
-        }
-      });
-    }
+  const std::vector<flattened_handle_t>& flatten_entity(
+    const thh::handle_t entity_handle, const int indent,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser, traversal_context_t& traversal_context) {
+    auto& visible = traversal_context.visible_;
+    visible.reset(entity_handle, indent, entities, collapser);
+    auto& flattened = traversal_context.flattened_handles_;
+    flattened.clear();
+    visible.append_remaining(flattened);
     return flattened;
   }
 
   std::vector<thh::handle_t> entity_and_descendants(
     thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities) {
-    std::vector<thh::handle_t> all_handles;
-    std::vector<thh::handle_t> handles(1, entity_handle);
+    traversal_context_t traversal_context;
+    return entity_and_descendants(entity_handle, entities, traversal_context);
+  }
+
+  const std::vector<thh::handle_t>& entity_and_descendants(
+    thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    traversal_context_t& traversal_context) {
+    // handles only (no indents or collapse checks), cheaper than pre_order_t
+    auto& all_handles = traversal_context.handles_;
+    auto& handles = traversal_context.handle_stack_;
+    all_handles.clear();
+    handles.assign(1, entity_handle);
     while (!handles.empty()) {
       const auto handle = handles.back();
       all_handles.push_back(handle);
@@ -149,12 +536,36 @@ namespace hy {
     const collapser_t& collapser,
     const std::vector<thh::handle_t>& root_handles) {
     std::vector<flattened_handle_t> flattened;
-    for (const auto root_handle : root_handles) {
-      auto flattened_entity =
-        flatten_entity(root_handle, 0, entities, collapser);
-      flattened.insert(
-        flattened.end(), flattened_entity.begin(), flattened_entity.end());
+    pre_order_t(root_handles, entities, collapser).append_remaining(flattened);
+    return flattened;
+  }
+
+  std::vector<flattened_handle_t> flatten_entities(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles,
+    thread_pool_t& thread_pool) {
+    // flatten each root to its own buffer (only reads entities and collapser)
+    const int root_count = (int)root_handles.size();
+    std::vector<std::vector<flattened_handle_t>> flattened_roots(root_count);
+    thread_pool.for_each(root_count, [&](const int root) {
+      pre_order_t(root_handles[root], 0, entities, collapser)
+        .append_remaining(flattened_roots[root]);
+    });
+
+    // offset of each root in the result is the sum of the sizes before it
+    std::vector<size_t> offsets(root_count + 1, 0);
+    for (int root = 0; root < root_count; root++) {
+      offsets[root + 1] = offsets[root] + flattened_roots[root].size();
     }
+
+    std::vector<flattened_handle_t> flattened(offsets.back());
+    thread_pool.for_each(root_count, [&](const int root) {
+      std::copy(
+        flattened_roots[root].begin(), flattened_roots[root].end(),
+        flattened.begin() + offsets[root]);
+      flattened_roots[root] = {};
+    });
     return flattened;
   }
 
@@ -170,19 +581,123 @@ namespace hy {
     auto search_handle = entity_handle;
     auto top_handle = thh::handle_t();
     while (search_handle != thh::handle_t()) {
-      entities.call(
-        search_handle,
-        [&search_handle, &top_handle, &collapser](const hy::entity_t& entity) {
-          if (collapser.collapsed(entity.parent_)) {
-            collapser.expand(entity.parent_);
-            top_handle = entity.parent_;
-          }
-          search_handle = entity.parent_;
-        });
+      entities.call(search_handle, [&](const hy::entity_t& entity) {
+        if (collapser.collapsed(entity.parent_)) {
+          collapser.expand(entity.parent_, entities);
+          top_handle = entity.parent_;
+        }
+        search_handle = entity.parent_;
+      });
     }
     return top_handle;
   }
 
+  bool reparent(
+    const thh::handle_t entity_handle, const thh::handle_t parent_handle,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto parent_of = [&entities](const thh::handle_t handle) {
+      return entities
+        .call_return(
+          handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    };
+    const auto valid = [&entities](const thh::handle_t handle) {
+      return entities.call_return(handle, [](const entity_t&) { return true; })
+        .value_or(false);
+    };
+    if (
+      !valid(entity_handle)
+      || (parent_handle != thh::handle_t() && !valid(parent_handle))) {
+      return false;
+    }
+    // the new parent can't be the entity or one of its descendants
+    for (auto ancestor_handle = parent_handle;
+         ancestor_handle != thh::handle_t();
+         ancestor_handle = parent_of(ancestor_handle)) {
+      if (ancestor_handle == entity_handle) {
+        return false;
+      }
+    }
+
+    const int count = hy::expanded_count(entity_handle, entities, collapser);
+    const auto previous_parent_handle = parent_of(entity_handle);
+    collapser.update_expanded_count(previous_parent_handle, -count, entities);
+    auto& previous_siblings =
+      previous_parent_handle == thh::handle_t()
+        ? root_handles
+        : *entities
+             .call_return(
+               previous_parent_handle,
+               [](entity_t& parent) { return &parent.children_; })
+             .value();
+    if (const auto index =
+          hy::sibling_index(entity_handle, previous_siblings, entities);
+        index.has_value()) {
+      erase_sibling(previous_siblings, *index, entities);
+    }
+
+    auto& siblings =
+      parent_handle == thh::handle_t()
+        ? root_handles
+        : *entities
+             .call_return(
+               parent_handle,
+               [](entity_t& parent) { return &parent.children_; })
+             .value();
+    entities.call(entity_handle, [&](entity_t& entity) {
+      entity.parent_ = parent_handle;
+      entity.sibling_index_ = (int32_t)siblings.size();
+    });
+    siblings.push_back(entity_handle);
+    collapser.update_expanded_count(parent_handle, count, entities);
+    return true;
+  }
+
+  void unlink_entity(
+    const thh::handle_t entity_handle,
+    thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto parent_handle =
+      entities
+        .call_return(
+          entity_handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    if (auto* siblings =
+          mutable_child_handles(parent_handle, entities, root_handles);
+        siblings != nullptr) {
+      if (const auto index =
+            hy::sibling_index(entity_handle, *siblings, entities);
+          index.has_value()) {
+        erase_sibling(*siblings, *index, entities);
+      }
+    }
+    entities.call(entity_handle, [](entity_t& entity) {
+      entity.parent_ = thh::handle_t();
+    });
+  }
+
+  void link_entity(
+    const thh::handle_t entity_handle, const thh::handle_t parent_handle,
+    const int32_t sibling_index, thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles) {
+    auto* siblings =
+      mutable_child_handles(parent_handle, entities, root_handles);
+    if (siblings == nullptr) {
+      return;
+    }
+    const auto index =
+      std::clamp(sibling_index, int32_t(0), (int32_t)siblings->size());
+    siblings->insert(siblings->begin() + index, entity_handle);
+    entities.call(entity_handle, [parent_handle](entity_t& entity) {
+      entity.parent_ = parent_handle;
+    });
+    for (int32_t i = index; i < (int32_t)siblings->size(); i++) {
+      entities.call(
+        (*siblings)[i], [i](entity_t& entity) { entity.sibling_index_ = i; });
+    }
+  }
+
   std::pair<thh::handle_t, int> root_handle(
     const thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities) {
@@ -209,54 +724,85 @@ namespace hy {
     return {search_handle, depth};
   }
 
+  namespace {
+    std::optional<int> index_of(
+      const thh::handle_t entity_handle,
+      const std::vector<flattened_handle_t>& flattened_handles) {
+      if (auto handle_it = std::find_if(
+            flattened_handles.cbegin(), flattened_handles.cend(),
+            [entity_handle](const flattened_handle_t& flattened_handle) {
+              return flattened_handle.entity_handle_ == entity_handle;
+            });
+          handle_it != flattened_handles.cend()) {
+        return (int)(handle_it - flattened_handles.cbegin());
+      }
+      return {};
+    }
+
+    std::optional<int> index_of(
+      const thh::handle_t entity_handle,
+      const flattened_handles_t& flattened_handles) {
+      return flattened_handles.index_of(entity_handle);
+    }
+
+    template<typename FlattenedHandles>
+    std::optional<int> go_to_entity_impl(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser, FlattenedHandles& flattened_handles) {
+      // might not be found if collapsed
+      if (const auto index = index_of(entity_handle, flattened_handles);
+          index.has_value()) {
+        return index;
+      }
+      // more complex if it's hidden
+      // expand all parents that are collapsed, find top most, build from that
+      auto collapsed_parent =
+        collapsed_parent_handle(entity_handle, entities, collapser);
+      const auto collapsed_parent_offset =
+        index_of(collapsed_parent, flattened_handles);
+      if (!collapsed_parent_offset.has_value()) {
+        return {};
+      }
+      auto handles = hy::flatten_entity(
+        collapsed_parent, flattened_handles[*collapsed_parent_offset].indent_,
+        entities, collapser);
+
+      if constexpr (std::is_same_v<FlattenedHandles, flattened_handles_t>) {
+        flattened_handles.insert(
+          *collapsed_parent_offset + 1, handles.data() + 1,
+          handles.data() + handles.size());
+      } else {
+        flattened_handles.insert(
+          flattened_handles.begin() + *collapsed_parent_offset + 1,
+          handles.begin() + 1, handles.end());
+      }
+
+      return index_of(entity_handle, flattened_handles);
+    }
+  } // namespace
+
   std::optional<int> go_to_entity(
     const thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
     std::vector<flattened_handle_t>& flattened_handles) {
-    // might not be found if collapsed
-    if (auto handle_it = std::find_if(
-          flattened_handles.cbegin(), flattened_handles.cend(),
-          [entity_handle](const flattened_handle_t& flattened_handle) {
-            return flattened_handle.entity_handle_ == entity_handle;
-          });
-        handle_it != flattened_handles.cend()) {
-      return (int)(handle_it - flattened_handles.cbegin());
-    }
-    // more complex if it's hidden
-    // expand all parents that are collapsed, find top most, build from that
-    auto collapsed_parent =
-      collapsed_parent_handle(entity_handle, entities, collapser);
-    int collapsed_parent_offset =
-      std::find_if(
-        flattened_handles.cbegin(), flattened_handles.cend(),
-        [collapsed_parent](const flattened_handle_t& flattened_handle) {
-          return flattened_handle.entity_handle_ == collapsed_parent;
-        })
-      - flattened_handles.cbegin();
-    auto handles = hy::flatten_entity(
-      collapsed_parent, flattened_handles[collapsed_parent_offset].indent_,
-      entities, collapser);
-
-    flattened_handles.insert(
-      flattened_handles.begin() + collapsed_parent_offset + 1,
-      handles.begin() + 1, handles.end());
-
-    if (auto handle_it = std::find_if(
-          flattened_handles.cbegin(), flattened_handles.cend(),
-          [entity_handle](const flattened_handle_t& flattened_handle) {
-            return flattened_handle.entity_handle_ == entity_handle;
-          });
-        handle_it != flattened_handles.cend()) {
-      return (int)(handle_it - flattened_handles.cbegin());
-    }
+    return go_to_entity_impl(
+      entity_handle, entities, collapser, flattened_handles);
+  }
 
-    return {};
+  std::optional<int> go_to_entity(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    flattened_handles_t& flattened_handles) {
+    return go_to_entity_impl(
+      entity_handle, entities, collapser, flattened_handles);
   }
 
   view_t::view_t(
     std::vector<flattened_handle_t> flattened_handles, const int offset,
     const int count)
-    : flattened_handles_(std::move(flattened_handles)), offset_(offset),
+    : flattened_handles_(std::move(flattened_handles)),
+      offset_(offset),
       count_(count) {}
 
   thh::handle_t view_t::selected_handle() const {
@@ -305,12 +851,10 @@ namespace hy {
     const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser) {
     if (const auto entity_handle = selected_handle();
         entity_handle != thh::handle_t()) {
-      const int expanded_count =
-        hy::expanded_count(entity_handle, entities, collapser);
+      const int expanded_count = hy::expanded_count(
+        entity_handle, entities, collapser, traversal_context_);
       collapser.collapse(entity_handle, entities);
-      flattened_handles_.erase(
-        flattened_handles_.begin() + *selected_ + 1,
-        flattened_handles_.begin() + *selected_ + expanded_count);
+      flattened_handles_.erase(*selected_ + 1, *selected_ + expanded_count);
     }
   }
 
@@ -319,26 +863,35 @@ namespace hy {
     if (const auto entity_handle = selected_handle();
         entity_handle != thh::handle_t()) {
       if (collapser.collapsed(entity_handle)) {
-        collapser.expand(entity_handle);
-        auto handles = hy::flatten_entity(
-          entity_handle, *selected_indent(), entities, collapser);
+        collapser.expand(entity_handle, entities);
+        const auto& handles = hy::flatten_entity(
+          entity_handle, *selected_indent(), entities, collapser,
+          traversal_context_);
         flattened_handles_.insert(
-          flattened_handles_.begin() + *selected_ + 1, handles.begin() + 1,
-          handles.end());
+          *selected_ + 1, handles.data() + 1, handles.data() + handles.size());
       }
     }
   }
 
-  void view_t::goto_recorded_handle(
+  bool view_t::goto_entity(
+    const thh::handle_t entity_handle,
     const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser) {
-    if (recorded_handle_ != thh::handle_t()) {
-      if (auto selected = hy::go_to_entity(
-            recorded_handle_, entities, collapser, flattened_handles_);
-          selected.has_value()) {
-        selected_ = selected;
-        offset_ = *selected_;
-      }
+    if (entity_handle == thh::handle_t()) {
+      return false;
     }
+    if (auto selected = hy::go_to_entity(
+          entity_handle, entities, collapser, flattened_handles_);
+        selected.has_value()) {
+      selected_ = selected;
+      offset_ = *selected_;
+      return true;
+    }
+    return false;
+  }
+
+  void view_t::goto_recorded_handle(
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser) {
+    goto_entity(recorded_handle_, entities, collapser);
   }
 
   void view_t::record_handle() { recorded_handle_ = selected_handle(); }
@@ -354,20 +907,20 @@ namespace hy {
     if (!collapser.collapsed(selected)) {
       auto next_handle = entities.add();
       entities.call(next_handle, [next_handle](auto& entity) {
-        entity.name_ = std::string("entity_") + std::to_string(next_handle.id_);
+        set_default_name(entity, next_handle.id_);
       });
-      hy::add_children(selected, {next_handle}, entities);
+      hy::add_children(selected, {next_handle}, entities, &collapser);
       const auto child_count =
-        hy::expanded_count(selected, entities, collapser);
-      const auto inserted = flattened_handles_.insert(
-        flattened_handles_.begin()
-          + std::min(
-            *selected_index() + child_count - 1,
-            (int)flattened_handles_.size()),
-        {next_handle, *selected_indent() + 1});
+        hy::expanded_count(selected, entities, collapser, traversal_context_);
+      const int32_t inserted = std::min(
+        *selected_index() + child_count - 1, (int)flattened_handles_.size());
+      const auto flattened_handle =
+        flattened_handle_t{next_handle, *selected_indent() + 1};
+      flattened_handles_.insert(inserted, flattened_handle);
+      publish(hierarchy_event_t{
+        hierarchy_event_e::added, next_handle, selected, thh::handle_t()});
 
-      return flattened_handle_position_t{
-        *inserted, int32_t(inserted - flattened_handles_.begin())};
+      return flattened_handle_position_t{flattened_handle, inserted};
     }
     return {};
   }
@@ -377,7 +930,7 @@ namespace hy {
     std::vector<thh::handle_t>& root_handles) {
     const auto next_handle = entities.add();
     entities.call(next_handle, [next_handle](auto& entity) {
-      entity.name_ = std::string("entity_") + std::to_string(next_handle.id_);
+      set_default_name(entity, next_handle.id_);
     });
 
     auto handle = selected_handle();
@@ -386,29 +939,31 @@ namespace hy {
       handle = next_handle;
     }
 
-    const auto siblings =
-      hy::siblings(selected_handle(), entities, root_handles);
-
-    int sibling_offset = 0;
-    int siblings_left = 0;
-    if (const auto sibling_it =
-          std::find(siblings.cbegin(), siblings.cend(), selected_handle());
-        sibling_it != siblings.cend()) {
-      sibling_offset = sibling_it - siblings.begin();
-      siblings_left = siblings.size() - sibling_offset;
-    }
+    // the new sibling goes after the last visible descendant of the last
+    // sibling (found through the row index instead of scanning siblings)
+    thh::handle_t last_sibling;
+    entities.call(selected_handle(), [&](const entity_t& entity) {
+      if (entity.parent_ == thh::handle_t()) {
+        last_sibling = root_handles.back();
+      } else {
+        entities.call(entity.parent_, [&](const entity_t& parent) {
+          last_sibling = parent.children_.back();
+        });
+      }
+    });
 
-    int child_count = 0;
-    for (int sibling_index = sibling_offset; sibling_index < siblings.size();
-         ++sibling_index) {
-      child_count +=
-        hy::expanded_count(siblings[sibling_index], entities, collapser) - 1;
+    int32_t inserted = 0;
+    if (const auto last_sibling_index =
+          flattened_handles_.index_of(last_sibling);
+        last_sibling_index.has_value()) {
+      inserted =
+        *last_sibling_index
+        + hy::expanded_count(
+          last_sibling, entities, collapser, traversal_context_);
     }
-
-    const auto inserted = flattened_handles_.insert(
-      flattened_handles_.begin() + selected_index().value_or(0) + child_count
-        + siblings_left,
-      {next_handle, selected_indent().value_or(0)});
+    const auto flattened_handle =
+      flattened_handle_t{next_handle, selected_indent().value_or(0)};
+    flattened_handles_.insert(inserted, flattened_handle);
 
     entities.call(handle, [&](hy::entity_t& entity) {
       const auto parent_handle =
@@ -421,248 +976,316 @@ namespace hy {
             })
           .value_or(thh::handle_t());
       if (parent_handle != thh::handle_t()) {
-        entities.call(next_handle, [parent_handle](hy::entity_t& entity) {
+        const auto sibling_index =
+          entities
+            .call_return(
+              parent_handle,
+              [](const hy::entity_t& parent) {
+                return (int32_t)parent.children_.size() - 1;
+              })
+            .value_or(0);
+        entities.call(next_handle, [&](hy::entity_t& entity) {
           entity.parent_ = parent_handle;
+          entity.sibling_index_ = sibling_index;
         });
+        collapser.update_expanded_count(parent_handle, 1, entities);
       } else {
+        entities.call(next_handle, [&](hy::entity_t& entity) {
+          entity.sibling_index_ = (int32_t)root_handles.size();
+        });
         root_handles.push_back(next_handle);
       }
     });
+    publish(hierarchy_event_t{
+      hierarchy_event_e::added, next_handle,
+      entities
+        .call_return(
+          next_handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t()),
+      thh::handle_t()});
 
-    return flattened_handle_position_t{
-      *inserted, int32_t(inserted - flattened_handles_.begin())};
+    return flattened_handle_position_t{flattened_handle, inserted};
   }
 
   void view_t::remove(
     thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
     std::vector<thh::handle_t>& root_handles) {
-    if (const auto handle = selected_handle(); handle != thh::handle_t()) {
-      if (entities
-            .call_return(
-              handle,
-              [&](const entity_t& entity) {
-                return entity.parent_ == thh::handle_t();
-              })
-            .value_or(false)) {
-        if (auto root =
-              std::find(root_handles.cbegin(), root_handles.cend(), handle);
-            root != root_handles.cend()) {
-          root_handles.erase(root);
-        }
-      }
+    entity_reclaimer_t reclaimer;
+    remove(entities, collapser, root_handles, reclaimer);
+    reclaimer.reclaim_all(entities, collapser);
+  }
 
-      const auto entity_and_descendants =
-        hy::entity_and_descendants(handle, entities);
+  void view_t::remove(
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles, entity_reclaimer_t& reclaimer) {
+    if (const auto handle = selected_handle(); handle != thh::handle_t()) {
       const auto expanded_count =
-        hy::expanded_count(handle, entities, collapser);
+        hy::expanded_count(handle, entities, collapser, traversal_context_);
 
-      entities.call(handle, [&](hy::entity_t& entity) {
-        entities.call(entity.parent_, [&](hy::entity_t& parent) {
-          parent.children_.erase(std::remove_if(
-            parent.children_.begin(), parent.children_.end(),
-            [handle](const thh::handle_t& h) { return handle == h; }));
-        });
-      });
-
-      for (const auto& h : entity_and_descendants) {
-        [[maybe_unused]] const bool removed = entities.remove(h);
-        assert(removed);
+      const auto parent_handle =
+        entities
+          .call_return(
+            handle, [](const entity_t& entity) { return entity.parent_; })
+          .value_or(thh::handle_t());
+      collapser.update_expanded_count(parent_handle, -expanded_count, entities);
+      auto* siblings =
+        parent_handle == thh::handle_t()
+          ? &root_handles
+          : entities
+              .call_return(
+                parent_handle,
+                [](hy::entity_t& parent) { return &parent.children_; })
+              .value_or(nullptr);
+      if (siblings != nullptr) {
+        if (const auto index = hy::sibling_index(handle, *siblings, entities);
+            index.has_value()) {
+          erase_sibling(*siblings, *index, entities);
+        }
       }
+      entities.call(
+        handle, [](entity_t& entity) { entity.parent_ = thh::handle_t(); });
+      collapser.remove(handle);
+      // other views count the removed rows before the entities are released
+      publish(hierarchy_event_t{
+        hierarchy_event_e::removed, handle, parent_handle, thh::handle_t()});
+      reclaimer.push(handle);
 
       flattened_handles_.erase(
-        flattened_handles_.begin() + *selected_index(),
-        flattened_handles_.begin() + *selected_index() + expanded_count);
+        *selected_index(), *selected_index() + expanded_count);
 
       selected_ = std::min((int)flattened_handles_.size() - 1, *selected_);
       offset_ =
         std::min(std::max((int)flattened_handles_.size() - 1, 0), offset_);
     }
-
-    // todo - need to also remove from collapsed
   }
 
-  void display_scrollable_hierarchy(
-    const thh::handle_vector_t<hy::entity_t>& entities,
-    const std::vector<thh::handle_t>& root_handles, const view_t& view,
-    const collapser_t& collapser, const display_ops_t& display_ops) {
-    thh::handle_t min_indent_handle;
-    int min_indent = std::numeric_limits<int>::max();
-
-    std::vector<std::pair<int, int>> connections;
-    const int total_handles = view.flattened_handles().size();
-    const int min_visible_handles =
-      std::min(total_handles - view.offset(), view.count());
-    // find another matching indent before a lower indent is found
-    std::vector<bool> ends;
-    ends.reserve(std::min(min_visible_handles, view.count()));
-    for (int row_index = 0; row_index < min_visible_handles; ++row_index) {
-      const int handle_index =
-        std::min(row_index + view.offset(), total_handles);
-      if (view.flattened_handles()[handle_index].indent_ < min_indent) {
-        min_indent = view.flattened_handles()[handle_index].indent_;
-        min_indent_handle =
-          view.flattened_handles()[handle_index].entity_handle_;
-      }
-      // search 'upwards' first (reverse iterators)
-      const int prev_row_index = row_index - 1;
-      const int prev_handle_index =
-        (total_handles - 1) - (view.offset() + prev_row_index);
-      if (auto found = std::find_if(
-            view.flattened_handles().rbegin() + prev_handle_index,
-            view.flattened_handles().rend(),
-            [&view, handle_index](const auto& flattened_handle) {
-              return view.flattened_handles()[handle_index].indent_
-                  == flattened_handle.indent_;
-            });
-          found != view.flattened_handles().rend()) {
-        const auto dist = (found + 1).base() - view.flattened_handles().begin();
-        if (dist < view.offset()) {
-          if (std::all_of(
-                view.flattened_handles().rbegin() + prev_handle_index, found,
-                [&view, handle_index](const auto& flattened_handle) {
-                  return flattened_handle.indent_
-                      >= view.flattened_handles()[handle_index].indent_;
-                })) {
-            for (int i = prev_row_index; i >= 0; i--) {
-              connections.push_back(
-                {view.flattened_handles()[handle_index].indent_, i});
-            }
-          }
-        }
-      }
-      const int next_row_index = row_index + 1;
-      const int next_handle_index =
-        std::min(view.offset() + next_row_index, total_handles);
-      if (auto found = std::find_if(
-            view.flattened_handles().begin() + next_handle_index,
-            view.flattened_handles().end(),
-            [&view, handle_index](const auto& flattened_handle) {
-              return view.flattened_handles()[handle_index].indent_
-                  == flattened_handle.indent_;
-            });
-          found != view.flattened_handles().end()) {
-        if (std::all_of(
-              view.flattened_handles().begin() + next_handle_index, found,
-              [&view, handle_index](const auto& flattened_handle) {
-                return flattened_handle.indent_
-                    >= view.flattened_handles()[handle_index].indent_;
-              })) {
-          const int range =
-            found - (view.flattened_handles().begin() + next_handle_index);
-          for (int i = next_row_index;
-               i < std::min(next_row_index + range, view.count()); i++) {
-            connections.push_back(
-              {view.flattened_handles()[handle_index].indent_, i});
-          }
-          ends.push_back(false);
-        } else {
-          ends.push_back(true);
-        }
-      } else {
-        ends.push_back(true);
-      }
+  bool view_t::move_selected_to(
+    const thh::handle_t parent_handle,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto handle = selected_handle();
+    if (handle == thh::handle_t()) {
+      return false;
     }
+    const int32_t first = *selected_index();
+    const int32_t count =
+      hy::expanded_count(handle, entities, collapser, traversal_context_);
+    // copy of the moved rows (expanded_count does not use this buffer)
+    auto& rows = traversal_context_.flattened_handles_;
+    rows.assign(
+      flattened_handles_.begin() + first,
+      flattened_handles_.begin() + first + count);
+    const auto previous_parent_handle =
+      entities
+        .call_return(
+          handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    if (!hy::reparent(
+          handle, parent_handle, entities, collapser, root_handles)) {
+      return false;
+    }
+    flattened_handles_.erase(first, first + count);
 
-    // can not be set if handles are empty
-    if (min_indent != std::numeric_limits<int>::max()) {
-      // draw all lines for entities that are offscreen
-      for (int indent_index = min_indent - 1; indent_index >= 0;
-           --indent_index) {
-        const bool draw =
-          entities
-            .call_return(
-              min_indent_handle,
-              [&](const hy::entity_t& entity) {
-                // update min indent as we walk backwards right to left
-                min_indent_handle = entity.parent_;
-                return entities
-                  .call_return(
-                    entity.parent_,
-                    [&](const hy::entity_t& parent) {
-                      if (parent.parent_ == thh::handle_t()) {
-                        if (auto it = std::find(
-                              root_handles.begin(), root_handles.end(),
-                              entity.parent_);
-                            it != root_handles.end()) {
-                          auto position = it - root_handles.begin();
-                          return position != (root_handles.size() - 1);
-                        }
-                        return false;
-                      }
-                      return entities
-                        .call_return(
-                          parent.parent_,
-                          [&](const hy::entity_t& grandparent) {
-                            if (auto it = std::find(
-                                  grandparent.children_.begin(),
-                                  grandparent.children_.end(), entity.parent_);
-                                it != grandparent.children_.end()) {
-                              auto position =
-                                it - grandparent.children_.begin();
-                              return position
-                                  != (grandparent.children_.size() - 1);
-                            }
-                            return false;
-                          })
-                        .value_or(false);
-                    })
-                  .value_or(false);
-              })
-            .value_or(false);
-        if (draw) {
-          for (int row = 0; row < view.count(); row++) {
-            display_ops.draw_at_fn_(
-              indent_index * display_ops.indent_width_, row,
-              display_ops.connection_);
-          }
-        }
+    // rows go after the parent's other visible descendants (the moved entity
+    // is now its last child), or at the end when becoming the last root
+    std::optional<int32_t> inserted;
+    int32_t indent = 0;
+    const auto parent_index = flattened_handles_.index_of(parent_handle);
+    if (parent_handle == thh::handle_t()) {
+      inserted = flattened_handles_.size();
+    } else if (
+      parent_index.has_value() && !collapser.collapsed(parent_handle)) {
+      inserted = *parent_index
+               + hy::expanded_count(
+                 parent_handle, entities, collapser, traversal_context_)
+               - count;
+      indent = flattened_handles_[*parent_index].indent_ + 1;
+    }
+
+    if (inserted.has_value()) {
+      const int32_t indent_delta = indent - rows.front().indent_;
+      for (auto& row : rows) {
+        row.indent_ += indent_delta;
       }
+      flattened_handles_.insert(
+        *inserted, rows.data(), rows.data() + rows.size());
+      selected_ = *inserted;
+    } else {
+      // moved under a collapsed entity, the rows are no longer visible
+      selected_ = std::min((int)flattened_handles_.size() - 1, first);
+    }
+    offset_ =
+      std::min(std::max((int)flattened_handles_.size() - 1, 0), offset_);
+    // scroll the selected row (possibly far from where it was) into view
+    if (selected_.has_value() && *selected_ >= 0) {
+      offset_ = std::clamp(
+        offset_, *selected_ - std::max(count_, 1) + 1, *selected_);
+    }
+    publish(hierarchy_event_t{
+      hierarchy_event_e::moved, handle, parent_handle,
+      previous_parent_handle});
+    return true;
+  }
+
+  void view_t::rename(
+    const std::string_view name,
+    thh::handle_vector_t<hy::entity_t>& entities) {
+    const auto handle = selected_handle();
+    if (const auto parent_handle = entities.call_return(
+          handle,
+          [name](entity_t& entity) {
+            entity.name_ = name;
+            return entity.parent_;
+          });
+        parent_handle.has_value()) {
+      publish(hierarchy_event_t{
+        hierarchy_event_e::renamed, handle, *parent_handle, thh::handle_t()});
+    }
+  }
+
+  void view_t::publish_to(
+    hierarchy_events_t* const events, const int32_t subscription) {
+    events_ = events;
+    subscription_ = subscription;
+  }
+
+  void view_t::notify(
+    const hierarchy_event_t& event,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    apply(event, entities, collapser, root_handles);
+    publish(event);
+  }
+
+  void view_t::publish(const hierarchy_event_t& event) const {
+    if (events_ != nullptr) {
+      events_->publish(event, subscription_);
     }
+  }
 
-    assert(ends.size() == std::min(min_visible_handles, view.count()));
+  void view_t::apply(
+    const hierarchy_event_t& event,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    const auto selected = selected_handle();
+    const int previous_selected = selected_.value_or(0);
+    const auto erase_rows = [&](const int32_t count) {
+      if (const auto index = flattened_handles_.index_of(event.entity_handle_);
+          index.has_value()) {
+        flattened_handles_.erase(*index, *index + count);
+      }
+    };
 
-    for (const auto& connection : connections) {
-      display_ops.draw_at_fn_(
-        connection.first * display_ops.indent_width_, connection.second,
-        display_ops.connection_);
+    // ancestors' cached counts are updated before anything new is counted
+    // (which would already include the edit)
+    switch (event.type_) {
+      case hierarchy_event_e::added: {
+        // usually a single entity but restored entities bring descendants
+        const int32_t count = hy::expanded_count(
+          event.entity_handle_, entities, collapser, traversal_context_);
+        collapser.update_expanded_count(event.parent_handle_, count, entities);
+        insert_rows(event.entity_handle_, entities, collapser, root_handles);
+        break;
+      }
+      case hierarchy_event_e::removed: {
+        const int32_t count = hy::expanded_count(
+          event.entity_handle_, entities, collapser, traversal_context_);
+        collapser.update_expanded_count(
+          event.parent_handle_, -count, entities);
+        collapser.remove(event.entity_handle_);
+        erase_rows(count);
+        break;
+      }
+      case hierarchy_event_e::moved: {
+        const int32_t count = hy::expanded_count(
+          event.entity_handle_, entities, collapser, traversal_context_);
+        collapser.update_expanded_count(
+          event.previous_parent_handle_, -count, entities);
+        collapser.update_expanded_count(event.parent_handle_, count, entities);
+        erase_rows(count);
+        insert_rows(event.entity_handle_, entities, collapser, root_handles);
+        break;
+      }
+      case hierarchy_event_e::renamed:
+        // rows only hold handles
+        break;
     }
 
-    const int count = std::min(
-      (int)view.flattened_handles().size(), view.offset() + view.count());
-    for (int handle_index = view.offset(); handle_index < count;
-         ++handle_index) {
-      const auto& flattened_handle = view.flattened_handles()[handle_index];
-      display_ops.draw_at_fn_(
-        flattened_handle.indent_ * display_ops.indent_width_,
-        handle_index - view.offset(),
-        ends[handle_index - view.offset()] ? display_ops.end_
-                                           : display_ops.mid_);
-      if (handle_index == view.selected_index()) {
-        display_ops.set_invert_fn_(true);
+    // keep the selected entity on the same line
+    if (const auto index = flattened_handles_.index_of(selected);
+        selected != thh::handle_t() && index.has_value()) {
+      offset_ = std::max(offset_ + *index - previous_selected, 0);
+      selected_ = *index;
+    } else {
+      selected_ = std::max(
+        std::min((int)flattened_handles_.size() - 1, previous_selected), 0);
+    }
+    offset_ =
+      std::min(std::max((int)flattened_handles_.size() - 1, 0), offset_);
+  }
+
+  int32_t view_t::insert_rows(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    const auto parent_handle =
+      entities
+        .call_return(
+          entity_handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    int32_t inserted = 0;
+    int32_t indent = 0;
+    if (parent_handle != thh::handle_t()) {
+      const auto parent_index = flattened_handles_.index_of(parent_handle);
+      if (!parent_index.has_value() || collapser.collapsed(parent_handle)) {
+        return 0;
       }
-      if (collapser.collapsed(flattened_handle.entity_handle_)) {
-        display_ops.set_bold_fn_(true);
+      inserted = *parent_index + 1;
+      indent = flattened_handles_[*parent_index].indent_ + 1;
+    }
+    // rows go after the visible rows of the previous sibling
+    const auto& siblings =
+      hy::sibling_handles(entity_handle, entities, root_handles);
+    if (const auto index =
+          hy::sibling_index(entity_handle, siblings, entities);
+        index.has_value() && *index > 0) {
+      const auto previous_handle = siblings[*index - 1];
+      if (const auto previous_index =
+            flattened_handles_.index_of(previous_handle);
+          previous_index.has_value()) {
+        inserted = *previous_index
+                 + hy::expanded_count(
+                   previous_handle, entities, collapser, traversal_context_);
       }
-      entities.call(flattened_handle.entity_handle_, [&](const auto& entity) {
-        display_ops.draw_fn_(entity.name_);
-      });
-      display_ops.set_invert_fn_(false);
-      display_ops.set_bold_fn_(false);
     }
+    const auto& rows = hy::flatten_entity(
+      entity_handle, indent, entities, collapser, traversal_context_);
+    flattened_handles_.insert(
+      inserted, rows.data(), rows.data() + rows.size());
+    return (int32_t)rows.size();
+  }
+
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const view_t& view,
+    const collapser_t& collapser, const display_ops_t& display_ops) {
+    display_ops_backend_t backend{&display_ops};
+    display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, backend);
   }
 } // namespace hy
 
 namespace demo {
   std::vector<thh::handle_t> create_sample_entities(
     thh::handle_vector_t<hy::entity_t>& entities) {
-    using namespace std::string_literals;
     const int64_t handle_count = 12;
     std::vector<thh::handle_t> handles;
     handles.reserve(handle_count);
     for (int64_t i = 0; i < handle_count; i++) {
       const auto handle = entities.add();
       entities.call(handle, [handle](auto& entity) {
-        entity.name_ = std::string("entity_") + std::to_string(handle.id_);
+        hy::set_default_name(entity, handle.id_);
       });
       handles.push_back(handle);
     }
@@ -674,13 +1297,16 @@ namespace demo {
       handles[2], {handles[5], handles[6], handles[11]}, entities);
     hy::add_children(handles[8], {handles[9]}, entities);
 
-    return {handles[0], handles[7], handles[8]};
+    std::vector<thh::handle_t> roots = {handles[0], handles[7], handles[8]};
+    for (int32_t r = 0; r < (int32_t)roots.size(); r++) {
+      entities.call(roots[r], [r](auto& entity) { entity.sibling_index_ = r; });
+    }
+    return roots;
   }
 
   std::vector<thh::handle_t> create_bench_entities(
     thh::handle_vector_t<hy::entity_t>& entities, const int root_count,
     const int handle_count) {
-    using namespace std::string_literals;
     std::vector<thh::handle_t> roots;
     for (int64_t r = 0; r < root_count; r++) {
       std::vector<thh::handle_t> handles;
@@ -688,15 +1314,25 @@ namespace demo {
       for (int64_t i = 0; i < handle_count; i++) {
         const auto handle = entities.add();
         entities.call(handle, [handle](auto& entity) {
-          entity.name_ = std::string("entity_") + std::to_string(handle.id_);
+          hy::set_default_name(entity, handle.id_);
         });
         handles.push_back(handle);
       }
 
+      // link directly instead of through add_children to avoid building a
+      // vector for each child
       for (int64_t i = 0; i < handle_count - 1; ++i) {
-        hy::add_children(handles[i], {handles[i + 1]}, entities);
+        entities.call(handles[i], [&](auto& entity) {
+          entity.children_.push_back(handles[i + 1]);
+        });
+        entities.call(handles[i + 1], [&](auto& entity) {
+          entity.parent_ = handles[i];
+        });
       }
 
+      entities.call(handles[0], [r](auto& entity) {
+        entity.sibling_index_ = (int32_t)r;
+      });
       roots.push_back(handles[0]);
     }
 
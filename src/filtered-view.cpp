@@ -0,0 +1,862 @@
+#include "hierarchy/filtered-view.hpp"
+
+#include "hierarchy/name-index.hpp"
+#include "hierarchy/thread-pool.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace hy {
+  namespace {
+    // rows visited in display order are emitted if they match or have a
+    // match below them, ancestors are held back until a match is found
+    struct match_filter_t {
+      // emit(id, indent) is called for each unemitted ancestor of a match
+      // (with the id it was visited with) and then the match itself
+      // start a new input whose rows are at indent or deeper (rows above it
+      // are not part of the input)
+      void reset(const int32_t indent) { emitted_count_ = indent; }
+
+      template<typename EmitFn>
+      void visit(
+        const int64_t id, const int32_t indent, const bool matched,
+        EmitFn&& emit) {
+        if ((int32_t)ancestors_.size() <= indent) {
+          ancestors_.resize(indent + 1);
+        }
+        ancestors_[indent] = id;
+        emitted_count_ = std::min(emitted_count_, indent);
+        if (matched) {
+          for (; emitted_count_ <= indent; emitted_count_++) {
+            emit(ancestors_[emitted_count_], emitted_count_);
+          }
+        }
+      }
+
+    private:
+      // ids of the current row and its ancestors (by indent), those before
+      // emitted_count_ have already been emitted
+      std::vector<int64_t> ancestors_;
+      int32_t emitted_count_ = 0;
+    };
+
+    // subtrees are not split below this depth (splitting long chains of
+    // single children doesn't balance the work)
+    constexpr int max_split_depth = 8;
+
+    // ascii only to match name_contains
+    char lower(const char c) {
+      return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+    }
+
+    std::string lower_case(const std::string_view str) {
+      std::string lowered(str);
+      std::transform(lowered.begin(), lowered.end(), lowered.begin(), lower);
+      return lowered;
+    }
+
+    // number of queries (from the first) name contains (both lower case),
+    // each query contains the one before it so the count stops at the first
+    // mismatch
+    int32_t match_depth(
+      const std::string_view name, const std::vector<std::string>& queries) {
+      int32_t depth = 0;
+      while (depth < (int32_t)queries.size()
+             && name.find(queries[depth]) != std::string_view::npos) {
+        depth++;
+      }
+      return depth;
+    }
+  } // namespace
+
+  filtered_view_t::filtered_view_t(
+    const int count, thread_pool_t* thread_pool)
+    : thread_pool_(thread_pool), count_(count) {}
+
+  void filtered_view_t::rows_t::push_back(
+    const flattened_handle_t& row, const int32_t match_depth,
+    const std::string_view name) {
+    if (row.indent_ == 0) {
+      root_rows_.push_back((int32_t)rows_.size());
+    }
+    rows_.push_back(row);
+    match_depths_.push_back(match_depth);
+    names_.append(name);
+    name_offsets_.push_back((int64_t)names_.size());
+  }
+
+  void filtered_view_t::rows_t::append(
+    const rows_t& rows, const size_t first, const size_t last) {
+    for (auto root = std::lower_bound(
+           rows.root_rows_.begin(), rows.root_rows_.end(), (int32_t)first);
+         root != rows.root_rows_.end() && *root < (int32_t)last; ++root) {
+      root_rows_.push_back(*root - (int32_t)first + (int32_t)rows_.size());
+    }
+    rows_.insert(
+      rows_.end(), rows.rows_.begin() + first, rows.rows_.begin() + last);
+    match_depths_.insert(
+      match_depths_.end(), rows.match_depths_.begin() + first,
+      rows.match_depths_.begin() + last);
+    const int64_t offset = (int64_t)names_.size() - rows.name_offsets_[first];
+    for (size_t row = first; row < last; row++) {
+      name_offsets_.push_back(rows.name_offsets_[row + 1] + offset);
+    }
+    names_.append(
+      rows.names_, rows.name_offsets_[first],
+      rows.name_offsets_[last] - rows.name_offsets_[first]);
+  }
+
+  void filtered_view_t::rows_t::replace(
+    const size_t first, const size_t last, const rows_t& rows) {
+    const auto replace_range = [first, last](auto& values, const auto& with) {
+      values.erase(values.begin() + first, values.begin() + last);
+      values.insert(values.begin() + first, with.begin(), with.end());
+    };
+    replace_range(rows_, rows.rows_);
+    replace_range(match_depths_, rows.match_depths_);
+
+    // names after the replaced ones move by the change in length
+    const int64_t names_first = name_offsets_[first];
+    const int64_t names_last = name_offsets_[last];
+    const int64_t names_delta =
+      (int64_t)rows.names_.size() - (names_last - names_first);
+    names_.replace(names_first, names_last - names_first, rows.names_);
+    for (size_t row = last + 1; row < name_offsets_.size(); row++) {
+      name_offsets_[row] += names_delta;
+    }
+    name_offsets_.erase(
+      name_offsets_.begin() + first + 1, name_offsets_.begin() + last + 1);
+    name_offsets_.insert(
+      name_offsets_.begin() + first + 1, rows.name_offsets_.begin() + 1,
+      rows.name_offsets_.end());
+    for (size_t row = first + 1; row < first + 1 + rows.size(); row++) {
+      name_offsets_[row] += names_first;
+    }
+
+    // roots after the replaced ones move by the change in row count
+    const int32_t rows_delta = (int32_t)rows.size() - (int32_t)(last - first);
+    const auto roots_first = std::lower_bound(
+      root_rows_.begin(), root_rows_.end(), (int32_t)first);
+    const auto roots_last =
+      std::lower_bound(roots_first, root_rows_.end(), (int32_t)last);
+    for (auto root = roots_last; root != root_rows_.end(); ++root) {
+      *root += rows_delta;
+    }
+    const auto inserted = root_rows_.erase(roots_first, roots_last);
+    const auto roots = root_rows_.insert(
+      inserted, rows.root_rows_.begin(), rows.root_rows_.end());
+    std::for_each(
+      roots, roots + rows.root_rows_.size(),
+      [first](int32_t& root) { root += (int32_t)first; });
+  }
+
+  void filtered_view_t::rows_t::clear() {
+    rows_.clear();
+    match_depths_.clear();
+    name_offsets_.assign(1, 0);
+    names_.clear();
+    root_rows_.clear();
+  }
+
+  void filtered_view_t::set_query(
+    const std::string_view query,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    const auto selected_handle = this->selected_handle();
+    // go back to the longest previous query the new query contains
+    while (!queries_.empty() && !name_contains(query, queries_.back())) {
+      queries_.pop_back();
+    }
+    if (queries_.empty()) {
+      queries_.emplace_back(query);
+      scan(entities, root_handles);
+      show_scanned(1);
+      restore_selection(scanned_row(selected_handle));
+      return;
+    }
+
+    // the scanned rows are unchanged
+    const auto selected_row = this->selected_row();
+    const int level = (int)queries_.size();
+    show_level(level);
+    if (queries_.back() != query) {
+      show_shown(level, lower_case(query));
+      queries_.emplace_back(query);
+    }
+    restore_selection(selected_row);
+  }
+
+  std::string_view filtered_view_t::query() const {
+    return queries_.empty() ? std::string_view() : queries_.back();
+  }
+
+  void filtered_view_t::set_filter(
+    entity_filter_fn filter,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    filter_ = std::move(filter);
+    if (!filter_ && query().empty()) {
+      clear();
+      return;
+    }
+    if (queries_.empty()) {
+      // every entity contains the empty query
+      queries_.emplace_back();
+    }
+    refresh(entities, root_handles);
+  }
+
+  void filtered_view_t::clear() {
+    queries_.clear();
+    filter_ = nullptr;
+    scanned_ = rows_t{};
+    shown_ = {};
+    next_shown_ = {};
+    chunk_shown_ = {};
+    shown_history_ = {};
+    shown_level_ = 0;
+    offset_ = 0;
+    selected_ = 0;
+  }
+
+  void filtered_view_t::update(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (queries_.empty()) {
+      return;
+    }
+    const auto selected_handle = this->selected_handle();
+    auto selected_row = this->selected_row();
+    // splice rows, following the selected entity's row (only the new rows
+    // are searched if it was in the replaced rows)
+    const auto splice_rows = [&](
+                               const int32_t first, const int32_t last,
+                               const rows_t& rows) {
+      splice(first, last, rows);
+      const int32_t next_last = first + (int32_t)rows.size();
+      if (selected_row.has_value() && *selected_row >= last) {
+        *selected_row += next_last - last;
+      } else if (!selected_row.has_value() || *selected_row >= first) {
+        selected_row.reset();
+        for (int32_t row = first; row < next_last; row++) {
+          if (scanned_.rows_[row].entity_handle_ == selected_handle) {
+            selected_row = row;
+            break;
+          }
+        }
+      }
+    };
+
+    // rescan the root entity_handle is under (if it still exists)
+    thh::handle_t root;
+    std::optional<int32_t> root_index;
+    if (entities
+          .call_return(entity_handle, [](const entity_t&) { return true; })
+          .value_or(false)) {
+      root = root_handle(entity_handle, entities).first;
+      root_index = sibling_index(root, root_handles, entities);
+    }
+
+    const auto& root_rows = scanned_.root_rows_;
+    const auto root_at = [this](const int32_t row) {
+      return scanned_.rows_[row].entity_handle_;
+    };
+    const auto root_order = [&](const int32_t row) {
+      return sibling_index(root_at(row), root_handles, entities).value_or(-1);
+    };
+    // a root that has been removed, reparented or moved to another position
+    // loses its rows (the rows of a root in place are kept to be replaced)
+    if (const auto segment = std::find_if(
+          root_rows.begin(), root_rows.end(),
+          [&](const int32_t row) { return root_at(row) == entity_handle; });
+        segment != root_rows.end()) {
+      const auto segment_index = segment - root_rows.begin();
+      const bool in_place =
+        entity_handle == root && root_index.has_value()
+        && (segment == root_rows.begin()
+            || root_order(*(segment - 1)) < *root_index)
+        && (segment + 1 == root_rows.end()
+            || root_order(*(segment + 1)) > *root_index);
+      if (!in_place) {
+        splice_rows(*segment, scanned_.root_end(segment_index), rows_t{});
+      }
+    }
+
+    if (root_index.has_value()) {
+      rows_t rows;
+      scan_roots(&root, 1, entities, rows);
+      // roots appear in the order of root_handles
+      const auto segment = std::partition_point(
+        root_rows.begin(), root_rows.end(),
+        [&](const int32_t row) { return root_order(row) < *root_index; });
+      const auto segment_index = segment - root_rows.begin();
+      const int32_t first =
+        segment == root_rows.end() ? (int32_t)scanned_.size() : *segment;
+      const int32_t last =
+        segment != root_rows.end() && root_at(*segment) == root
+          ? scanned_.root_end(segment_index)
+          : first;
+      if (first != last || rows.size() > 0) {
+        splice_rows(first, last, rows);
+      }
+    }
+
+    restore_selection(selected_row);
+  }
+
+  void filtered_view_t::refresh(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (queries_.empty()) {
+      return;
+    }
+    const auto selected_handle = this->selected_handle();
+    scan(entities, root_handles);
+    show_scanned((int)queries_.size());
+    restore_selection(scanned_row(selected_handle));
+  }
+
+  void filtered_view_t::move_up() {
+    if (!selected_index().has_value()) {
+      return;
+    }
+    selected_ = std::max(selected_ - 1, 0);
+    if (selected_ - offset_ + 1 == 0) {
+      offset_ = std::max(offset_ - 1, 0);
+    }
+  }
+
+  void filtered_view_t::move_down() {
+    if (!selected_index().has_value()) {
+      return;
+    }
+    const int min_offset = std::max(row_count() - count_, 0);
+    selected_ = std::min(selected_ + 1, row_count() - 1);
+    if (selected_ - count_ - offset_ == 0) {
+      offset_ = std::min(offset_ + 1, min_offset);
+    }
+  }
+
+  thh::handle_t filtered_view_t::selected_handle() const {
+    if (!selected_index().has_value()) {
+      return thh::handle_t();
+    }
+    return row(selected_).entity_handle_;
+  }
+
+  std::optional<int> filtered_view_t::selected_index() const {
+    if (shown_.empty()) {
+      return {};
+    }
+    return selected_;
+  }
+
+  std::optional<int> filtered_view_t::selected_indent() const {
+    if (!selected_index().has_value()) {
+      return {};
+    }
+    return row(selected_).indent_;
+  }
+
+  void filtered_view_t::scan(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    scanned_.clear();
+    scan_roots(
+      root_handles.data(), (int)root_handles.size(), entities, scanned_);
+  }
+
+  void filtered_view_t::scan_roots(
+    const thh::handle_t* root_handles, const int root_count,
+    const thh::handle_vector_t<hy::entity_t>& entities, rows_t& rows) const {
+    // subtrees are split into their own row and a unit for each child until
+    // there are enough units to balance the chunks (so a few large roots are
+    // still scanned in parallel)
+    const int unit_target =
+      chunk_count(std::numeric_limits<int64_t>::max());
+    std::vector<scan_unit_t> units;
+    units.reserve(root_count);
+    for (int root = 0; root < root_count; root++) {
+      units.push_back(
+        scan_unit_t{flattened_handle_t{root_handles[root], 0}, false});
+    }
+    std::vector<scan_unit_t> split_units;
+    for (int depth = 0;
+         depth < max_split_depth && (int)units.size() < unit_target; depth++) {
+      split_units.clear();
+      for (const auto& unit : units) {
+        const auto* children =
+          unit.single_ ? nullptr
+                       : entities
+                           .call_return(
+                             unit.row_.entity_handle_,
+                             [](const entity_t& entity) {
+                               return &entity.children_;
+                             })
+                           .value_or(nullptr);
+        if (children == nullptr || children->empty()) {
+          split_units.push_back(unit);
+          continue;
+        }
+        split_units.push_back(scan_unit_t{unit.row_, true});
+        for (const auto child : *children) {
+          split_units.push_back(scan_unit_t{
+            flattened_handle_t{child, unit.row_.indent_ + 1}, false});
+        }
+      }
+      if (split_units.size() == units.size()) {
+        break;
+      }
+      units.swap(split_units);
+    }
+
+    // scan each chunk of units to its own buffer
+    const int unit_count = (int)units.size();
+    const int chunk_count = this->chunk_count(unit_count);
+    const auto first_unit = [unit_count, chunk_count](const int chunk) {
+      return (int)((int64_t)unit_count * chunk / chunk_count);
+    };
+    std::vector<rows_t> chunk_rows(chunk_count);
+    // the chunk of each unit and the end of its rows in the chunk's buffer
+    std::vector<int32_t> unit_chunks(unit_count);
+    std::vector<int64_t> unit_ends(unit_count);
+    for_each_chunk(chunk_count, [&](const int chunk) {
+      const int first = first_unit(chunk);
+      const int last = first_unit(chunk + 1);
+      std::fill(
+        unit_chunks.begin() + first, unit_chunks.begin() + last, chunk);
+      scan_units(
+        units.data() + first, last - first, entities, chunk_rows[chunk],
+        unit_ends.data() + first);
+    });
+
+    size_t row_count = rows.size();
+    size_t names_size = rows.names_.size();
+    for (const auto& chunk : chunk_rows) {
+      row_count += chunk.size();
+      names_size += chunk.names_.size();
+    }
+    rows.rows_.reserve(row_count);
+    rows.match_depths_.reserve(row_count);
+    rows.name_offsets_.reserve(row_count + 1);
+    rows.names_.reserve(names_size);
+
+    // split rows are only kept if they match or a unit below them has rows
+    const auto unit_first = [&](const int unit) {
+      return unit == first_unit(unit_chunks[unit]) ? 0 : unit_ends[unit - 1];
+    };
+    const auto keep = [&](const int64_t unit, int32_t /*indent*/) {
+      rows.append(
+        chunk_rows[unit_chunks[unit]], unit_first((int)unit),
+        unit_ends[unit]);
+    };
+    match_filter_t match_filter;
+    for (int unit = 0; unit < unit_count; unit++) {
+      const int64_t first = unit_first(unit);
+      const bool matched =
+        units[unit].single_
+          ? chunk_rows[unit_chunks[unit]].match_depths_[first] > 0
+          : unit_ends[unit] > first;
+      match_filter.visit(unit, units[unit].row_.indent_, matched, keep);
+    }
+  }
+
+  void filtered_view_t::scan_units(
+    const scan_unit_t* units, const int unit_count,
+    const thh::handle_vector_t<hy::entity_t>& entities, rows_t& rows,
+    int64_t* unit_ends) const {
+    std::vector<std::string> queries;
+    for (const auto& query : queries_) {
+      queries.push_back(lower_case(query));
+    }
+
+    // the current row and its ancestors (by indent) until they are kept
+    struct pending_t {
+      flattened_handle_t row_;
+      int32_t match_depth_;
+      std::string name_; // lower case
+    };
+    std::vector<pending_t> pending;
+    const auto visit = [&](
+                         const entity_t& entity,
+                         const flattened_handle_t& row) -> const pending_t& {
+      if ((int32_t)pending.size() <= row.indent_) {
+        pending.resize(row.indent_ + 1);
+      }
+      auto& visited = pending[row.indent_];
+      visited.row_ = row;
+      const std::string_view name = entity.name_;
+      visited.name_.resize(name.size());
+      std::transform(name.begin(), name.end(), visited.name_.begin(), lower);
+      visited.match_depth_ = !filter_ || filter_(entity)
+                             ? match_depth(visited.name_, queries)
+                             : 0;
+      return visited;
+    };
+    match_filter_t match_filter;
+    const auto keep = [&rows, &pending](int64_t /*id*/, const int32_t indent) {
+      const auto& ancestor = pending[indent];
+      rows.push_back(ancestor.row_, ancestor.match_depth_, ancestor.name_);
+    };
+
+    const expand_all_t expand_all;
+    pre_order_t<expand_all_t> pre_order;
+    for (int unit = 0; unit < unit_count; unit++) {
+      const auto& unit_row = units[unit].row_;
+      if (units[unit].single_) {
+        // kept (or not) once the units below it are scanned
+        entities.call(unit_row.entity_handle_, [&](const entity_t& entity) {
+          const auto& row = visit(entity, unit_row);
+          rows.push_back(row.row_, row.match_depth_, row.name_);
+        });
+        unit_ends[unit] = (int64_t)rows.size();
+        continue;
+      }
+      match_filter.reset(unit_row.indent_);
+      for (pre_order.reset(
+             unit_row.entity_handle_, unit_row.indent_, entities, expand_all);
+           !pre_order.done(); pre_order.next()) {
+        const entity_t* entity = pre_order.entity();
+        if (entity == nullptr) {
+          continue;
+        }
+        const auto& row = visit(*entity, pre_order.current());
+        match_filter.visit(0, row.row_.indent_, row.match_depth_ > 0, keep);
+      }
+      unit_ends[unit] = (int64_t)rows.size();
+    }
+  }
+
+  void filtered_view_t::show_level(const int level) {
+    while (shown_level_ > level && !shown_history_.empty()) {
+      shown_ = std::move(shown_history_.back().shown_);
+      shown_level_ = shown_history_.back().level_;
+      shown_history_.pop_back();
+    }
+    if (shown_level_ > level) {
+      show_scanned(level);
+    }
+  }
+
+  void filtered_view_t::show_scanned(const int level) {
+    const auto& match_depths = scanned_.match_depths_;
+    show(
+      (int64_t)scanned_.size(), [](const int64_t i) { return (int32_t)i; },
+      [&match_depths, level](const int64_t i) {
+        return match_depths[i] >= level;
+      });
+    shown_.swap(next_shown_);
+    shown_history_.clear();
+    shown_level_ = level;
+  }
+
+  void filtered_view_t::show_shown(
+    const int level, const std::string_view query) {
+    // only the current matches can match a query containing the current one
+    auto& match_depths = scanned_.match_depths_;
+    const int chunk_count = this->chunk_count(shown_.size());
+    std::vector<int64_t> unmatched(chunk_count, 0);
+    for_each_chunk(chunk_count, [&](const int chunk) {
+      const int64_t first = (int64_t)shown_.size() * chunk / chunk_count;
+      const int64_t last = (int64_t)shown_.size() * (chunk + 1) / chunk_count;
+      for (int64_t i = first; i < last; i++) {
+        const int32_t row = shown_[i].row_;
+        if (match_depths[row] >= level) {
+          const bool matched =
+            scanned_.name(row).find(query) != std::string_view::npos;
+          match_depths[row] = matched ? level + 1 : level;
+          unmatched[chunk] += matched ? 0 : 1;
+        }
+      }
+    });
+    // the rows are unchanged if every match still matches
+    if (std::all_of(unmatched.begin(), unmatched.end(), [](const auto count) {
+          return count == 0;
+        })) {
+      return;
+    }
+
+    show(
+      (int64_t)shown_.size(),
+      [this](const int64_t i) { return shown_[i].row_; },
+      [this, &match_depths, level](const int64_t i) {
+        return match_depths[shown_[i].row_] > level;
+      });
+    shown_history_.push_back(shown_snapshot_t{shown_level_, std::move(shown_)});
+    shown_ = std::move(next_shown_);
+    next_shown_ = {};
+    shown_level_ = level + 1;
+  }
+
+  template<typename RowFn, typename MatchedFn>
+  void filtered_view_t::show(
+    const int64_t input_count, RowFn row_at, MatchedFn matched_at) {
+    const auto indent_at = [&](const int64_t i) {
+      return scanned_.rows_[row_at(i)].indent_;
+    };
+
+    // split the input at roots so each chunk is shown independently
+    const int chunk_count = this->chunk_count(input_count);
+    std::vector<int64_t> bounds(chunk_count + 1, input_count);
+    bounds[0] = 0;
+    for (int chunk = 1; chunk < chunk_count; chunk++) {
+      int64_t bound =
+        std::max(input_count * chunk / chunk_count, bounds[chunk - 1]);
+      while (bound < input_count && indent_at(bound) != 0) {
+        bound++;
+      }
+      bounds[chunk] = bound;
+    }
+
+    // rows are shown with parents and last siblings relative to the chunk
+    const auto show_chunk = [&](const int chunk, auto& shown) {
+      // most recent shown row at each indent
+      std::vector<int32_t> shown_at;
+      const auto emit = [&](const int64_t i, const int32_t indent) {
+        if ((int32_t)shown_at.size() <= indent) {
+          shown_at.resize(indent + 1, -1);
+        }
+        const int32_t parent = indent == 0 ? -1 : shown_at[indent - 1];
+        // the previous row at this indent is a sibling if it was shown after
+        // the parent
+        if (const int32_t sibling = shown_at[indent];
+            sibling != -1 && sibling > parent) {
+          shown[sibling].last_ = false;
+        }
+        shown_at[indent] = (int32_t)shown.size();
+        shown.push_back(shown_row_t{row_at(i), parent, true});
+      };
+      match_filter_t match_filter;
+      for (int64_t i = bounds[chunk]; i < bounds[chunk + 1]; i++) {
+        match_filter.visit(i, indent_at(i), matched_at(i), emit);
+      }
+    };
+
+    next_shown_.clear();
+    if (chunk_count == 1) {
+      show_chunk(0, next_shown_);
+      return;
+    }
+
+    chunk_shown_.resize(chunk_count);
+    for_each_chunk(chunk_count, [&](const int chunk) {
+      chunk_shown_[chunk].clear();
+      show_chunk(chunk, chunk_shown_[chunk]);
+    });
+    std::vector<int32_t> offsets(chunk_count + 1, 0);
+    for (int chunk = 0; chunk < chunk_count; chunk++) {
+      offsets[chunk + 1] = offsets[chunk] + (int32_t)chunk_shown_[chunk].size();
+    }
+    // only the last root of the last chunk with rows is a last sibling
+    int last_chunk = chunk_count - 1;
+    while (last_chunk > 0 && chunk_shown_[last_chunk].empty()) {
+      last_chunk--;
+    }
+    next_shown_.resize(offsets.back());
+    for_each_chunk(chunk_count, [&](const int chunk) {
+      const int32_t offset = offsets[chunk];
+      int32_t index = offset;
+      for (auto shown_row : chunk_shown_[chunk]) {
+        if (shown_row.parent_ == -1) {
+          shown_row.last_ = shown_row.last_ && chunk == last_chunk;
+        } else {
+          shown_row.parent_ += offset;
+        }
+        next_shown_[index++] = shown_row;
+      }
+    });
+  }
+
+  void filtered_view_t::splice(
+    const int32_t first, const int32_t last, const rows_t& rows) {
+    scanned_.replace(first, last, rows);
+    const int32_t next_last = first + (int32_t)rows.size();
+
+    // a snapshot stands for every level up to the next one, so it is split
+    // at the levels where one of the new rows stops matching
+    const int query_count = (int)queries_.size();
+    std::vector<bool> depths(query_count + 1, false);
+    for (const auto depth : rows.match_depths_) {
+      depths[std::min(depth, query_count)] = true;
+    }
+    shown_history_.push_back(
+      shown_snapshot_t{shown_level_, std::move(shown_)});
+    std::vector<shown_snapshot_t> history;
+    std::vector<int> levels;
+    for (size_t i = 0; i < shown_history_.size(); i++) {
+      auto& snapshot = shown_history_[i];
+      const int end_level = i + 1 < shown_history_.size()
+                            ? shown_history_[i + 1].level_
+                            : query_count + 1;
+      levels.assign(1, snapshot.level_);
+      for (int level = snapshot.level_ + 1; level < end_level; level++) {
+        if (depths[level - 1]) {
+          levels.push_back(level);
+        }
+      }
+      for (size_t j = 0; j < levels.size(); j++) {
+        history.push_back(shown_snapshot_t{
+          levels[j], j + 1 < levels.size() ? snapshot.shown_
+                                           : std::move(snapshot.shown_)});
+        splice_shown(history.back().shown_, first, last, next_last, levels[j]);
+      }
+    }
+    shown_ = std::move(history.back().shown_);
+    shown_level_ = history.back().level_;
+    history.pop_back();
+    shown_history_ = std::move(history);
+  }
+
+  void filtered_view_t::splice_shown(
+    std::vector<shown_row_t>& shown, const int32_t first, const int32_t last,
+    const int32_t next_last, const int level) {
+    // shown rows are in the order of the scanned rows they show
+    const auto row_less = [](const shown_row_t& shown_row, const int32_t row) {
+      return shown_row.row_ < row;
+    };
+    const auto shown_first =
+      std::lower_bound(shown.begin(), shown.end(), first, row_less)
+      - shown.begin();
+    const auto shown_last =
+      std::lower_bound(shown.begin() + shown_first, shown.end(), last, row_less)
+      - shown.begin();
+
+    const auto& match_depths = scanned_.match_depths_;
+    show(
+      next_last - first,
+      [first](const int64_t i) { return first + (int32_t)i; },
+      [&match_depths, first, level](const int64_t i) {
+        return match_depths[first + i] >= level;
+      });
+
+    // rows after the replaced ones (under later roots) are shifted
+    const int32_t rows_delta = next_last - last;
+    const int32_t shown_delta =
+      (int32_t)next_shown_.size() - (int32_t)(shown_last - shown_first);
+    for (auto i = shown_last; i < (int64_t)shown.size(); i++) {
+      shown[i].row_ += rows_delta;
+      if (shown[i].parent_ != -1) {
+        shown[i].parent_ += shown_delta;
+      }
+    }
+    for (auto& shown_row : next_shown_) {
+      if (shown_row.parent_ != -1) {
+        shown_row.parent_ += (int32_t)shown_first;
+      }
+    }
+    shown.erase(shown.begin() + shown_first, shown.begin() + shown_last);
+    shown.insert(
+      shown.begin() + shown_first, next_shown_.begin(), next_shown_.end());
+
+    // only the last shown root is a last sibling
+    const auto shown_end = shown_first + (int64_t)next_shown_.size();
+    if (!next_shown_.empty()) {
+      shown[shown_first].last_ = shown_end == (int64_t)shown.size();
+    }
+    if (shown_first > 0) {
+      auto previous_root = shown_first - 1;
+      while (shown[previous_root].parent_ != -1) {
+        previous_root = shown[previous_root].parent_;
+      }
+      shown[previous_root].last_ = shown_first == (int64_t)shown.size();
+    }
+  }
+
+  std::optional<int32_t> filtered_view_t::selected_row() const {
+    if (!selected_index().has_value()) {
+      return {};
+    }
+    return shown_[selected_].row_;
+  }
+
+  std::optional<int32_t> filtered_view_t::scanned_row(
+    const thh::handle_t entity_handle) const {
+    if (entity_handle == thh::handle_t()) {
+      return {};
+    }
+    const auto& rows = scanned_.rows_;
+    if (const auto row = std::find_if(
+          rows.begin(), rows.end(),
+          [entity_handle](const flattened_handle_t& row) {
+            return row.entity_handle_ == entity_handle;
+          });
+        row != rows.end()) {
+      return (int32_t)(row - rows.begin());
+    }
+    return {};
+  }
+
+  void filtered_view_t::restore_selection(
+    const std::optional<int32_t> selected_row) {
+    selected_ = 0;
+    if (selected_row.has_value()) {
+      // shown rows are in the order of the scanned rows they show
+      if (const auto shown = std::lower_bound(
+            shown_.begin(), shown_.end(), *selected_row,
+            [](const shown_row_t& shown_row, const int32_t row) {
+              return shown_row.row_ < row;
+            });
+          shown != shown_.end() && shown->row_ == *selected_row) {
+        selected_ = (int)(shown - shown_.begin());
+      }
+    }
+    // keep the selection in view
+    offset_ = std::clamp(offset_, selected_ - count_ + 1, selected_);
+    offset_ = std::max(std::min(offset_, row_count() - count_), 0);
+  }
+
+  template<typename Fn>
+  void filtered_view_t::for_each_chunk(
+    const int chunk_count, const Fn& fn) const {
+    if (thread_pool_ != nullptr && chunk_count > 1) {
+      thread_pool_->for_each(chunk_count, fn);
+    } else {
+      for (int chunk = 0; chunk < chunk_count; chunk++) {
+        fn(chunk);
+      }
+    }
+  }
+
+  int filtered_view_t::chunk_count(const int64_t count) const {
+    // several chunks per thread to balance uneven work
+    const int64_t chunks =
+      thread_pool_ != nullptr && thread_pool_->thread_count() > 1
+        ? thread_pool_->thread_count() * 4
+        : 1;
+    return (int)std::max<int64_t>(std::min(chunks, count), 1);
+  }
+
+  int32_t subscribe(
+    hierarchy_events_t& events, filtered_view_t& filtered_view,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    return events.subscribe(
+      [&filtered_view, &entities,
+       &root_handles](const hierarchy_event_t& event) {
+        // a removed entity is already unlinked so its parent is rescanned
+        // (a removed root is no longer in root_handles so its rows are
+        // dropped)
+        if (
+          event.type_ == hierarchy_event_e::removed
+          && event.parent_handle_ != thh::handle_t()) {
+          filtered_view.update(event.parent_handle_, entities, root_handles);
+          return;
+        }
+        filtered_view.update(event.entity_handle_, entities, root_handles);
+        if (
+          event.type_ == hierarchy_event_e::moved
+          && event.previous_parent_handle_ != thh::handle_t()) {
+          filtered_view.update(
+            event.previous_parent_handle_, entities, root_handles);
+        }
+      });
+  }
+
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const filtered_view_t& view, const display_ops_t& display_ops) {
+    display_ops_backend_t backend{&display_ops};
+    display_scrollable_hierarchy(entities, view, backend);
+  }
+} // namespace hy
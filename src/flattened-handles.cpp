@@ -0,0 +1,391 @@
+#include "hierarchy/flattened-handles.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace hy {
+  flattened_handles_t::flattened_handles_t(
+    const std::vector<flattened_handle_t>& flattened_handles) {
+    root_ = build(
+      flattened_handles.data(),
+      flattened_handles.data() + flattened_handles.size());
+  }
+
+  const flattened_handle_t& flattened_handles_t::operator[](
+    const int32_t index) const {
+    int32_t node_begin = 0;
+    const int32_t node = find(index, node_begin);
+    return nodes_[node].rows_[index - node_begin];
+  }
+
+  std::optional<int32_t> flattened_handles_t::index_of(
+    const thh::handle_t entity_handle) const {
+    if (
+      entity_handle.id_ < 0
+      || entity_handle.id_ >= (int32_t)handle_nodes_.size()
+      || handle_nodes_[entity_handle.id_] == -1) {
+      return {};
+    }
+    const int32_t node = handle_nodes_[entity_handle.id_];
+    const auto& n = nodes_[node];
+    const auto row = std::find_if(
+      n.rows_, n.rows_ + n.size_,
+      [entity_handle](const flattened_handle_t& flattened_handle) {
+        return flattened_handle.entity_handle_ == entity_handle;
+      });
+    if (row == n.rows_ + n.size_) {
+      return {};
+    }
+    // rank of the chunk, add the rows of everything to its left
+    int32_t index = (int32_t)(row - n.rows_) + count(n.left_);
+    for (int32_t child = node, parent = n.parent_; parent != -1;
+         child = parent, parent = nodes_[parent].parent_) {
+      if (nodes_[parent].right_ == child) {
+        index += count(nodes_[parent].left_) + nodes_[parent].size_;
+      }
+    }
+    return index;
+  }
+
+  void flattened_handles_t::insert(
+    const int32_t index, const flattened_handle_t& flattened_handle) {
+    insert(index, &flattened_handle, &flattened_handle + 1);
+  }
+
+  void flattened_handles_t::insert(
+    const int32_t index, const flattened_handle_t* first,
+    const flattened_handle_t* last) {
+    if (first == last) {
+      return;
+    }
+    assert(index >= 0 && index <= size());
+    const auto [left, right] = split(root_, index);
+    const int32_t middle = build(first, last);
+    root_ = join(join(left, middle), right);
+  }
+
+  void flattened_handles_t::erase(const int32_t first, const int32_t last) {
+    if (first >= last) {
+      return;
+    }
+    assert(first >= 0 && last <= size());
+    const auto [left, rest] = split(root_, first);
+    const auto [middle, right] = split(rest, last - first);
+    free_tree(middle);
+    root_ = join(left, right);
+  }
+
+  void flattened_handles_t::clear() {
+    nodes_.clear();
+    free_nodes_.clear();
+    handle_nodes_.clear();
+    root_ = -1;
+  }
+
+  void flattened_handles_t::update(const int32_t node) {
+    auto& n = nodes_[node];
+    n.count_ = count(n.left_) + count(n.right_) + n.size_;
+    if (n.left_ != -1) {
+      nodes_[n.left_].parent_ = node;
+    }
+    if (n.right_ != -1) {
+      nodes_[n.right_].parent_ = node;
+    }
+  }
+
+  int32_t flattened_handles_t::allocate_node() {
+    int32_t node;
+    if (!free_nodes_.empty()) {
+      node = free_nodes_.back();
+      free_nodes_.pop_back();
+    } else {
+      node = (int32_t)nodes_.size();
+      nodes_.emplace_back();
+    }
+    // xorshift32
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 17;
+    seed_ ^= seed_ << 5;
+    auto& n = nodes_[node];
+    n.left_ = n.right_ = n.parent_ = -1;
+    n.priority_ = seed_;
+    n.count_ = n.size_ = 0;
+    return node;
+  }
+
+  void flattened_handles_t::free_node(const int32_t node) {
+    // an empty chunk never matches a stale handle_nodes_ entry
+    nodes_[node].size_ = 0;
+    free_nodes_.push_back(node);
+  }
+
+  void flattened_handles_t::index_rows(
+    const int32_t node, const int32_t first) {
+    const auto& n = nodes_[node];
+    for (int32_t row = first; row < n.size_; row++) {
+      const auto entity_handle = n.rows_[row].entity_handle_;
+      if (entity_handle.id_ < 0) {
+        continue;
+      }
+      if (entity_handle.id_ >= (int32_t)handle_nodes_.size()) {
+        handle_nodes_.resize(entity_handle.id_ + 1, -1);
+      }
+      handle_nodes_[entity_handle.id_] = node;
+    }
+  }
+
+  void flattened_handles_t::free_tree(const int32_t node) {
+    if (node == -1) {
+      return;
+    }
+    auto& nodes = node_stack_;
+    nodes.assign(1, node);
+    while (!nodes.empty()) {
+      const int32_t next = nodes.back();
+      nodes.pop_back();
+      if (nodes_[next].left_ != -1) {
+        nodes.push_back(nodes_[next].left_);
+      }
+      if (nodes_[next].right_ != -1) {
+        nodes.push_back(nodes_[next].right_);
+      }
+      free_node(next);
+    }
+  }
+
+  std::pair<int32_t, int32_t> flattened_handles_t::split(
+    const int32_t node, const int32_t index) {
+    if (node == -1) {
+      return {-1, -1};
+    }
+    const int32_t left_count = count(nodes_[node].left_);
+    const int32_t size = nodes_[node].size_;
+    std::pair<int32_t, int32_t> result;
+    if (index <= left_count) {
+      const auto [left, right] = split(nodes_[node].left_, index);
+      nodes_[node].left_ = right;
+      update(node);
+      result = {left, node};
+    } else if (index >= left_count + size) {
+      const auto [left, right] =
+        split(nodes_[node].right_, index - left_count - size);
+      nodes_[node].right_ = left;
+      update(node);
+      result = {node, right};
+    } else {
+      // split falls inside this chunk, move the tail to a new chunk
+      const int32_t offset = index - left_count;
+      const int32_t tail = allocate_node();
+      std::copy(
+        nodes_[node].rows_ + offset, nodes_[node].rows_ + size,
+        nodes_[tail].rows_);
+      nodes_[tail].size_ = size - offset;
+      index_rows(tail, 0);
+      update(tail);
+      nodes_[node].size_ = offset;
+      const int32_t right = nodes_[node].right_;
+      nodes_[node].right_ = -1;
+      update(node);
+      result = {node, merge(tail, right)};
+    }
+    if (result.first != -1) {
+      nodes_[result.first].parent_ = -1;
+    }
+    if (result.second != -1) {
+      nodes_[result.second].parent_ = -1;
+    }
+    return result;
+  }
+
+  int32_t flattened_handles_t::merge(const int32_t left, const int32_t right) {
+    if (left == -1) {
+      return right;
+    }
+    if (right == -1) {
+      return left;
+    }
+    if (nodes_[left].priority_ > nodes_[right].priority_) {
+      const int32_t merged = merge(nodes_[left].right_, right);
+      nodes_[left].right_ = merged;
+      update(left);
+      return left;
+    }
+    const int32_t merged = merge(left, nodes_[right].left_);
+    nodes_[right].left_ = merged;
+    update(right);
+    return right;
+  }
+
+  int32_t flattened_handles_t::join(int32_t left, int32_t right) {
+    if (left == -1 || right == -1) {
+      return merge(left, right);
+    }
+    int32_t last = left;
+    while (nodes_[last].right_ != -1) {
+      last = nodes_[last].right_;
+    }
+    int32_t first = right;
+    while (nodes_[first].left_ != -1) {
+      first = nodes_[first].left_;
+    }
+    const int32_t moved = nodes_[first].size_;
+    if (nodes_[last].size_ + moved <= chunk_capacity) {
+      // append the first chunk of right to the last chunk of left
+      std::copy(
+        nodes_[first].rows_, nodes_[first].rows_ + moved,
+        nodes_[last].rows_ + nodes_[last].size_);
+      nodes_[last].size_ += moved;
+      index_rows(last, nodes_[last].size_ - moved);
+      for (int32_t node = last; node != -1; node = nodes_[node].parent_) {
+        nodes_[node].count_ += moved;
+      }
+      // unlink the (now empty) first chunk, it has no left child
+      const int32_t parent = nodes_[first].parent_;
+      const int32_t child = nodes_[first].right_;
+      if (child != -1) {
+        nodes_[child].parent_ = parent;
+      }
+      if (parent == -1) {
+        right = child;
+      } else {
+        nodes_[parent].left_ = child;
+        for (int32_t node = parent; node != -1; node = nodes_[node].parent_) {
+          nodes_[node].count_ -= moved;
+        }
+      }
+      free_node(first);
+    }
+    const int32_t root = merge(left, right);
+    if (root != -1) {
+      nodes_[root].parent_ = -1;
+    }
+    return root;
+  }
+
+  int32_t flattened_handles_t::build(
+    const flattened_handle_t* first, const flattened_handle_t* last) {
+    // build a treap from consecutive chunks in linear time (cartesian tree)
+    auto& spine = spine_;
+    spine.clear();
+    for (; first != last;) {
+      const int32_t node = allocate_node();
+      const int32_t size =
+        (int32_t)std::min<std::ptrdiff_t>(chunk_capacity, last - first);
+      std::copy(first, first + size, nodes_[node].rows_);
+      nodes_[node].size_ = size;
+      index_rows(node, 0);
+      first += size;
+      int32_t popped = -1;
+      while (!spine.empty()
+             && nodes_[spine.back()].priority_ < nodes_[node].priority_) {
+        popped = spine.back();
+        spine.pop_back();
+      }
+      nodes_[node].left_ = popped;
+      if (!spine.empty()) {
+        nodes_[spine.back()].right_ = node;
+      }
+      spine.push_back(node);
+    }
+    if (spine.empty()) {
+      return -1;
+    }
+    // update counts children first (reverse pre-order)
+    auto& pre_order = pre_order_;
+    pre_order.clear();
+    auto& nodes = node_stack_;
+    nodes.assign(1, spine.front());
+    while (!nodes.empty()) {
+      const int32_t node = nodes.back();
+      nodes.pop_back();
+      pre_order.push_back(node);
+      if (nodes_[node].left_ != -1) {
+        nodes.push_back(nodes_[node].left_);
+      }
+      if (nodes_[node].right_ != -1) {
+        nodes.push_back(nodes_[node].right_);
+      }
+    }
+    for (auto it = pre_order.rbegin(); it != pre_order.rend(); ++it) {
+      update(*it);
+    }
+    nodes_[spine.front()].parent_ = -1;
+    return spine.front();
+  }
+
+  int32_t flattened_handles_t::find(
+    int32_t index, int32_t& node_begin) const {
+    assert(index >= 0 && index < size());
+    int32_t node = root_;
+    node_begin = 0;
+    while (true) {
+      const auto& n = nodes_[node];
+      const int32_t left_count = count(n.left_);
+      if (index < left_count) {
+        node = n.left_;
+      } else if (index < left_count + n.size_) {
+        node_begin += left_count;
+        return node;
+      } else {
+        node_begin += left_count + n.size_;
+        index -= left_count + n.size_;
+        node = n.right_;
+      }
+    }
+  }
+
+  int32_t flattened_handles_t::next_node(int32_t node) const {
+    if (nodes_[node].right_ != -1) {
+      node = nodes_[node].right_;
+      while (nodes_[node].left_ != -1) {
+        node = nodes_[node].left_;
+      }
+      return node;
+    }
+    while (nodes_[node].parent_ != -1
+           && nodes_[nodes_[node].parent_].right_ == node) {
+      node = nodes_[node].parent_;
+    }
+    return nodes_[node].parent_;
+  }
+
+  int32_t flattened_handles_t::prev_node(int32_t node) const {
+    if (nodes_[node].left_ != -1) {
+      node = nodes_[node].left_;
+      while (nodes_[node].right_ != -1) {
+        node = nodes_[node].right_;
+      }
+      return node;
+    }
+    while (nodes_[node].parent_ != -1
+           && nodes_[nodes_[node].parent_].left_ == node) {
+      node = nodes_[node].parent_;
+    }
+    return nodes_[node].parent_;
+  }
+
+  const flattened_handle_t& flattened_handles_t::locate(
+    const int32_t index, int32_t& node, int32_t& node_begin) const {
+    if (node != -1) {
+      if (index >= node_begin && index < node_begin + nodes_[node].size_) {
+        return nodes_[node].rows_[index - node_begin];
+      }
+      // step to a neighboring chunk when iterating sequentially
+      if (index == node_begin + nodes_[node].size_) {
+        if (const int32_t next = next_node(node); next != -1) {
+          node_begin += nodes_[node].size_;
+          node = next;
+          return nodes_[node].rows_[index - node_begin];
+        }
+      } else if (index == node_begin - 1) {
+        if (const int32_t prev = prev_node(node); prev != -1) {
+          node = prev;
+          node_begin -= nodes_[node].size_;
+          return nodes_[node].rows_[index - node_begin];
+        }
+      }
+    }
+    node = find(index, node_begin);
+    return nodes_[node].rows_[index - node_begin];
+  }
+} // namespace hy
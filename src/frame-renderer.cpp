@@ -0,0 +1,73 @@
+#include "hierarchy/frame-renderer.hpp"
+
+namespace hy {
+  void frame_renderer_t::split_rows(
+    const draw_commands_t& draw_commands, std::vector<row_t>& rows) {
+    rows.clear();
+    const auto& commands = draw_commands.commands();
+    bool bold = false;
+    bool invert = false;
+    for (int32_t c = 0; c < (int32_t)commands.size(); c++) {
+      const auto& command = commands[c];
+      switch (command.type_) {
+        case draw_command_t::type_e::glyph:
+          // a row starts with the first glyph drawn at its y position
+          if (rows.empty() || command.y_ >= (int32_t)rows.size()) {
+            rows.resize(command.y_ + 1, row_t{c, c, bold, invert});
+          }
+          break;
+        case draw_command_t::type_e::bold:
+          bold = command.enabled_;
+          break;
+        case draw_command_t::type_e::invert:
+          invert = command.enabled_;
+          break;
+        case draw_command_t::type_e::text:
+          break;
+      }
+      if (!rows.empty()) {
+        rows.back().end_ = c + 1;
+      }
+    }
+  }
+
+  bool frame_renderer_t::rows_equal(
+    const draw_commands_t& lhs_commands, const row_t& lhs,
+    const draw_commands_t& rhs_commands, const row_t& rhs) {
+    if (
+      lhs.end_ - lhs.begin_ != rhs.end_ - rhs.begin_ || lhs.bold_ != rhs.bold_
+      || lhs.invert_ != rhs.invert_) {
+      return false;
+    }
+    for (int32_t c = 0; c < lhs.end_ - lhs.begin_; c++) {
+      const auto& lhs_command = lhs_commands.commands()[lhs.begin_ + c];
+      const auto& rhs_command = rhs_commands.commands()[rhs.begin_ + c];
+      if (lhs_command.type_ != rhs_command.type_) {
+        return false;
+      }
+      switch (lhs_command.type_) {
+        case draw_command_t::type_e::glyph:
+          // y is ignored so rows compare equal when scrolled
+          if (
+            lhs_command.glyph_ != rhs_command.glyph_
+            || lhs_command.x_ != rhs_command.x_) {
+            return false;
+          }
+          break;
+        case draw_command_t::type_e::text:
+          if (
+            lhs_commands.text(lhs_command) != rhs_commands.text(rhs_command)) {
+            return false;
+          }
+          break;
+        case draw_command_t::type_e::bold:
+        case draw_command_t::type_e::invert:
+          if (lhs_command.enabled_ != rhs_command.enabled_) {
+            return false;
+          }
+          break;
+      }
+    }
+    return true;
+  }
+} // namespace hy
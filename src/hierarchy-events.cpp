@@ -0,0 +1,43 @@
+#include "hierarchy/hierarchy-events.hpp"
+
+#include <algorithm>
+
+namespace hy {
+  int32_t hierarchy_events_t::subscribe(hierarchy_listener_fn listener) {
+    const int32_t subscription = next_subscription_++;
+    listeners_.emplace_back(subscription, std::move(listener));
+    return subscription;
+  }
+
+  void hierarchy_events_t::unsubscribe(const int32_t subscription) {
+    listeners_.erase(
+      std::remove_if(
+        listeners_.begin(), listeners_.end(),
+        [subscription](const auto& listener) {
+          return listener.first == subscription;
+        }),
+      listeners_.end());
+  }
+
+  void hierarchy_events_t::publish(
+    const hierarchy_event_t& event, const int32_t source) const {
+    for (const auto& [subscription, listener] : listeners_) {
+      if (subscription != source) {
+        listener(event);
+      }
+    }
+  }
+
+  int32_t subscribe(
+    hierarchy_events_t& events, view_t& view,
+    const thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    const int32_t subscription = events.subscribe(
+      [&view, &entities, &collapser,
+       &root_handles](const hierarchy_event_t& event) {
+        view.apply(event, entities, collapser, root_handles);
+      });
+    view.publish_to(&events, subscription);
+    return subscription;
+  }
+} // namespace hy
@@ -0,0 +1,193 @@
+#include "hierarchy/importer.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace hy {
+  importer_t::importer_t(
+    const import_format_e format, thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles)
+    : format_(format), entities_(&entities), root_handles_(&root_handles) {
+  }
+
+  void importer_t::feed(std::string_view chunk) {
+    for (auto newline = chunk.find('\n'); newline != std::string_view::npos;
+         newline = chunk.find('\n')) {
+      if (partial_line_.empty()) {
+        // import directly from the chunk when the line is all here
+        import_line(chunk.substr(0, newline));
+      } else {
+        partial_line_.append(chunk.substr(0, newline));
+        import_line(partial_line_);
+        partial_line_.clear();
+      }
+      chunk.remove_prefix(newline + 1);
+    }
+    partial_line_.append(chunk);
+    flush();
+  }
+
+  void importer_t::finish() {
+    if (!partial_line_.empty()) {
+      import_line(partial_line_);
+      partial_line_.clear();
+    }
+    flush();
+  }
+
+  void importer_t::import_line(std::string_view line) {
+    line_count_++;
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    switch (format_) {
+      case import_format_e::indented:
+        import_indented(line);
+        break;
+      case import_format_e::paths:
+        import_path(line);
+        break;
+    }
+  }
+
+  void importer_t::import_indented(std::string_view line) {
+    const auto name_begin = line.find_first_not_of(" \t");
+    if (name_begin == std::string_view::npos) {
+      return;
+    }
+    const int indent = (int)name_begin;
+    line.remove_prefix(name_begin);
+    line = line.substr(0, line.find_last_not_of(" \t") + 1);
+    // siblings and their descendants are no longer ancestors
+    while (depth_ > 0 && ancestors_[depth_ - 1].indent_ >= indent) {
+      depth_--;
+    }
+    const auto batch_index = add_entity(line);
+    if (depth_ == ancestors_.size()) {
+      ancestors_.emplace_back();
+    }
+    ancestors_[depth_].batch_index_ = batch_index;
+    ancestors_[depth_].indent_ = indent;
+    depth_++;
+  }
+
+  void importer_t::import_path(std::string_view line) {
+    // blank lines (or only separators) don't end the shared prefix
+    if (line.find_first_not_of('/') == std::string_view::npos) {
+      return;
+    }
+    size_t level = 0;
+    bool shared = true; // components so far match the previous line
+    while (!line.empty()) {
+      const auto separator = line.find('/');
+      const auto component = line.substr(0, separator);
+      line.remove_prefix(
+        separator == std::string_view::npos ? line.size() : separator + 1);
+      if (component.empty()) {
+        continue;
+      }
+      if (shared && level < depth_ && ancestors_[level].name_ == component) {
+        level++;
+        continue;
+      }
+      shared = false;
+      depth_ = level;
+      const auto batch_index = add_entity(component);
+      if (depth_ == ancestors_.size()) {
+        ancestors_.emplace_back();
+      }
+      ancestors_[depth_].batch_index_ = batch_index;
+      ancestors_[depth_].name_.assign(component);
+      depth_++;
+      level++;
+    }
+    depth_ = level;
+  }
+
+  int32_t importer_t::add_entity(const std::string_view name) {
+    const auto batch_index = (int32_t)batch_parent_indices_.size();
+    int32_t parent_index = -1;
+    if (depth_ == 0) {
+      batch_parent_handles_.push_back(thh::handle_t());
+    } else if (const auto& parent = ancestors_[depth_ - 1];
+               parent.batch_index_ == -1) {
+      batch_parent_handles_.push_back(parent.handle_);
+    } else {
+      parent_index = parent.batch_index_;
+    }
+    batch_parent_indices_.push_back(parent_index);
+    batch_names_.emplace_back(name);
+    return batch_index;
+  }
+
+  void importer_t::flush() {
+    if (batch_parent_indices_.empty()) {
+      return;
+    }
+    batch_root_handles_.clear();
+    const auto handles = hy::add_entities(
+      batch_parent_indices_, batch_names_, *entities_, batch_root_handles_);
+    // entities without a parent in the batch are roots of the batch, link
+    // them to the earlier entity they belong to (or keep them as roots)
+    for (size_t index = 0; index < batch_root_handles_.size(); index++) {
+      const auto handle = batch_root_handles_[index];
+      const auto parent_handle = batch_parent_handles_[index];
+      int32_t sibling_index = 0;
+      if (parent_handle == thh::handle_t()) {
+        sibling_index = (int32_t)root_handles_->size();
+        root_handles_->push_back(handle);
+      } else {
+        entities_->call(parent_handle, [&](entity_t& parent) {
+          sibling_index = (int32_t)parent.children_.size();
+          parent.children_.push_back(handle);
+        });
+      }
+      entities_->call(handle, [&](entity_t& entity) {
+        entity.parent_ = parent_handle;
+        entity.sibling_index_ = sibling_index;
+      });
+    }
+    for (size_t level = 0; level < depth_; level++) {
+      if (auto& ancestor = ancestors_[level]; ancestor.batch_index_ != -1) {
+        ancestor.handle_ = handles[ancestor.batch_index_];
+        ancestor.batch_index_ = -1;
+      }
+    }
+    batch_parent_indices_.clear();
+    batch_names_.clear();
+    batch_parent_handles_.clear();
+  }
+
+  bool import_file(
+    const std::string& path, const import_format_e format,
+    thh::handle_vector_t<hy::entity_t>& entities,
+    std::vector<thh::handle_t>& root_handles) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return false;
+    }
+    file.seekg(0, std::ios::end);
+    const int64_t file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    importer_t importer(format, entities, root_handles);
+    std::vector<char> chunk(1 << 16);
+    for (bool first = true; file; first = false) {
+      file.read(chunk.data(), chunk.size());
+      const auto read = std::string_view(chunk.data(), file.gcount());
+      if (first && !read.empty() && file_size > 0) {
+        // expect the rest of the file to have lines of similar length
+        const int64_t line_count =
+          std::count(read.begin(), read.end(), '\n') + 1;
+        const int64_t estimated_line_count =
+          line_count * file_size / int64_t(read.size());
+        entities.reserve((int32_t)std::min<int64_t>(
+          entities.size() + estimated_line_count,
+          std::numeric_limits<int32_t>::max()));
+      }
+      importer.feed(read);
+    }
+    importer.finish();
+    return file.eof();
+  }
+} // namespace hy
@@ -0,0 +1,392 @@
+#include "hierarchy/journal.hpp"
+#include "hierarchy/hierarchy-events.hpp"
+
+#include <utility>
+
+namespace hy {
+  namespace {
+    thh::handle_t parent_of(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          entity_handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    }
+
+    int32_t sibling_index_of(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          entity_handle,
+          [](const entity_t& entity) { return entity.sibling_index_; })
+        .value_or(0);
+    }
+
+    // select entity_handle only if it is already visible (goto_entity would
+    // expand its ancestors otherwise)
+    void select(
+      const thh::handle_t entity_handle, view_t& view,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      collapser_t& collapser) {
+      if (view.flattened_handles().index_of(entity_handle).has_value()) {
+        view.goto_entity(entity_handle, entities, collapser);
+      }
+    }
+  } // namespace
+
+  int64_t journal_t::packed_entities_t::bytes() const {
+    return int64_t(handles_.size() * sizeof(thh::handle_t))
+         + int64_t(child_counts_.size() * sizeof(int32_t))
+         + int64_t(collapsed_.size() / 8)
+         + int64_t(name_offsets_.size() * sizeof(int64_t))
+         + int64_t(names_.size());
+  }
+
+  journal_t::journal_t(const int32_t max_entries, const int64_t max_bytes)
+    : max_entries_(max_entries), max_bytes_(max_bytes) {}
+
+  void journal_t::expand(
+    view_t& view, const thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    const auto handle = view.selected_handle();
+    const bool collapsed = collapser.collapsed(handle);
+    view.expand(entities, collapser);
+    if (collapsed && !collapser.collapsed(handle)) {
+      record(entry_t(edit_e::expand, handle));
+    }
+  }
+
+  void journal_t::collapse(
+    view_t& view, const thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    const auto handle = view.selected_handle();
+    const bool collapsed = collapser.collapsed(handle);
+    view.collapse(entities, collapser);
+    if (!collapsed && collapser.collapsed(handle)) {
+      record(entry_t(edit_e::collapse, handle));
+    }
+  }
+
+  std::optional<flattened_handle_position_t> journal_t::add_child(
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    const auto parent_handle = view.selected_handle();
+    const auto added = view.add_child(entities, collapser);
+    if (added.has_value()) {
+      const auto handle = added->flattened_handle_.entity_handle_;
+      record(entry_t(
+        edit_e::add, handle, parent_handle,
+        sibling_index_of(handle, entities)));
+    }
+    return added;
+  }
+
+  flattened_handle_position_t journal_t::add_sibling(
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, std::vector<thh::handle_t>& root_handles) {
+    const auto added = view.add_sibling(entities, collapser, root_handles);
+    const auto handle = added.flattened_handle_.entity_handle_;
+    record(entry_t(
+      edit_e::add, handle, parent_of(handle, entities),
+      sibling_index_of(handle, entities)));
+    return added;
+  }
+
+  void journal_t::remove(
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, std::vector<thh::handle_t>& root_handles) {
+    const auto handle = view.selected_handle();
+    if (handle == thh::handle_t()) {
+      return;
+    }
+    entry_t entry(
+      edit_e::remove, handle, parent_of(handle, entities),
+      sibling_index_of(handle, entities));
+    erase(handle, entry.packed_, view, entities, collapser, root_handles);
+    record(std::move(entry));
+  }
+
+  bool journal_t::move_selected_to(
+    const thh::handle_t parent_handle, view_t& view,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto handle = view.selected_handle();
+    const auto previous_parent_handle = parent_of(handle, entities);
+    const auto previous_sibling_index = sibling_index_of(handle, entities);
+    if (!view.move_selected_to(
+          parent_handle, entities, collapser, root_handles)) {
+      return false;
+    }
+    record(entry_t(
+      edit_e::move, handle, parent_handle, sibling_index_of(handle, entities),
+      previous_parent_handle, previous_sibling_index));
+    return true;
+  }
+
+  bool journal_t::undo(
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, std::vector<thh::handle_t>& root_handles) {
+    if (undo_.empty()) {
+      return false;
+    }
+    redo_.push_back(std::move(undo_.back()));
+    undo_.pop_back();
+    auto& entry = redo_.back();
+    const int64_t bytes = entry.packed_.bytes();
+    const auto selected = replay(
+      entry, false, view, entities, collapser, root_handles);
+    packed_bytes_ += entry.packed_.bytes() - bytes;
+    select(selected, view, entities, collapser);
+    return true;
+  }
+
+  bool journal_t::redo(
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, std::vector<thh::handle_t>& root_handles) {
+    if (redo_.empty()) {
+      return false;
+    }
+    undo_.push_back(std::move(redo_.back()));
+    redo_.pop_back();
+    auto& entry = undo_.back();
+    const int64_t bytes = entry.packed_.bytes();
+    const auto selected =
+      replay(entry, true, view, entities, collapser, root_handles);
+    packed_bytes_ += entry.packed_.bytes() - bytes;
+    select(selected, view, entities, collapser);
+    return true;
+  }
+
+  int journal_t::reclaim(
+    const int budget, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    return reclaimer_.reclaim(budget, entities, collapser);
+  }
+
+  void journal_t::clear() {
+    undo_.clear();
+    redo_.clear();
+    packed_bytes_ = 0;
+  }
+
+  void journal_t::record(entry_t entry) {
+    for (const auto& undone : redo_) {
+      packed_bytes_ -= undone.packed_.bytes();
+    }
+    redo_.clear();
+    const int64_t bytes = entry.packed_.bytes();
+    if (bytes > max_bytes_) {
+      // earlier entries can't be reached without undoing this one
+      clear();
+      return;
+    }
+    undo_.push_back(std::move(entry));
+    packed_bytes_ += bytes;
+    while ((int32_t)undo_.size() > max_entries_
+           || packed_bytes_ > max_bytes_) {
+      packed_bytes_ -= undo_.front().packed_.bytes();
+      undo_.pop_front();
+    }
+  }
+
+  void journal_t::erase(
+    const thh::handle_t entity_handle, packed_entities_t& packed,
+    view_t& view, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, std::vector<thh::handle_t>& root_handles) {
+    // entities are only packed once, they are the same each time the entry
+    // is replayed (restore updates the handles)
+    if (packed.size() == 0) {
+      pack(entity_handle, entities, collapser, packed);
+    }
+    const auto parent_handle = parent_of(entity_handle, entities);
+    unlink_entity(entity_handle, entities, root_handles);
+    view.notify(
+      hierarchy_event_t{
+        hierarchy_event_e::removed, entity_handle, parent_handle,
+        thh::handle_t()},
+      entities, collapser, root_handles);
+    reclaimer_.push(entity_handle);
+  }
+
+  thh::handle_t journal_t::restore(
+    packed_entities_t& packed, const thh::handle_t parent_handle,
+    const int32_t sibling_index, view_t& view,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    // parents still to receive children, the rows of the entities are counted
+    // as they are created so the view doesn't need to count them again
+    auto& parents = parent_stack_;
+    parents.clear();
+    int32_t visible_count = 0;
+    for (int32_t i = 0; i < packed.size(); i++) {
+      const auto handle = entities.add();
+      const auto child_count = packed.child_counts_[i];
+      const auto parent =
+        parents.empty() ? thh::handle_t() : parents.back().handle_;
+      const bool visible = parents.empty() || parents.back().children_visible_;
+      visible_count += visible ? 1 : 0;
+      int32_t index = 0;
+      entities.call(parent, [handle, &index](entity_t& entity) {
+        index = (int32_t)entity.children_.size();
+        entity.children_.push_back(handle);
+      });
+      entities.call(handle, [&](entity_t& entity) {
+        entity.name_ = packed.name(i);
+        entity.children_.reserve(child_count);
+        entity.parent_ = parent;
+        entity.sibling_index_ = index;
+      });
+
+      const auto previous_handle = packed.handles_[i];
+      if (previous_handle.id_ >= (int32_t)remapped_.size()) {
+        remapped_.resize(previous_handle.id_ + 1);
+      }
+      remapped_[previous_handle.id_] = remapped_t{previous_handle, handle};
+      packed.handles_[i] = handle;
+
+      if (!parents.empty()) {
+        parents.back().remaining_children_--;
+      }
+      if (child_count > 0) {
+        parents.push_back(restored_parent_t{
+          handle, child_count, visible && !packed.collapsed_[i]});
+      }
+      while (!parents.empty() && parents.back().remaining_children_ == 0) {
+        parents.pop_back();
+      }
+    }
+
+    // deepest first so each collapse counts rows already counted
+    for (int32_t i = packed.size() - 1; i >= 0; i--) {
+      if (packed.collapsed_[i]) {
+        collapser.collapse(packed.handles_[i], entities);
+      }
+    }
+
+    const auto handle = packed.handles_.front();
+    if (!collapser.collapsed(handle)) {
+      collapser.cache_expanded_count(handle, visible_count);
+    }
+    link_entity(handle, parent_handle, sibling_index, entities, root_handles);
+    view.notify(
+      hierarchy_event_t{
+        hierarchy_event_e::added, handle, parent_handle, thh::handle_t()},
+      entities, collapser, root_handles);
+    remap_entries();
+    return handle;
+  }
+
+  void journal_t::move(
+    const thh::handle_t entity_handle, const thh::handle_t parent_handle,
+    const int32_t sibling_index, view_t& view,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto previous_parent_handle = parent_of(entity_handle, entities);
+    unlink_entity(entity_handle, entities, root_handles);
+    link_entity(
+      entity_handle, parent_handle, sibling_index, entities, root_handles);
+    view.notify(
+      hierarchy_event_t{
+        hierarchy_event_e::moved, entity_handle, parent_handle,
+        previous_parent_handle},
+      entities, collapser, root_handles);
+  }
+
+  thh::handle_t journal_t::replay(
+    entry_t& entry, const bool forward, view_t& view,
+    thh::handle_vector_t<hy::entity_t>& entities, collapser_t& collapser,
+    std::vector<thh::handle_t>& root_handles) {
+    const auto expand = [&](const bool expand) {
+      // the entity is visible unless its ancestors were collapsed some other
+      // way, its rows are then hidden anyway
+      if (view.flattened_handles().index_of(entry.entity_handle_)) {
+        view.goto_entity(entry.entity_handle_, entities, collapser);
+        expand ? view.expand(entities, collapser)
+               : view.collapse(entities, collapser);
+      } else {
+        expand ? collapser.expand(entry.entity_handle_, entities)
+               : collapser.collapse(entry.entity_handle_, entities);
+      }
+      return entry.entity_handle_;
+    };
+    const auto restore = [&] {
+      entry.entity_handle_ = this->restore(
+        entry.packed_, entry.parent_handle_, entry.sibling_index_, view,
+        entities, collapser, root_handles);
+      return entry.entity_handle_;
+    };
+    const auto erase = [&] {
+      this->erase(
+        entry.entity_handle_, entry.packed_, view, entities, collapser,
+        root_handles);
+      return entry.parent_handle_;
+    };
+
+    switch (entry.edit_) {
+      case edit_e::expand:
+        return expand(forward);
+      case edit_e::collapse:
+        return expand(!forward);
+      case edit_e::add:
+        return forward ? restore() : erase();
+      case edit_e::remove:
+        return forward ? erase() : restore();
+      case edit_e::move:
+        if (forward) {
+          move(
+            entry.entity_handle_, entry.parent_handle_, entry.sibling_index_,
+            view, entities, collapser, root_handles);
+        } else {
+          move(
+            entry.entity_handle_, entry.previous_parent_handle_,
+            entry.previous_sibling_index_, view, entities, collapser,
+            root_handles);
+        }
+        return entry.entity_handle_;
+    }
+    return thh::handle_t();
+  }
+
+  void journal_t::pack(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser, packed_entities_t& packed) {
+    auto& handles = handle_stack_;
+    handles.assign(1, entity_handle);
+    while (!handles.empty()) {
+      const auto handle = handles.back();
+      handles.pop_back();
+      entities.call(handle, [&](const entity_t& entity) {
+        packed.handles_.push_back(handle);
+        packed.child_counts_.push_back((int32_t)entity.children_.size());
+        packed.collapsed_.push_back(collapser.collapsed(handle));
+        packed.names_.append(entity.name_);
+        packed.name_offsets_.push_back((int64_t)packed.names_.size());
+        handles.insert(
+          handles.end(), entity.children_.rbegin(), entity.children_.rend());
+      });
+    }
+  }
+
+  void journal_t::remap_entries() {
+    const auto remap = [this](thh::handle_t& handle) {
+      if (handle.id_ >= 0 && handle.id_ < (int32_t)remapped_.size()
+          && remapped_[handle.id_].from_ == handle) {
+        handle = remapped_[handle.id_].to_;
+      }
+    };
+    const auto remap_entry = [&remap](entry_t& entry) {
+      remap(entry.entity_handle_);
+      remap(entry.parent_handle_);
+      remap(entry.previous_parent_handle_);
+    };
+    for (auto& entry : undo_) {
+      remap_entry(entry);
+    }
+    for (auto& entry : redo_) {
+      remap_entry(entry);
+    }
+  }
+} // namespace hy
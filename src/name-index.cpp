@@ -0,0 +1,338 @@
+#include "hierarchy/name-index.hpp"
+
+#include <algorithm>
+
+namespace hy {
+  namespace {
+    // ascii only (std::tolower depends on the locale and is much slower)
+    char lower(const char c) {
+      return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+    }
+
+    // unique trigrams of name (lower case), sorted
+    void find_trigrams(
+      const std::string_view name, std::vector<uint32_t>& trigrams) {
+      trigrams.clear();
+      for (size_t i = 0; i + 3 <= name.size(); i++) {
+        trigrams.push_back(
+          uint32_t((unsigned char)lower(name[i])) << 16
+          | uint32_t((unsigned char)lower(name[i + 1])) << 8
+          | uint32_t((unsigned char)lower(name[i + 2])));
+      }
+      std::sort(trigrams.begin(), trigrams.end());
+      trigrams.erase(
+        std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    }
+
+    bool contains(const std::string_view name, const uint32_t trigram) {
+      const char query[3] = {
+        char(trigram >> 16), char(trigram >> 8), char(trigram)};
+      return name_contains(name, std::string_view(query, 3));
+    }
+
+    bool handle_less(const thh::handle_t lhs, const thh::handle_t rhs) {
+      return lhs.id_ < rhs.id_ || (lhs.id_ == rhs.id_ && lhs.gen_ < rhs.gen_);
+    }
+
+    const pooled_name_t* entity_name(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          entity_handle, [](const entity_t& entity) { return &entity.name_; })
+        .value_or(nullptr);
+    }
+  } // namespace
+
+  bool name_contains(
+    const std::string_view name, const std::string_view query) {
+    return std::search(
+             name.begin(), name.end(), query.begin(), query.end(),
+             [](const char lhs, const char rhs) {
+               return lower(lhs) == lower(rhs);
+             })
+        != name.end();
+  }
+
+  void name_index_t::add(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    const auto* name = entity_name(entity_handle, entities);
+    if (name == nullptr) {
+      return;
+    }
+    if (indexed_name(entity_handle) != nullptr) {
+      update(entity_handle, entities);
+      return;
+    }
+    if (entity_handle.id_ >= (int32_t)indexed_.size()) {
+      indexed_.resize(entity_handle.id_ + 1);
+    }
+    indexed_[entity_handle.id_] = indexed_t{entity_handle, *name};
+    all_.handles_.push_back(entity_handle);
+    find_trigrams(*name, name_trigrams_);
+    for (const auto trigram : name_trigrams_) {
+      trigrams_[trigram].handles_.push_back(entity_handle);
+    }
+  }
+
+  void name_index_t::add_subtree(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    for (const auto handle : hy::entity_and_descendants(
+           entity_handle, entities, traversal_context_)) {
+      add(handle, entities);
+    }
+  }
+
+  void name_index_t::remove(const thh::handle_t entity_handle) {
+    if (indexed_name(entity_handle) == nullptr) {
+      return;
+    }
+    // the entity is no longer indexed so compacting drops its entries
+    const auto name = std::move(indexed_[entity_handle.id_].name_);
+    indexed_[entity_handle.id_] = indexed_t{};
+    mark_stale(all_, std::nullopt);
+    find_trigrams(name, name_trigrams_);
+    for (const auto trigram : name_trigrams_) {
+      if (auto entries = trigrams_.find(trigram); entries != trigrams_.end()) {
+        mark_stale(entries->second, trigram);
+        if (entries->second.handles_.empty()) {
+          trigrams_.erase(entries);
+        }
+      }
+    }
+  }
+
+  void name_index_t::remove_subtree(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    for (const auto handle : hy::entity_and_descendants(
+           entity_handle, entities, traversal_context_)) {
+      remove(handle);
+    }
+  }
+
+  void name_index_t::update(
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    const auto* name = entity_name(entity_handle, entities);
+    if (name == nullptr || indexed_name(entity_handle) == nullptr) {
+      return;
+    }
+    auto& indexed = indexed_[entity_handle.id_];
+    if (indexed.name_.id() == name->id()) {
+      return;
+    }
+    find_trigrams(indexed.name_, previous_trigrams_);
+    find_trigrams(*name, name_trigrams_);
+    indexed.name_ = *name;
+
+    // entries for trigrams in both names are kept as they are
+    for (const auto trigram : previous_trigrams_) {
+      if (std::binary_search(
+            name_trigrams_.begin(), name_trigrams_.end(), trigram)) {
+        continue;
+      }
+      if (auto entries = trigrams_.find(trigram); entries != trigrams_.end()) {
+        mark_stale(entries->second, trigram);
+        if (entries->second.handles_.empty()) {
+          trigrams_.erase(entries);
+        }
+      }
+    }
+    for (const auto trigram : name_trigrams_) {
+      if (!std::binary_search(
+            previous_trigrams_.begin(), previous_trigrams_.end(), trigram)) {
+        trigrams_[trigram].handles_.push_back(entity_handle);
+      }
+    }
+  }
+
+  void name_index_t::clear() {
+    trigrams_.clear();
+    all_ = entries_t{};
+    indexed_.clear();
+  }
+
+  std::vector<thh::handle_t> name_index_t::find(
+    const std::string_view query,
+    const thh::handle_vector_t<hy::entity_t>& entities) const {
+    std::vector<thh::handle_t> matches;
+    if (query.empty()) {
+      return matches;
+    }
+
+    // candidates come from the shortest list, any missing trigram means
+    // there are no matches
+    const entries_t* candidates = &all_;
+    std::vector<uint32_t> query_trigrams;
+    find_trigrams(query, query_trigrams);
+    for (const auto trigram : query_trigrams) {
+      const auto entries = trigrams_.find(trigram);
+      if (entries == trigrams_.end()) {
+        return matches;
+      }
+      if (entries->second.handles_.size() < candidates->handles_.size()) {
+        candidates = &entries->second;
+      }
+    }
+
+    for (const auto handle : candidates->handles_) {
+      // entities removed without telling the index are skipped
+      if (const auto* name = indexed_name(handle);
+          name != nullptr && entities.has_handle(handle)
+          && name_contains(*name, query)) {
+        matches.push_back(handle);
+      }
+    }
+    // a renamed entity can be listed more than once until compacted
+    std::sort(matches.begin(), matches.end(), handle_less);
+    matches.erase(
+      std::unique(matches.begin(), matches.end()), matches.end());
+    return matches;
+  }
+
+  int64_t name_index_t::entry_count() const {
+    int64_t count = (int64_t)all_.handles_.size();
+    for (const auto& [trigram, entries] : trigrams_) {
+      count += (int64_t)entries.handles_.size();
+    }
+    return count;
+  }
+
+  const pooled_name_t* name_index_t::indexed_name(
+    const thh::handle_t entity_handle) const {
+    if (
+      entity_handle.id_ < 0 || entity_handle.id_ >= (int32_t)indexed_.size()
+      || indexed_[entity_handle.id_].handle_ != entity_handle) {
+      return nullptr;
+    }
+    return &indexed_[entity_handle.id_].name_;
+  }
+
+  void name_index_t::mark_stale(
+    entries_t& entries, const std::optional<uint32_t> trigram) {
+    entries.stale_++;
+    if (entries.stale_ * 2 < (int32_t)entries.handles_.size()) {
+      return;
+    }
+    // keep entries for entities that are still indexed with the trigram
+    auto& handles = entries.handles_;
+    handles.erase(
+      std::remove_if(
+        handles.begin(), handles.end(),
+        [&](const thh::handle_t handle) {
+          const auto* name = indexed_name(handle);
+          return name == nullptr
+              || (trigram.has_value() && !contains(*name, *trigram));
+        }),
+      handles.end());
+    std::sort(handles.begin(), handles.end(), handle_less);
+    handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+    entries.stale_ = 0;
+  }
+
+  int32_t subscribe(
+    hierarchy_events_t& events, name_index_t& name_index,
+    const thh::handle_vector_t<hy::entity_t>& entities) {
+    return events.subscribe(
+      [&name_index, &entities](const hierarchy_event_t& event) {
+        switch (event.type_) {
+          case hierarchy_event_e::added:
+            // restored entities bring their descendants
+            name_index.add_subtree(event.entity_handle_, entities);
+            break;
+          case hierarchy_event_e::removed:
+            // descendants are still valid (even if reclaimed later)
+            name_index.remove_subtree(event.entity_handle_, entities);
+            break;
+          case hierarchy_event_e::renamed:
+            name_index.update(event.entity_handle_, entities);
+            break;
+          case hierarchy_event_e::moved:
+            // names are unchanged
+            break;
+        }
+      });
+  }
+
+  namespace {
+    // sibling positions from the root down to entity_handle, empty if the
+    // handle is invalid
+    void display_path(
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles,
+      std::vector<int32_t>& path) {
+      path.clear();
+      for (auto handle = entity_handle; handle != thh::handle_t();) {
+        const auto index = sibling_index(
+          handle, sibling_handles(handle, entities, root_handles), entities);
+        if (!index.has_value()) {
+          path.clear();
+          return;
+        }
+        path.push_back(*index);
+        handle = entities
+                   .call_return(
+                     handle,
+                     [](const entity_t& entity) { return entity.parent_; })
+                   .value_or(thh::handle_t());
+      }
+      std::reverse(path.begin(), path.end());
+    }
+
+    std::optional<thh::handle_t> adjacent_match(
+      const std::vector<thh::handle_t>& matches,
+      const thh::handle_t entity_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles, const bool forward) {
+      // paths compare lexicographically in display order
+      const auto before = [forward](const auto& lhs, const auto& rhs) {
+        return forward ? lhs < rhs : rhs < lhs;
+      };
+      std::vector<int32_t> position;
+      display_path(entity_handle, entities, root_handles, position);
+      // closest match past position, and the first match for wrapping around
+      std::optional<thh::handle_t> adjacent;
+      std::optional<thh::handle_t> first;
+      std::vector<int32_t> adjacent_path;
+      std::vector<int32_t> first_path;
+      std::vector<int32_t> path;
+      for (const auto match : matches) {
+        display_path(match, entities, root_handles, path);
+        if (path.empty()) {
+          continue;
+        }
+        const bool past = position.empty() || before(position, path);
+        if (past && (!adjacent.has_value() || before(path, adjacent_path))) {
+          adjacent = match;
+          adjacent_path = path;
+        }
+        if (!first.has_value() || before(path, first_path)) {
+          first = match;
+          first_path = path;
+        }
+      }
+      return adjacent.has_value() ? adjacent : first;
+    }
+  } // namespace
+
+  std::optional<thh::handle_t> next_match(
+    const std::vector<thh::handle_t>& matches,
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    return adjacent_match(matches, entity_handle, entities, root_handles, true);
+  }
+
+  std::optional<thh::handle_t> previous_match(
+    const std::vector<thh::handle_t>& matches,
+    const thh::handle_t entity_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles) {
+    return adjacent_match(
+      matches, entity_handle, entities, root_handles, false);
+  }
+} // namespace hy
@@ -0,0 +1,227 @@
+#include "hierarchy/name-pool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+namespace hy {
+  namespace {
+    constexpr name_id_t tombstone_name_id = -2;
+    // compact once released bytes exceed both this and half the buffer
+    constexpr int32_t min_compact_bytes = 4096;
+
+    uint32_t hash_name(const std::string_view name) {
+      return (uint32_t)std::hash<std::string_view>{}(name);
+    }
+  } // namespace
+
+  name_id_t name_pool_t::intern(const std::string_view name) {
+    const uint32_t hash = hash_name(name);
+    if (const name_id_t id = find(name, hash); id != null_name_id) {
+      entries_[id].refs_++;
+      return id;
+    }
+
+    // keep load factor (including tombstones) below 1/2, this happens before
+    // the new entry is added so a rehash doesn't insert it twice
+    if ((lookup_used_ + 1) * 2 > (int32_t)lookup_.size()) {
+      // only grow if most of the used slots are live (not tombstones)
+      rehash_lookup(
+        (size_ + 1) * 4 > (int32_t)lookup_.size()
+          ? std::max<size_t>(16, lookup_.size() * 2)
+          : lookup_.size());
+    }
+
+    name_id_t id;
+    if (!free_ids_.empty()) {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+    } else {
+      id = (name_id_t)entries_.size();
+      entries_.push_back({});
+    }
+
+    entries_[id] =
+      entry_t{(int32_t)buffer_.size(), (int32_t)name.size(), 1, hash};
+    buffer_.append(name);
+    size_++;
+    insert_lookup(id);
+    return id;
+  }
+
+  void name_pool_t::release(const name_id_t id) {
+    if (id < 0 || id >= (name_id_t)entries_.size()) {
+      return;
+    }
+    auto& entry = entries_[id];
+    // already released (a double release or a freed id)
+    if (entry.refs_ == 0) {
+      return;
+    }
+    if (--entry.refs_ > 0) {
+      return;
+    }
+    erase_lookup(id);
+    released_bytes_ += entry.length_;
+    entry = entry_t{};
+    free_ids_.push_back(id);
+    size_--;
+    if (
+      released_bytes_ > min_compact_bytes
+      && released_bytes_ > (int32_t)buffer_.size() / 2) {
+      compact();
+    }
+  }
+
+  name_id_t name_pool_t::rename(
+    const name_id_t id, const std::string_view name) {
+    // intern first so renaming to the same name doesn't drop the storage
+    const name_id_t renamed = intern(name);
+    release(id);
+    return renamed;
+  }
+
+  void name_pool_t::retain(const name_id_t id) {
+    if (id >= 0 && id < (name_id_t)entries_.size() && entries_[id].refs_ > 0) {
+      entries_[id].refs_++;
+    }
+  }
+
+  std::string_view name_pool_t::name(const name_id_t id) const {
+    if (id < 0 || id >= (name_id_t)entries_.size()) {
+      return {};
+    }
+    const auto& entry = entries_[id];
+    return std::string_view(buffer_.data() + entry.offset_, entry.length_);
+  }
+
+  void name_pool_t::reserve(
+    const int32_t name_count, const int32_t buffer_size) {
+    entries_.reserve(name_count);
+    buffer_.reserve(buffer_size);
+    if ((int32_t)lookup_.size() < name_count * 2) {
+      size_t capacity = std::max<size_t>(16, lookup_.size());
+      while (capacity < (size_t)name_count * 2) {
+        capacity *= 2;
+      }
+      rehash_lookup(capacity);
+    }
+  }
+
+  name_id_t name_pool_t::find(
+    const std::string_view name, const uint32_t hash) const {
+    if (lookup_.empty()) {
+      return null_name_id;
+    }
+    const size_t mask = lookup_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+      const auto& slot = lookup_[index];
+      if (slot.id_ == null_name_id) {
+        return null_name_id;
+      }
+      if (
+        slot.id_ != tombstone_name_id && slot.hash_ == hash
+        && this->name(slot.id_) == name) {
+        return slot.id_;
+      }
+    }
+  }
+
+  void name_pool_t::insert_lookup(const name_id_t id) {
+    const uint32_t hash = entries_[id].hash_;
+    const size_t mask = lookup_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+      auto& slot = lookup_[index];
+      if (slot.id_ == null_name_id || slot.id_ == tombstone_name_id) {
+        lookup_used_ += slot.id_ == null_name_id ? 1 : 0;
+        slot = lookup_slot_t{id, hash};
+        return;
+      }
+    }
+  }
+
+  void name_pool_t::erase_lookup(const name_id_t id) {
+    const size_t mask = lookup_.size() - 1;
+    for (size_t index = entries_[id].hash_ & mask;;
+         index = (index + 1) & mask) {
+      if (lookup_[index].id_ == id) {
+        lookup_[index].id_ = tombstone_name_id;
+        return;
+      }
+      if (lookup_[index].id_ == null_name_id) {
+        return;
+      }
+    }
+  }
+
+  void name_pool_t::rehash_lookup(const size_t capacity) {
+    // rehash live ids only, dropping tombstones
+    lookup_.assign(capacity, lookup_slot_t{null_name_id, 0});
+    lookup_used_ = 0;
+    for (name_id_t id = 0; id < (name_id_t)entries_.size(); ++id) {
+      if (entries_[id].refs_ > 0) {
+        insert_lookup(id);
+      }
+    }
+  }
+
+  void name_pool_t::compact() {
+    // ids are stable, only offsets into the buffer change
+    std::string buffer;
+    buffer.reserve(buffer_.size() - released_bytes_);
+    for (auto& entry : entries_) {
+      if (entry.refs_ == 0) {
+        continue;
+      }
+      const int32_t offset = (int32_t)buffer.size();
+      buffer.append(buffer_, entry.offset_, entry.length_);
+      entry.offset_ = offset;
+    }
+    buffer_ = std::move(buffer);
+    released_bytes_ = 0;
+  }
+
+  name_pool_t& entity_names() {
+    // never destroyed so entities outliving it (e.g. statics) can release
+    // their names
+    static name_pool_t* names = new name_pool_t();
+    return *names;
+  }
+
+  pooled_name_t::pooled_name_t(const std::string_view name)
+    : id_(entity_names().intern(name)) {}
+
+  pooled_name_t::pooled_name_t(const pooled_name_t& name) : id_(name.id_) {
+    entity_names().retain(id_);
+  }
+
+  pooled_name_t::pooled_name_t(pooled_name_t&& name) noexcept
+    : id_(std::exchange(name.id_, null_name_id)) {}
+
+  pooled_name_t& pooled_name_t::operator=(const pooled_name_t& name) {
+    if (id_ != name.id_) {
+      entity_names().retain(name.id_);
+      entity_names().release(id_);
+      id_ = name.id_;
+    }
+    return *this;
+  }
+
+  pooled_name_t& pooled_name_t::operator=(pooled_name_t&& name) noexcept {
+    if (this != &name) {
+      entity_names().release(id_);
+      id_ = std::exchange(name.id_, null_name_id);
+    }
+    return *this;
+  }
+
+  pooled_name_t& pooled_name_t::operator=(const std::string_view name) {
+    id_ = id_ == null_name_id ? entity_names().intern(name)
+                              : entity_names().rename(id_, name);
+    return *this;
+  }
+
+  pooled_name_t::~pooled_name_t() {
+    entity_names().release(id_);
+  }
+} // namespace hy
@@ -0,0 +1,342 @@
+#include "hierarchy/snapshot.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hy {
+  namespace {
+    // layout: header, int32_t arrays (see snapshot_array_e), one byte per
+    // entity for collapse state, then names
+    struct snapshot_header_t {
+      char magic_[8];
+      uint32_t version_;
+      int32_t entity_count_;
+      int32_t root_count_;
+      int32_t names_size_;
+    };
+
+    constexpr char snapshot_magic[8] = {'H', 'Y', 'S', 'N', 'A', 'P', 0, 0};
+    constexpr uint32_t snapshot_version = 1;
+
+    // int32_t arrays following the header (name offsets has one extra entry)
+    enum snapshot_array_e {
+      parent_array,
+      first_child_array,
+      child_count_array,
+      name_offset_array,
+      array_count
+    };
+
+    size_t collapsed_offset(const int32_t entity_count) {
+      return sizeof(snapshot_header_t)
+           + sizeof(int32_t) * (size_t(entity_count) * array_count + 1);
+    }
+
+    size_t names_offset(const int32_t entity_count) {
+      return collapsed_offset(entity_count) + size_t(entity_count);
+    }
+
+    const snapshot_header_t* header(const std::byte* data) {
+      return reinterpret_cast<const snapshot_header_t*>(data);
+    }
+
+    const int32_t* array(
+      const std::byte* data, const snapshot_array_e array_index) {
+      return reinterpret_cast<const int32_t*>(data + sizeof(snapshot_header_t))
+           + size_t(header(data)->entity_count_) * array_index;
+    }
+
+    // check every index and offset is in range so reading the snapshot can't
+    // go out of bounds, roots have no parent, every other entity comes after
+    // its parent (so there are no cycles) and is only in its parent's child
+    // range
+    bool valid_arrays(const std::byte* data) {
+      const int32_t entity_count = header(data)->entity_count_;
+      const int32_t root_count = header(data)->root_count_;
+      const int32_t* parents = array(data, parent_array);
+      const int32_t* first_children = array(data, first_child_array);
+      const int32_t* child_counts = array(data, child_count_array);
+      const int32_t* name_offsets = array(data, name_offset_array);
+      for (int32_t index = 0; index < entity_count; index++) {
+        const int32_t first_child = first_children[index];
+        const int32_t child_count = child_counts[index];
+        if (
+          first_child < 0 || child_count < 0
+          || int64_t(first_child) + child_count > entity_count) {
+          return false;
+        }
+        // each child must name this entity as its parent (so child ranges
+        // don't overlap), checks stop at the first mismatch so every entity
+        // is checked at most once
+        for (int32_t child = first_child; child < first_child + child_count;
+             child++) {
+          if (parents[child] != index) {
+            return false;
+          }
+        }
+        if (index < root_count) {
+          if (parents[index] != -1) {
+            return false;
+          }
+          continue;
+        }
+        const int32_t parent = parents[index];
+        if (
+          parent < 0 || parent >= index || index < first_children[parent]
+          || index >= first_children[parent] + child_counts[parent]) {
+          return false;
+        }
+      }
+      if (name_offsets[0] < 0) {
+        return false;
+      }
+      for (int32_t index = 0; index < entity_count; index++) {
+        if (name_offsets[index + 1] < name_offsets[index]) {
+          return false;
+        }
+      }
+      return name_offsets[entity_count] <= header(data)->names_size_;
+    }
+  } // namespace
+
+  bool save_snapshot(
+    const std::string& path, const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles,
+    const collapser_t& collapser) {
+    // breadth first order, the children of handles[i] are appended together
+    std::vector<thh::handle_t> handles(root_handles);
+    std::vector<int32_t> parents(root_handles.size(), -1);
+    std::vector<int32_t> first_children;
+    std::vector<int32_t> child_counts;
+    std::vector<int32_t> name_offsets;
+    std::vector<uint8_t> collapsed;
+    std::string names;
+    for (size_t index = 0; index < handles.size(); index++) {
+      const auto handle = handles[index];
+      first_children.push_back((int32_t)handles.size());
+      name_offsets.push_back((int32_t)names.size());
+      collapsed.push_back(collapser.collapsed(handle));
+      int32_t child_count = 0;
+      entities.call(handle, [&](const entity_t& entity) {
+        names.append(entity.name_);
+        for (const auto child_handle : entity.children_) {
+          handles.push_back(child_handle);
+          parents.push_back((int32_t)index);
+        }
+        child_count = (int32_t)entity.children_.size();
+      });
+      child_counts.push_back(child_count);
+    }
+    name_offsets.push_back((int32_t)names.size());
+
+    snapshot_header_t header{};
+    std::memcpy(header.magic_, snapshot_magic, sizeof snapshot_magic);
+    header.version_ = snapshot_version;
+    header.entity_count_ = (int32_t)handles.size();
+    header.root_count_ = (int32_t)root_handles.size();
+    header.names_size_ = (int32_t)names.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    const auto write = [&file](const void* data, const size_t size) {
+      file.write(static_cast<const char*>(data), size);
+    };
+    write(&header, sizeof header);
+    write(parents.data(), parents.size() * sizeof(int32_t));
+    write(first_children.data(), first_children.size() * sizeof(int32_t));
+    write(child_counts.data(), child_counts.size() * sizeof(int32_t));
+    write(name_offsets.data(), name_offsets.size() * sizeof(int32_t));
+    write(collapsed.data(), collapsed.size());
+    write(names.data(), names.size());
+    return file.good();
+  }
+
+  snapshot_t::snapshot_t(snapshot_t&& snapshot) noexcept {
+    *this = std::move(snapshot);
+  }
+
+  snapshot_t& snapshot_t::operator=(snapshot_t&& snapshot) noexcept {
+    if (this != &snapshot) {
+      close();
+      data_ = std::exchange(snapshot.data_, nullptr);
+      size_ = std::exchange(snapshot.size_, 0);
+#ifdef _WIN32
+      file_ = std::exchange(snapshot.file_, nullptr);
+      mapping_ = std::exchange(snapshot.mapping_, nullptr);
+#endif
+    }
+    return *this;
+  }
+
+  snapshot_t::~snapshot_t() {
+    close();
+  }
+
+  bool snapshot_t::open(const std::string& path) {
+    close();
+#ifdef _WIN32
+    file_ = CreateFileA(
+      path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+      file_ = nullptr;
+      return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_, &file_size) || file_size.QuadPart == 0) {
+      close();
+      return false;
+    }
+    mapping_ =
+      CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+      close();
+      return false;
+    }
+    data_ = static_cast<const std::byte*>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+      close();
+      return false;
+    }
+    size_ = size_t(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+      ::close(fd);
+      return false;
+    }
+    void* data =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping remains valid after the file is closed
+    ::close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    data_ = static_cast<const std::byte*>(data);
+    size_ = size_t(file_stat.st_size);
+#endif
+    const snapshot_header_t* snapshot_header = header(data_);
+    if (
+      size_ < sizeof(snapshot_header_t)
+      || std::memcmp(
+           snapshot_header->magic_, snapshot_magic, sizeof snapshot_magic)
+           != 0
+      || snapshot_header->version_ != snapshot_version
+      || snapshot_header->entity_count_ < 0
+      || snapshot_header->root_count_ < 0
+      || snapshot_header->root_count_ > snapshot_header->entity_count_
+      || snapshot_header->names_size_ < 0
+      || size_ < names_offset(snapshot_header->entity_count_)
+                   + size_t(snapshot_header->names_size_)
+      || !valid_arrays(data_)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void snapshot_t::close() {
+#ifdef _WIN32
+    if (data_ != nullptr) {
+      UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    if (file_ != nullptr) {
+      CloseHandle(file_);
+    }
+    file_ = nullptr;
+    mapping_ = nullptr;
+#else
+    if (data_ != nullptr) {
+      munmap(const_cast<std::byte*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  int32_t snapshot_t::entity_count() const {
+    return data_ != nullptr ? header(data_)->entity_count_ : 0;
+  }
+
+  int32_t snapshot_t::root_count() const {
+    return data_ != nullptr ? header(data_)->root_count_ : 0;
+  }
+
+  std::string_view snapshot_t::name(const int32_t index) const {
+    const int32_t* name_offsets = array(data_, name_offset_array);
+    const auto* names = reinterpret_cast<const char*>(
+      data_ + names_offset(header(data_)->entity_count_));
+    return std::string_view(
+      names + name_offsets[index],
+      name_offsets[index + 1] - name_offsets[index]);
+  }
+
+  int32_t snapshot_t::parent(const int32_t index) const {
+    return array(data_, parent_array)[index];
+  }
+
+  int32_t snapshot_t::first_child(const int32_t index) const {
+    return array(data_, first_child_array)[index];
+  }
+
+  int32_t snapshot_t::child_count(const int32_t index) const {
+    return array(data_, child_count_array)[index];
+  }
+
+  bool snapshot_t::collapsed(const int32_t index) const {
+    return data_[collapsed_offset(header(data_)->entity_count_) + index]
+        != std::byte(0);
+  }
+
+  std::vector<thh::handle_t> load_snapshot(
+    const snapshot_t& snapshot, thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser) {
+    const int32_t entity_count = snapshot.entity_count();
+    std::vector<thh::handle_t> handles;
+    handles.reserve(entity_count);
+    for (int32_t index = 0; index < entity_count; index++) {
+      handles.push_back(entities.add());
+    }
+    for (int32_t index = 0; index < entity_count; index++) {
+      entities.call(handles[index], [&](entity_t& entity) {
+        entity.name_ = std::string(snapshot.name(index));
+        if (const int32_t parent = snapshot.parent(index); parent != -1) {
+          entity.parent_ = handles[parent];
+          entity.sibling_index_ = index - snapshot.first_child(parent);
+        } else {
+          entity.sibling_index_ = index;
+        }
+        const int32_t first_child = snapshot.first_child(index);
+        entity.children_.assign(
+          handles.begin() + first_child,
+          handles.begin() + first_child + snapshot.child_count(index));
+      });
+    }
+    for (int32_t index = 0; index < entity_count; index++) {
+      if (snapshot.collapsed(index)) {
+        collapser.collapse(handles[index], entities);
+      }
+    }
+    return std::vector<thh::handle_t>(
+      handles.begin(), handles.begin() + snapshot.root_count());
+  }
+} // namespace hy
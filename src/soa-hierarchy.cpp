@@ -0,0 +1,321 @@
+#include "hierarchy/soa-hierarchy.hpp"
+
+#include <charconv>
+
+namespace hy {
+  namespace {
+    // pre-order walk of the subtree rooted at slot, fn is passed each slot
+    // and its depth relative to slot, descend decides if children are visited
+    template<typename Fn, typename Descend>
+    void walk(
+      const soa_hierarchy_t& hierarchy, const int32_t slot, Fn&& fn,
+      Descend&& descend) {
+      int32_t current = slot;
+      int depth = 0;
+      fn(current, depth);
+      while (true) {
+        if (hierarchy.child_count(current) > 0 && descend(current)) {
+          current = hierarchy.first_child(current);
+          depth++;
+          fn(current, depth);
+          continue;
+        }
+        while (current != slot
+               && hierarchy.next_sibling(current)
+                    == soa_hierarchy_t::null_slot) {
+          current = hierarchy.parent(current);
+          depth--;
+        }
+        if (current == slot) {
+          break;
+        }
+        current = hierarchy.next_sibling(current);
+        fn(current, depth);
+      }
+    }
+  } // namespace
+
+  thh::handle_t soa_hierarchy_t::add() {
+    int32_t slot;
+    if (!free_slots_.empty()) {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+    } else {
+      slot = (int32_t)generation_.size();
+      generation_.push_back(0);
+      parent_.push_back(null_slot);
+      first_child_.push_back(null_slot);
+      last_child_.push_back(null_slot);
+      next_sibling_.push_back(null_slot);
+      prev_sibling_.push_back(null_slot);
+      child_count_.push_back(0);
+      name_.push_back(null_name_id);
+      occupied_.push_back(false);
+    }
+    occupied_[slot] = true;
+    size_++;
+    return handle(slot);
+  }
+
+  bool soa_hierarchy_t::remove(const thh::handle_t handle) {
+    if (!has_handle(handle)) {
+      return false;
+    }
+    unlink(handle.id_);
+    std::vector<int32_t> slots;
+    walk(
+      *this, handle.id_,
+      [&slots](const int32_t slot, int) { slots.push_back(slot); },
+      [](int32_t) { return true; });
+    for (const int32_t slot : slots) {
+      generation_[slot]++;
+      parent_[slot] = null_slot;
+      first_child_[slot] = null_slot;
+      last_child_[slot] = null_slot;
+      next_sibling_[slot] = null_slot;
+      prev_sibling_[slot] = null_slot;
+      child_count_[slot] = 0;
+      names_.release(name_[slot]);
+      name_[slot] = null_name_id;
+      occupied_[slot] = false;
+      free_slots_.push_back(slot);
+    }
+    size_ -= (int32_t)slots.size();
+    return true;
+  }
+
+  void soa_hierarchy_t::reserve(const int32_t capacity) {
+    generation_.reserve(capacity);
+    parent_.reserve(capacity);
+    first_child_.reserve(capacity);
+    last_child_.reserve(capacity);
+    next_sibling_.reserve(capacity);
+    prev_sibling_.reserve(capacity);
+    child_count_.reserve(capacity);
+    name_.reserve(capacity);
+    occupied_.reserve(capacity);
+  }
+
+  bool soa_hierarchy_t::has_handle(const thh::handle_t handle) const {
+    return handle.id_ >= 0 && handle.id_ < (int32_t)generation_.size()
+        && occupied_[handle.id_] && generation_[handle.id_] == handle.gen_;
+  }
+
+  void soa_hierarchy_t::set_name(
+    const thh::handle_t handle, const std::string_view name) {
+    if (!has_handle(handle)) {
+      return;
+    }
+    auto& name_id = name_[handle.id_];
+    name_id = name_id == null_name_id ? names_.intern(name)
+                                      : names_.rename(name_id, name);
+  }
+
+  std::string_view soa_hierarchy_t::name(const thh::handle_t handle) const {
+    if (!has_handle(handle)) {
+      return {};
+    }
+    return names_.name(name_[handle.id_]);
+  }
+
+  bool soa_hierarchy_t::link(
+    const int32_t parent_slot, const int32_t child_slot) {
+    if (parent_[child_slot] != null_slot) {
+      return false;
+    }
+    if (child_slot == parent_slot) {
+      return false;
+    }
+    // the child can't be one of the parent's ancestors (a childless entity
+    // can't be, so building top down doesn't walk the ancestors)
+    if (child_count_[child_slot] > 0) {
+      for (int32_t ancestor_slot = parent_[parent_slot];
+           ancestor_slot != null_slot; ancestor_slot = parent_[ancestor_slot]) {
+        if (ancestor_slot == child_slot) {
+          return false;
+        }
+      }
+    }
+    const int32_t last = last_child_[parent_slot];
+    if (last == null_slot) {
+      first_child_[parent_slot] = child_slot;
+    } else {
+      next_sibling_[last] = child_slot;
+    }
+    prev_sibling_[child_slot] = last;
+    next_sibling_[child_slot] = null_slot;
+    last_child_[parent_slot] = child_slot;
+    parent_[child_slot] = parent_slot;
+    child_count_[parent_slot]++;
+    return true;
+  }
+
+  void soa_hierarchy_t::unlink(const int32_t slot) {
+    const int32_t parent_slot = parent_[slot];
+    if (parent_slot == null_slot) {
+      return;
+    }
+    const int32_t prev = prev_sibling_[slot];
+    const int32_t next = next_sibling_[slot];
+    if (prev == null_slot) {
+      first_child_[parent_slot] = next;
+    } else {
+      next_sibling_[prev] = next;
+    }
+    if (next == null_slot) {
+      last_child_[parent_slot] = prev;
+    } else {
+      prev_sibling_[next] = prev;
+    }
+    child_count_[parent_slot]--;
+    parent_[slot] = null_slot;
+    prev_sibling_[slot] = null_slot;
+    next_sibling_[slot] = null_slot;
+  }
+
+  void add_children(
+    const thh::handle_t entity_handle,
+    const std::vector<thh::handle_t>& child_handles,
+    soa_hierarchy_t& hierarchy) {
+    if (!hierarchy.has_handle(entity_handle)) {
+      return;
+    }
+    for (const auto child_handle : child_handles) {
+      if (hierarchy.has_handle(child_handle)) {
+        hierarchy.link(entity_handle.id_, child_handle.id_);
+      }
+    }
+  }
+
+  std::vector<thh::handle_t> siblings(
+    const thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (!hierarchy.has_handle(entity_handle)) {
+      return std::vector<thh::handle_t>{};
+    }
+    const int32_t parent_slot = hierarchy.parent(entity_handle.id_);
+    if (parent_slot == soa_hierarchy_t::null_slot) {
+      return root_handles;
+    }
+    std::vector<thh::handle_t> sibling_handles;
+    sibling_handles.reserve(hierarchy.child_count(parent_slot));
+    for (int32_t slot = hierarchy.first_child(parent_slot);
+         slot != soa_hierarchy_t::null_slot;
+         slot = hierarchy.next_sibling(slot)) {
+      sibling_handles.push_back(hierarchy.handle(slot));
+    }
+    return sibling_handles;
+  }
+
+  bool has_children(
+    const thh::handle_t handle, const soa_hierarchy_t& hierarchy) {
+    return hierarchy.has_handle(handle)
+        && hierarchy.child_count(handle.id_) > 0;
+  }
+
+  void collapser_t::collapse(
+    const thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy) {
+    if (!collapsed(entity_handle) && has_children(entity_handle, hierarchy)) {
+      set_collapsed(entity_handle);
+    }
+  }
+
+  int expanded_count(
+    const thh::handle_t& entity_handle, const soa_hierarchy_t& hierarchy,
+    const collapser_t& collapser) {
+    if (!hierarchy.has_handle(entity_handle)) {
+      return 1;
+    }
+    int count = 0;
+    walk(
+      hierarchy, entity_handle.id_, [&count](int32_t, int) { count++; },
+      [&](const int32_t slot) {
+        return !collapser.collapsed(hierarchy.handle(slot));
+      });
+    return count;
+  }
+
+  std::vector<flattened_handle_t> flatten_entity(
+    const thh::handle_t entity_handle, const int indent,
+    const soa_hierarchy_t& hierarchy, const collapser_t& collapser) {
+    std::vector<flattened_handle_t> flattened;
+    if (!hierarchy.has_handle(entity_handle)) {
+      return flattened;
+    }
+    walk(
+      hierarchy, entity_handle.id_,
+      [&](const int32_t slot, const int depth) {
+        flattened.push_back({hierarchy.handle(slot), indent + depth});
+      },
+      [&](const int32_t slot) {
+        return !collapser.collapsed(hierarchy.handle(slot));
+      });
+    return flattened;
+  }
+
+  std::vector<flattened_handle_t> flatten_entities(
+    const soa_hierarchy_t& hierarchy, const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    std::vector<flattened_handle_t> flattened;
+    for (const auto root_handle : root_handles) {
+      if (!hierarchy.has_handle(root_handle)) {
+        continue;
+      }
+      walk(
+        hierarchy, root_handle.id_,
+        [&](const int32_t slot, const int depth) {
+          flattened.push_back({hierarchy.handle(slot), depth});
+        },
+        [&](const int32_t slot) {
+          return !collapser.collapsed(hierarchy.handle(slot));
+        });
+    }
+    return flattened;
+  }
+
+  std::vector<thh::handle_t> entity_and_descendants(
+    const thh::handle_t entity_handle, const soa_hierarchy_t& hierarchy) {
+    std::vector<thh::handle_t> all_handles;
+    if (!hierarchy.has_handle(entity_handle)) {
+      return all_handles;
+    }
+    walk(
+      hierarchy, entity_handle.id_,
+      [&](const int32_t slot, int) {
+        all_handles.push_back(hierarchy.handle(slot));
+      },
+      [](int32_t) { return true; });
+    return all_handles;
+  }
+} // namespace hy
+
+namespace demo {
+  std::vector<thh::handle_t> create_bench_entities(
+    hy::soa_hierarchy_t& hierarchy, const int root_count,
+    const int handle_count) {
+    // format names in place to avoid a temporary string per entity
+    char name[32] = "entity_";
+    const int prefix_length = 7;
+    const auto add_named = [&] {
+      const auto handle = hierarchy.add();
+      const auto result = std::to_chars(
+        name + prefix_length, name + sizeof(name), handle.id_);
+      hierarchy.set_name(handle, std::string_view(name, result.ptr - name));
+      return handle;
+    };
+
+    std::vector<thh::handle_t> roots;
+    roots.reserve(root_count);
+    hierarchy.reserve(hierarchy.size() + root_count * handle_count);
+    for (int64_t r = 0; r < root_count; r++) {
+      thh::handle_t parent_handle = add_named();
+      roots.push_back(parent_handle);
+      for (int64_t i = 1; i < handle_count; ++i) {
+        const auto handle = add_named();
+        hierarchy.link(parent_handle.id_, handle.id_);
+        parent_handle = handle;
+      }
+    }
+    return roots;
+  }
+} // namespace demo
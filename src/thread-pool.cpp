@@ -0,0 +1,78 @@
+#include "hierarchy/thread-pool.hpp"
+
+#include <algorithm>
+
+namespace hy {
+  thread_pool_t::thread_pool_t(const int thread_count) {
+    const int worker_count = std::max(thread_count, 1) - 1;
+    workers_.reserve(worker_count);
+    for (int i = 0; i < worker_count; i++) {
+      workers_.emplace_back([this] { work(); });
+    }
+  }
+
+  thread_pool_t::~thread_pool_t() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void thread_pool_t::for_each(
+    const int count, const std::function<void(int)>& fn) {
+    if (count <= 0) {
+      return;
+    }
+    if (workers_.empty() || count == 1) {
+      for (int i = 0; i < count; i++) {
+        fn(i);
+      }
+      return;
+    }
+    {
+      std::lock_guard lock(mutex_);
+      fn_ = &fn;
+      count_ = count;
+      next_ = 0;
+      working_ = (int)workers_.size();
+      generation_++;
+    }
+    start_.notify_all();
+    run_tasks();
+    std::unique_lock lock(mutex_);
+    done_.wait(lock, [this] { return working_ == 0; });
+    fn_ = nullptr;
+  }
+
+  void thread_pool_t::work() {
+    int64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock lock(mutex_);
+        start_.wait(
+          lock, [&] { return stop_ || generation_ != generation; });
+        if (stop_) {
+          return;
+        }
+        generation = generation_;
+      }
+      run_tasks();
+      {
+        std::lock_guard lock(mutex_);
+        working_--;
+      }
+      done_.notify_one();
+    }
+  }
+
+  void thread_pool_t::run_tasks() {
+    for (int i = next_.fetch_add(1, std::memory_order_relaxed); i < count_;
+         i = next_.fetch_add(1, std::memory_order_relaxed)) {
+      (*fn_)(i);
+    }
+  }
+} // namespace hy
@@ -0,0 +1,288 @@
+#include "hierarchy/virtual-view.hpp"
+
+#include <algorithm>
+
+namespace hy {
+  namespace {
+    const std::vector<thh::handle_t>* children(
+      const thh::handle_t handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          handle, [](const entity_t& entity) { return &entity.children_; })
+        .value_or(nullptr);
+    }
+
+    thh::handle_t parent(
+      const thh::handle_t handle,
+      const thh::handle_vector_t<hy::entity_t>& entities) {
+      return entities
+        .call_return(
+          handle, [](const entity_t& entity) { return entity.parent_; })
+        .value_or(thh::handle_t());
+    }
+
+    // children of parent_handle (or the roots if there is no parent)
+    const std::vector<thh::handle_t>& children_of_parent(
+      const thh::handle_t parent_handle,
+      const thh::handle_vector_t<hy::entity_t>& entities,
+      const std::vector<thh::handle_t>& root_handles) {
+      if (const auto* parent_children = children(parent_handle, entities);
+          parent_children != nullptr) {
+        return *parent_children;
+      }
+      return root_handles;
+    }
+  } // namespace
+
+  std::optional<flattened_handle_t> next_flattened_handle(
+    const flattened_handle_t& flattened_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    auto handle = flattened_handle.entity_handle_;
+    int indent = flattened_handle.indent_;
+    if (!collapser.collapsed(handle)) {
+      if (const auto* child_handles = children(handle, entities);
+          child_handles != nullptr && !child_handles->empty()) {
+        return flattened_handle_t{child_handles->front(), indent + 1};
+      }
+    }
+    // find the next sibling of the closest ancestor that has one
+    while (handle != thh::handle_t()) {
+      const auto parent_handle = parent(handle, entities);
+      const auto& handles =
+        children_of_parent(parent_handle, entities, root_handles);
+      if (const auto index = sibling_index(handle, handles, entities);
+          index.has_value() && *index + 1 < (int32_t)handles.size()) {
+        return flattened_handle_t{handles[*index + 1], indent};
+      }
+      handle = parent_handle;
+      indent--;
+    }
+    return {};
+  }
+
+  std::optional<flattened_handle_t> prev_flattened_handle(
+    const flattened_handle_t& flattened_handle,
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    const auto parent_handle =
+      parent(flattened_handle.entity_handle_, entities);
+    const auto& handles =
+      children_of_parent(parent_handle, entities, root_handles);
+    const auto index =
+      sibling_index(flattened_handle.entity_handle_, handles, entities);
+    if (!index.has_value()) {
+      return {};
+    }
+    if (*index == 0) {
+      if (parent_handle == thh::handle_t()) {
+        return {};
+      }
+      return flattened_handle_t{parent_handle, flattened_handle.indent_ - 1};
+    }
+    // last visible descendant of the previous sibling
+    auto handle = handles[*index - 1];
+    int indent = flattened_handle.indent_;
+    while (!collapser.collapsed(handle)) {
+      const auto* child_handles = children(handle, entities);
+      if (child_handles == nullptr || child_handles->empty()) {
+        break;
+      }
+      handle = child_handles->back();
+      indent++;
+    }
+    return flattened_handle_t{handle, indent};
+  }
+
+  std::optional<flattened_handle_t> flattened_handle_at(
+    int index, const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (index < 0) {
+      return {};
+    }
+    const std::vector<thh::handle_t>* handles = &root_handles;
+    for (int indent = 0; handles != nullptr; indent++) {
+      const std::vector<thh::handle_t>* child_handles = nullptr;
+      for (const auto handle : *handles) {
+        const int count = expanded_count(handle, entities, collapser);
+        if (index < count) {
+          if (index == 0) {
+            return flattened_handle_t{handle, indent};
+          }
+          index--;
+          child_handles = children(handle, entities);
+          break;
+        }
+        index -= count;
+      }
+      handles = child_handles;
+    }
+    return {};
+  }
+
+  int flattened_handle_count(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    int count = 0;
+    for (const auto root_handle : root_handles) {
+      count += expanded_count(root_handle, entities, collapser);
+    }
+    return count;
+  }
+
+  virtual_view_t::virtual_view_t(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles, const int offset,
+    const int count)
+    : count_(count) {
+    if (offset > 0) {
+      go_to_offset(offset, entities, collapser, root_handles);
+    } else {
+      fill(entities, collapser, root_handles);
+    }
+  }
+
+  thh::handle_t virtual_view_t::selected_handle() const {
+    if (!selected_index().has_value()) {
+      return thh::handle_t();
+    }
+    return flattened_handles_[selected_ - offset_].entity_handle_;
+  }
+
+  std::optional<int> virtual_view_t::selected_index() const {
+    if (flattened_handles_.empty()) {
+      return {};
+    }
+    return selected_;
+  }
+
+  std::optional<int> virtual_view_t::selected_indent() const {
+    if (!selected_index().has_value()) {
+      return {};
+    }
+    return flattened_handles_[selected_ - offset_].indent_;
+  }
+
+  void virtual_view_t::move_up(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (!selected_index().has_value()) {
+      return;
+    }
+    if (selected_ > offset_) {
+      selected_--;
+      return;
+    }
+    if (const auto prev = prev_flattened_handle(
+          flattened_handles_.front(), entities, collapser, root_handles);
+        prev.has_value()) {
+      flattened_handles_.insert(flattened_handles_.begin(), *prev);
+      if ((int)flattened_handles_.size() > count_) {
+        flattened_handles_.pop_back();
+      }
+      offset_--;
+      selected_--;
+    }
+  }
+
+  void virtual_view_t::move_down(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (!selected_index().has_value()) {
+      return;
+    }
+    if (selected_ - offset_ + 1 < (int)flattened_handles_.size()) {
+      selected_++;
+      return;
+    }
+    if (const auto next = next_flattened_handle(
+          flattened_handles_.back(), entities, collapser, root_handles);
+        next.has_value()) {
+      flattened_handles_.push_back(*next);
+      if ((int)flattened_handles_.size() > count_) {
+        flattened_handles_.erase(flattened_handles_.begin());
+        offset_++;
+      }
+      selected_++;
+    }
+  }
+
+  void virtual_view_t::collapse(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, const std::vector<thh::handle_t>& root_handles) {
+    if (const auto entity_handle = selected_handle();
+        entity_handle != thh::handle_t()
+        && !collapser.collapsed(entity_handle)) {
+      collapser.collapse(entity_handle, entities);
+      flattened_handles_.resize(selected_ - offset_ + 1);
+      fill(entities, collapser, root_handles);
+    }
+  }
+
+  void virtual_view_t::expand(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    collapser_t& collapser, const std::vector<thh::handle_t>& root_handles) {
+    if (const auto entity_handle = selected_handle();
+        entity_handle != thh::handle_t()
+        && collapser.collapsed(entity_handle)) {
+      collapser.expand(entity_handle, entities);
+      flattened_handles_.resize(selected_ - offset_ + 1);
+      fill(entities, collapser, root_handles);
+    }
+  }
+
+  void virtual_view_t::go_to_offset(
+    const int offset, const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    const int total_handles =
+      flattened_handle_count(entities, collapser, root_handles);
+    offset_ = std::clamp(offset, 0, std::max(total_handles - count_, 0));
+    selected_ = offset_;
+    flattened_handles_.clear();
+    if (const auto flattened_handle =
+          flattened_handle_at(offset_, entities, collapser, root_handles);
+        flattened_handle.has_value()) {
+      flattened_handles_.push_back(*flattened_handle);
+      fill(entities, collapser, root_handles);
+    }
+  }
+
+  void virtual_view_t::fill(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const collapser_t& collapser,
+    const std::vector<thh::handle_t>& root_handles) {
+    if (flattened_handles_.empty()) {
+      if (root_handles.empty() || offset_ != 0) {
+        return;
+      }
+      flattened_handles_.push_back(flattened_handle_t{root_handles.front(), 0});
+    }
+    flattened_handles_.reserve(count_);
+    while ((int)flattened_handles_.size() < count_) {
+      const auto next = next_flattened_handle(
+        flattened_handles_.back(), entities, collapser, root_handles);
+      if (!next.has_value()) {
+        break;
+      }
+      flattened_handles_.push_back(*next);
+    }
+  }
+
+  void display_scrollable_hierarchy(
+    const thh::handle_vector_t<hy::entity_t>& entities,
+    const std::vector<thh::handle_t>& root_handles, const virtual_view_t& view,
+    const collapser_t& collapser, const display_ops_t& display_ops) {
+    display_ops_backend_t backend{&display_ops};
+    display_scrollable_hierarchy(
+      entities, root_handles, view, collapser, backend);
+  }
+} // namespace hy
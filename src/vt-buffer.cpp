@@ -0,0 +1,111 @@
+#include "hierarchy/vt-buffer.hpp"
+
+#include <charconv>
+
+#define CSI "\x1b["
+
+namespace hy {
+  void vt_buffer_t::begin_frame() {
+    bytes_.append(CSI "1;1H"); // set cursor position
+    bytes_.append(CSI "0J"); // clear screen
+  }
+
+  void vt_buffer_t::clear() {
+    bytes_.clear();
+  }
+
+  void vt_buffer_t::set_bold(const bool bold) {
+    if (bold != bold_) {
+      bytes_.append(bold ? CSI "1m" : CSI "22m");
+      bold_ = bold;
+    }
+  }
+
+  void vt_buffer_t::set_invert(const bool invert) {
+    if (invert != invert_) {
+      bytes_.append(invert ? CSI "7m" : CSI "27m");
+      invert_ = invert;
+    }
+  }
+
+  void vt_buffer_t::draw_glyph(const int x, const int y, const glyph_e glyph) {
+    switch (glyph) {
+      case glyph_e::connection:
+        draw_at(x, y, connection_);
+        break;
+      case glyph_e::end:
+        draw_at(x, y, end_);
+        break;
+      case glyph_e::mid:
+        draw_at(x, y, mid_);
+        break;
+    }
+  }
+
+  void vt_buffer_t::draw_at(
+    const int x, const int y, const std::string_view str) {
+    move_cursor(x, y);
+    bytes_.append(str);
+  }
+
+  void vt_buffer_t::draw(const std::string_view str) {
+    bytes_.append(str);
+  }
+
+  void vt_buffer_t::scroll(
+    const int first_row, const int last_row, const int rows) {
+    // set scrolling region
+    bytes_.append(CSI);
+    write_number(first_row + 1);
+    bytes_.push_back(';');
+    write_number(last_row + 1);
+    bytes_.push_back('r');
+    // scroll up (S) or down (T)
+    bytes_.append(CSI);
+    write_number(rows > 0 ? rows : -rows);
+    bytes_.push_back(rows > 0 ? 'S' : 'T');
+    // reset scrolling region
+    bytes_.append(CSI "r");
+  }
+
+  void vt_buffer_t::clear_row(const int row) {
+    move_cursor(0, row);
+    bytes_.append(CSI "2K"); // clear line
+  }
+
+  void vt_buffer_t::move_cursor(const int x, const int y) {
+    bytes_.append(CSI);
+    write_number(y + 1);
+    bytes_.push_back(';');
+    write_number(x + 1);
+    bytes_.push_back('H');
+  }
+
+  void vt_buffer_t::write_number(const int number) {
+    char digits[16];
+    const auto result = std::to_chars(digits, digits + sizeof digits, number);
+    bytes_.append(digits, result.ptr);
+  }
+
+  display_ops_t vt_display_ops(vt_buffer_t& vt_buffer) {
+    display_ops_t display_ops;
+    display_ops.set_bold_fn_ = [&vt_buffer](const bool bold) {
+      vt_buffer.set_bold(bold);
+    };
+    display_ops.set_invert_fn_ = [&vt_buffer](const bool invert) {
+      vt_buffer.set_invert(invert);
+    };
+    display_ops.draw_at_fn_ =
+      [&vt_buffer](const int x, const int y, const std::string_view str) {
+        vt_buffer.draw_at(x, y, str);
+      };
+    display_ops.draw_fn_ = [&vt_buffer](const std::string_view str) {
+      vt_buffer.draw(str);
+    };
+    display_ops.connection_ = vt_buffer.connection_;
+    display_ops.end_ = vt_buffer.end_;
+    display_ops.mid_ = vt_buffer.mid_;
+    display_ops.indent_width_ = vt_buffer.indent_width_;
+    return display_ops;
+  }
+} // namespace hy